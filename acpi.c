@@ -24,221 +24,622 @@
 #include <dirent.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <getopt.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
 
 #include "list.h"
+#include "arena.h"
+#include "uring.h"
+#include "batch.h"
+#include "events.h"
+#include "shm.h"
 #include "acpi.h"
 
-#define DEVICE_LEN	20
-#define TRIP_POINTS	5
-#define BATTERY_DESC	"Battery"
-#define AC_ADAPTER_DESC "Adapter"
-#define THERMAL_DESC	"Thermal"
-#define COOLING_DESC	"Cooling"
-
-#define MIN_PRESENT_RATE 0.01
-#define MIN_CAPACITY	 0.01
-#define MIN_TEMP	 0.01
-
 static int ignore_directory_entry(struct dirent *de)
 {
     return !strcmp(de->d_name, ".") || !strcmp(de->d_name, "..");
 }
 
-static struct field *parse_field(char *buf, char *given_attr)
+/* the arena either ran out of memory or out of the caller's buffer */
+static int arena_error(struct arena *arena)
 {
-    struct field *rval;
-    char *p;
-    char *attr;
-    char *value;
-    int has_attr = 0;
+    return arena->fixed ? ACPI_ENOSPC : ACPI_ENOMEM;
+}
 
-    attr = calloc(BUF_SIZE, sizeof(char));
-    value = calloc(BUF_SIZE, sizeof(char));
-    rval = malloc(sizeof(struct field));
-    if (!rval || !attr || !value) {
-	fprintf(stderr, "Out of memory. Could not allocate memory in parse_field.\n");
-	exit(1);
-    }
+/* a list node and its field are allocated in one go from the arena */
+struct field_node {
+    struct list node;
+    struct field field;
+};
+
+/* line is a slice of the snapshot that is terminated at len; the
+ * attribute and the value point into it, nothing is copied */
+static struct field *parse_field(struct arena *arena, struct list **l, char *line, size_t len, char *given_attr,
+				 int *err)
+{
+    struct field_node *rval;
+    char *p = line;
 
-    p = buf;
     if (!given_attr) {
-	while (*(p++)) {
-	    if (*p == ':') {
-		strncpy(attr, buf, p - buf);
-		has_attr = 1;
-		break;
-	    }
-	}
-	if (!has_attr) {
-	    free(attr);
-	    free(value);
-	    free(rval);
+	p = len > 1 ? memchr(line + 1, ':', len - 1) : NULL;
+	if (!p)
 	    return NULL;
-	}
-	if (*p == ' ')
+	*(p++) = '\0';
+	while (*p == ' ')
 	    p++;
-	while (*(p++)) {
-	    if (*p != ' ')
-		break;
+    }
+
+    rval = arena_alloc(arena, sizeof(struct field_node));
+    if (!rval) {
+	*err = arena_error(arena);
+	return NULL;
+    }
+    /* the given attribute names are string constants, no need to copy them */
+    rval->field.attr = given_attr ? given_attr : line;
+    rval->field.value = p;
+    rval->node.data = &rval->field;
+    rval->node.next = *l;
+    *l = &rval->node;
+    return &rval->field;
+}
+
+static void set_attribute(struct device_info *dev, int id, char *value);
+static int proc_attribute(char *attr);
+
+/* parse the len bytes of buf into the fields of a device, returns ACPI_OK
+ * or the error of the arena; buf is copied into the snapshot once and
+ * split there, memchr() does the scanning */
+static int parse_info_buffer(struct arena *arena, struct device_info *dev, struct list **fields, const char *buf,
+			     size_t len, char *given_attr, int id)
+{
+    char *text, *line, *eol, *end;
+    struct field *f;
+    int err = ACPI_OK;
+
+    if (!len)
+	return ACPI_OK;
+    text = arena_strndup(arena, buf, len);
+    if (!text)
+	return arena_error(arena);
+    end = text + len;
+    for (line = text; line < end; line = eol + 1) {
+	eol = memchr(line, '\n', end - line);
+	if (!eol)
+	    eol = end;
+	*eol = '\0';
+	if (eol == line)
+	    continue;
+	f = parse_field(arena, fields, line, eol - line, given_attr, &err);
+	if (!f) {
+	    if (err != ACPI_OK)
+		return err;
+	    continue;
 	}
-    } else {
-	strncpy(attr, given_attr, BUF_SIZE);
-    }
-    strncpy(value, p, BUF_SIZE);
-    if (attr[strlen(attr) - 1] == '\n')
-	attr[strlen(attr) - 1] = '\0';
-    if (value[strlen(value) - 1] == '\n')
-	value[strlen(value) - 1] = '\0';
-    rval->attr = attr;
-    rval->value = value;
-    return rval;
+	set_attribute(dev, given_attr ? id : proc_attribute(f->attr), f->value);
+    }
+    return ACPI_OK;
 }
 
-static struct list *parse_info_file(struct list *l, char *filename, char *given_attr)
+/* read a whole attribute file relative to a directory descriptor, the
+ * result is always terminated */
+static ssize_t read_info_file(int dirfd, char *filename, char *buf, size_t size)
 {
-    FILE *fd;
-    char buf[BUF_SIZE];
+    ssize_t len = 0, n;
+    int fd;
 
-    fd = fopen(filename, "r");
-    if (!fd)
-	return l;
+    fd = openat(dirfd, filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+	return -1;
 
-    while (fgets(buf, BUF_SIZE, fd) != NULL) {
-	struct field *f;
-	f = parse_field(buf, given_attr);
-	if (!f) 
+    while (len < size - 1) {
+	n = read(fd, buf + len, size - 1 - len);
+	if (n < 0 && errno == EINTR)
 	    continue;
-	l = list_append(l, f);
+	if (n <= 0)
+	    break;
+	len += n;
     }
-    fclose(fd);
-    return l;
+    close(fd);
+    buf[len] = '\0';
+    return len;
 }
 
+enum attribute {
+    ATTR_CURRENT_NOW,
+    ATTR_POWER_NOW,
+    ATTR_CHARGE_NOW,
+    ATTR_ENERGY_NOW,
+    ATTR_VOLTAGE_NOW,
+    ATTR_VOLTAGE_MIN_DESIGN,
+    ATTR_CHARGE_FULL,
+    ATTR_ENERGY_FULL,
+    ATTR_CHARGE_FULL_DESIGN,
+    ATTR_ENERGY_FULL_DESIGN,
+    ATTR_ONLINE,
+    ATTR_CHARGING_STATE,
+    ATTR_TYPE,
+    ATTR_SYS_TEMP,
+    ATTR_CUR_STATE,
+    ATTR_MAX_STATE,
+    ATTR_NAME,
+    ATTR_ENERGY,
+    ATTR_MAX_ENERGY_RANGE,
+    ATTR_PACKAGE_ID,
+    ATTR_CORE_ID,
+    ATTR_CORE_THROTTLE_COUNT,
+    ATTR_CORE_THROTTLE_TOTAL,
+    ATTR_CORE_THROTTLE_MAX,
+    ATTR_PACKAGE_THROTTLE_COUNT,
+    ATTR_PACKAGE_THROTTLE_TOTAL,
+    ATTR_PACKAGE_THROTTLE_MAX,
+    ATTR_TOTAL_TRANS,
+    ATTR_TIME_IN_STATE,
+    ATTR_TRANS_TABLE,
+    /* these only show up as lines in the /proc files */
+    ATTR_REMAINING_CAPACITY,
+    ATTR_PRESENT_RATE,
+    ATTR_LAST_FULL_CAPACITY,
+    ATTR_STATE,
+    ATTR_STATUS,
+    ATTR_TEMPERATURE,
+    ATTR_UNKNOWN,
+    /* the files found in the directory of a device get their ids from here
+     * on, what they mean depends on the class: trip point n of a zone is
+     * ATTR_FOUND + TRIP_KINDS * n + TRIP_TYPE etc., the files of sensor n of
+     * a hwmon chip ATTR_FOUND + SENSOR_FILES * (SENSOR_TYPES * n + SENSOR_TEMP)
+     * + SENSOR_FILE_INPUT etc.; the index comes with the id and never has to
+     * be looked up */
+    ATTR_FOUND
+};
+
+#define TRIP_TYPE	0
+#define TRIP_TEMP	1
+#define TRIP_HYST	2
+#define TRIP_KINDS	3
+
+#define SENSOR_FILE_INPUT	0
+#define SENSOR_FILE_LABEL	1
+#define SENSOR_FILE_CRIT	2
+#define SENSOR_FILE_MAX		3
+#define SENSOR_FILES		4
+
+/* a higher index is no trip point resp. sensor of any real device */
+#define MAX_TRIP_POINT	4096
+#define MAX_SENSOR	4096
+
+/* the states of a cooling device that get statistics; the kernel gives no
+ * trans_table that does not fit a page, which is about 20 states */
+#define MAX_COOLING_STATE	1024
+#define MAX_TRANS_STATE		64
+
 struct file_list {
     char *file;
     char *attr;
+    int id;
+    int detail;		/* only read with ACPI_DETAILS */
 };
 
-static struct file_list sys_list[] = {
-    {"current_now", "current_now"},
-    {"power_now", "power_now"},
-    {"charge_now", "charge_now"},
-    {"energy_now", "energy_now"},
-    {"voltage_now", "voltage_now"},
-    {"voltage_min_design", "voltage_min_design"},
-    {"charge_full", "charge_full"},
-    {"energy_full", "energy_full"},
-    {"charge_full_design", "charge_full_design"},
-    {"energy_full_design", "energy_full_design"},
-    {"online", "online"},
-    {"status", "charging state"},
-    {"type", "type"},
-    {"temp", "sys_temp"},
-    {"trip_point_0_type", "trip_point_0_type"},
-    {"trip_point_0_temp", "trip_point_0_temp"},
-    {"trip_point_1_type", "trip_point_1_type"},
-    {"trip_point_1_temp", "trip_point_1_temp"},
-    {"trip_point_2_type", "trip_point_2_type"},
-    {"trip_point_2_temp", "trip_point_2_temp"},
-    {"trip_point_3_type", "trip_point_3_type"},
-    {"trip_point_3_temp", "trip_point_3_temp"},
-    {"trip_point_4_type", "trip_point_4_type"},
-    {"trip_point_4_temp", "trip_point_4_temp"},
-    {"cur_state", "cur_state"},
-    {"max_state", "max_state"}
+/* the files each class reads, every class has to read "type" if it shares
+ * its directory with another one, otherwise it cannot tell its entries apart */
+static struct file_list battery_sys_files[] = {
+    {"current_now", "current_now", ATTR_CURRENT_NOW, FALSE},
+    {"power_now", "power_now", ATTR_POWER_NOW, FALSE},
+    {"charge_now", "charge_now", ATTR_CHARGE_NOW, FALSE},
+    {"energy_now", "energy_now", ATTR_ENERGY_NOW, FALSE},
+    {"voltage_now", "voltage_now", ATTR_VOLTAGE_NOW, FALSE},
+    {"voltage_min_design", "voltage_min_design", ATTR_VOLTAGE_MIN_DESIGN, TRUE},
+    {"charge_full", "charge_full", ATTR_CHARGE_FULL, FALSE},
+    {"energy_full", "energy_full", ATTR_ENERGY_FULL, FALSE},
+    {"charge_full_design", "charge_full_design", ATTR_CHARGE_FULL_DESIGN, TRUE},
+    {"energy_full_design", "energy_full_design", ATTR_ENERGY_FULL_DESIGN, TRUE},
+    {"status", "charging state", ATTR_CHARGING_STATE, FALSE},
+    {"type", "type", ATTR_TYPE, FALSE},
 };
 
-static struct file_list proc_list[] = {
-    {"state", NULL},
-    {"status", NULL},
-    {"info", NULL},
-    {"temperature", NULL},
-    {"cooling_mode", NULL},
+static struct file_list ac_adapter_sys_files[] = {
+    {"online", "online", ATTR_ONLINE, FALSE},
+    {"type", "type", ATTR_TYPE, FALSE},
 };
 
-static struct list *get_info(char *device_name, int proc_interface)
-{
-    struct list *rval = NULL;
-    struct file_list *list = proc_interface ? proc_list : sys_list;
-    int i, n = (proc_interface ? sizeof(proc_list) : sizeof(sys_list)) / sizeof(struct file_list);
-    char *filename = malloc(strlen(device_name) + strlen("/energy_full_design "));
+/* a zone has as many trip points as the firmware defines, their files are
+ * found in its directory by find_files() */
+static struct file_list thermal_sys_files[] = {
+    {"type", "type", ATTR_TYPE, FALSE},
+    {"temp", "sys_temp", ATTR_SYS_TEMP, FALSE},
+};
 
-    if (filename == NULL) {
-	fprintf(stderr, "Out of memory. Could not allocate memory in get_info.\n");
-	return NULL;
-    }
+static struct file_list cooling_sys_files[] = {
+    {"type", "type", ATTR_TYPE, FALSE},
+    {"cur_state", "cur_state", ATTR_CUR_STATE, FALSE},
+    {"max_state", "max_state", ATTR_MAX_STATE, FALSE},
+    /* after max_state, which tells how many states the tables have */
+    {"stats/total_trans", "total_trans", ATTR_TOTAL_TRANS, TRUE},
+    {"stats/time_in_state_ms", "time_in_state_ms", ATTR_TIME_IN_STATE, TRUE},
+    {"stats/trans_table", "trans_table", ATTR_TRANS_TABLE, TRUE},
+};
+
+/* a chip has any number of sensors, their files are found like the trip
+ * points of a zone */
+static struct file_list hwmon_sys_files[] = {
+    {"name", "name", ATTR_NAME, FALSE},
+};
+
+/* the counters stay open with ACPI_KEEP_OPEN, their difference between two
+ * snapshots is the energy used in between */
+static struct file_list powercap_sys_files[] = {
+    {"name", "name", ATTR_NAME, FALSE},
+    {"energy_uj", "energy_uj", ATTR_ENERGY, FALSE},
+    {"max_energy_range_uj", "max_energy_range_uj", ATTR_MAX_ENERGY_RANGE, FALSE},
+};
+
+/* hundreds of cpus with a few files each, they are read by a few threads
+ * instead of being kept open */
+static struct file_list cpu_sys_files[] = {
+    {"topology/physical_package_id", "physical_package_id", ATTR_PACKAGE_ID, FALSE},
+    {"topology/core_id", "core_id", ATTR_CORE_ID, FALSE},
+    {"thermal_throttle/core_throttle_count", "core_throttle_count", ATTR_CORE_THROTTLE_COUNT, FALSE},
+    {"thermal_throttle/core_throttle_total_time_ms", "core_throttle_total_time_ms", ATTR_CORE_THROTTLE_TOTAL, FALSE},
+    {"thermal_throttle/core_throttle_max_time_ms", "core_throttle_max_time_ms", ATTR_CORE_THROTTLE_MAX, TRUE},
+    {"thermal_throttle/package_throttle_count", "package_throttle_count", ATTR_PACKAGE_THROTTLE_COUNT, FALSE},
+    {"thermal_throttle/package_throttle_total_time_ms", "package_throttle_total_time_ms", ATTR_PACKAGE_THROTTLE_TOTAL, FALSE},
+    {"thermal_throttle/package_throttle_max_time_ms", "package_throttle_max_time_ms", ATTR_PACKAGE_THROTTLE_MAX, TRUE},
+};
+
+/* the /proc files are parsed line by line */
+static struct file_list battery_proc_files[] = {
+    {"state", NULL, ATTR_UNKNOWN, FALSE},
+    {"info", NULL, ATTR_UNKNOWN, FALSE},
+};
 
-    for (i = 0; i < n; i++) {
-	sprintf(filename, "%s/%s", device_name, list[i].file);
-	rval = parse_info_file(rval, filename, list[i].attr);
+static struct file_list ac_adapter_proc_files[] = {
+    {"state", NULL, ATTR_UNKNOWN, FALSE},
+    {"status", NULL, ATTR_UNKNOWN, FALSE},
+};
+
+static struct file_list thermal_proc_files[] = {
+    {"state", NULL, ATTR_UNKNOWN, FALSE},
+    {"temperature", NULL, ATTR_UNKNOWN, FALSE},
+    {"cooling_mode", NULL, ATTR_UNKNOWN, TRUE},
+};
+
+static struct file_list cooling_proc_files[] = {
+    {"state", NULL, ATTR_UNKNOWN, FALSE},
+    {"status", NULL, ATTR_UNKNOWN, FALSE},
+};
+
+#define FILES(list) list, sizeof(list) / sizeof(struct file_list)
+
+struct device device[ACPI_CLASSES] = {
+			{ BATTERY, "battery", "power_supply", "BAT",
+			  FILES(battery_sys_files), FILES(battery_proc_files) },
+			{ AC_ADAPTER, "ac_adapter", "power_supply", "AC",
+			  FILES(ac_adapter_sys_files), FILES(ac_adapter_proc_files) },
+			{ THERMAL_ZONE, "thermal_zone", "thermal", "thermal_zone",
+			  FILES(thermal_sys_files), FILES(thermal_proc_files) },
+			{ COOLING_DEV, "fan", "thermal", "cooling_device",
+			  FILES(cooling_sys_files), FILES(cooling_proc_files) },
+			{ HWMON, "hwmon", "hwmon", "hwmon",
+			  FILES(hwmon_sys_files), NULL, 0 },
+			{ POWERCAP, "powercap", "powercap", "intel-rapl",
+			  FILES(powercap_sys_files), NULL, 0 },
+			{ CPU, "cpu", "../devices/system/cpu", "cpu",
+			  FILES(cpu_sys_files), NULL, 0 }
+			  };
+
+/* the files of a class, *n is set to their number */
+static struct file_list *class_files(int device_nr, int proc_interface, int *n)
+{
+    if (proc_interface) {
+	*n = device[device_nr].num_proc_files;
+	return device[device_nr].proc_files;
     }
+    *n = device[device_nr].num_sys_files;
+    return device[device_nr].sys_files;
+}
+
+/* the class a sysfs "type" names, among the classes that share the
+ * directory of device_nr; -1 if it is none of them */
+static int type_class(int device_nr, const char *type)
+{
+    if (!strcmp(device[device_nr].sys, device[THERMAL_ZONE].sys))
+	return strstr(type, "thermal zone") || strstr(type, "acpitz") ? THERMAL_ZONE : COOLING_DEV;
+    if (!strcasecmp(type, "battery"))
+	return BATTERY;
+    if (!strcasecmp(type, "mains"))
+	return AC_ADAPTER;
+    return -1;
+}
+
+/* the classes that live in the same directory as device_nr */
+static int shared_classes(int device_nr, int flags)
+{
+    int type, rval = 0;
 
+    if (flags & ACPI_PROC)
+	return ACPI_CLASS(device_nr);
+    for (type = 0; type < ACPI_CLASSES; type++)
+	if (!strcmp(device[type].sys, device[device_nr].sys))
+	    rval |= ACPI_CLASS(type);
     return rval;
 }
 
-void free_devices(struct list *devices)
+/* the class an entry of the directory of device_nr belongs to: the kernel
+ * names most of them after the class, only for the others the type has
+ * to be read; -1 if it belongs to no class */
+static int classify_entry(int dirfd, const char *name, int device_nr, int flags)
 {
-    struct list *p, *r, *s;
-    struct field *f;
+    char buf[BUF_SIZE / 4], path[PATH_MAX];
+    int type, classes = shared_classes(device_nr, flags);
+    ssize_t len;
 
-    p = devices;
-    while (p) {
-	r = s = p->data;
-	while (r) {
-	    f = r->data;
-	    free(f->attr);
-	    free(f->value);
-	    free(f);
-	    r = r->next;
-	}
-	list_free(s);
-	p = p->next;
+    /* cpufreq, cpuidle and the like are no cpus */
+    if (device_nr == CPU && !(flags & ACPI_PROC))
+	return !strncmp(name, "cpu", 3) && name[3] >= '0' && name[3] <= '9' ? CPU : -1;
+    if (classes == ACPI_CLASS(device_nr))
+	return device_nr;
+    for (type = 0; type < ACPI_CLASSES; type++)
+	if ((classes & ACPI_CLASS(type)) &&
+	    !strncmp(name, device[type].sys_dev, strlen(device[type].sys_dev)))
+	    return type;
+    snprintf(path, sizeof(path), "%s/type", name);
+    len = read_info_file(dirfd, path, buf, sizeof(buf));
+    if (len <= 0)
+	return -1;
+    if (buf[len - 1] == '\n')
+	buf[len - 1] = '\0';
+    return type_class(device_nr, buf);
+}
+
+/* is a file of the list read at all */
+static int want_file(struct file_list *file, int flags)
+{
+    return !file->detail || (flags & ACPI_DETAILS);
+}
+
+/* the id of a trip_point_<n>_{type,temp,hyst} file, with n taken straight
+ * from the name; -1 if it is none */
+static int trip_point_id(const char *name)
+{
+    static const char *kinds[TRIP_KINDS] = { "_type", "_temp", "_hyst" };
+    char *end;
+    long n;
+    int k;
+
+    if (strncmp(name, "trip_point_", 11) || name[11] < '0' || name[11] > '9')
+	return -1;
+    n = strtol(name + 11, &end, 10);
+    if (n > MAX_TRIP_POINT)
+	return -1;
+    for (k = 0; k < TRIP_KINDS; k++)
+	if (!strcmp(end, kinds[k]))
+	    return ATTR_FOUND + TRIP_KINDS * n + k;
+    return -1;
+}
+
+/* the id of a {temp,fan,power}<n>_{input,label,crit,max} file, the same
+ * way; -1 if it is none */
+static int sensor_id(const char *name)
+{
+    static const char *types[SENSOR_TYPES] = { "temp", "fan", "power" };
+    static const char *files[SENSOR_FILES] = { "_input", "_label", "_crit", "_max" };
+    char *end;
+    long n;
+    int t, k;
+
+    for (t = 0; t < SENSOR_TYPES; t++)
+	if (!strncmp(name, types[t], strlen(types[t])))
+	    break;
+    if (t == SENSOR_TYPES)
+	return -1;
+    name += strlen(types[t]);
+    if (*name < '0' || *name > '9')
+	return -1;
+    n = strtol(name, &end, 10);
+    if (n > MAX_SENSOR)
+	return -1;
+    for (k = 0; k < SENSOR_FILES; k++)
+	if (!strcmp(end, files[k]))
+	    return ATTR_FOUND + SENSOR_FILES * (SENSOR_TYPES * n + t) + k;
+    return -1;
+}
+
+/* the id of a file that is looked for in the directory of a device of
+ * the class, -1 if it is none; *detail is set if it is only read with
+ * ACPI_DETAILS: the hysteresis and the limits, not what decides the state
+ * or names a sensor */
+static int found_file_id(int device_nr, const char *name, int *detail)
+{
+    int id;
+
+    if (device_nr == HWMON) {
+	id = sensor_id(name);
+	*detail = id >= 0 && (id - ATTR_FOUND) % SENSOR_FILES >= SENSOR_FILE_CRIT;
+    } else {
+	id = trip_point_id(name);
+	*detail = id >= 0 && (id - ATTR_FOUND) % TRIP_KINDS == TRIP_HYST;
     }
-    list_free(devices);
+    return id;
 }
 
-struct list *find_devices(char *acpi_path, int device_nr,
-			  int proc_interface)
+/* do the devices of a class have files that have to be looked for */
+static int finds_files(int device_nr, int flags)
 {
-    DIR *d;
+    return !(flags & ACPI_PROC) && (device_nr == THERMAL_ZONE || device_nr == HWMON);
+}
+
+static int compare_ids(const void *a, const void *b)
+{
+    return ((const struct file_list *) a)->id - ((const struct file_list *) b)->id;
+}
+
+static void free_files(struct file_list *files, int num)
+{
+    int i;
+
+    for (i = 0; i < num; i++)
+	free(files[i].file);
+    free(files);
+}
+
+/* the trip point resp. sensor files in the directory devfd of a device of
+ * the class, sorted by their ids; *files is released by free_files() */
+static int find_files(int device_nr, int devfd, struct file_list **files, int *num)
+{
+    struct file_list *p;
     struct dirent *de;
-    struct list *device_info;
-    struct list *rval = NULL;
-    char *device_type = proc_interface ? device[device_nr].proc : device[device_nr].sys;
-    int found_data = FALSE;
+    DIR *d;
+    int fd, id, detail, max = 0;
 
-    if (chdir(acpi_path) < 0) {
-	fprintf(stderr, "No ACPI support in kernel, or incorrect acpi_path (\"%s\").\n", acpi_path);
-	exit(1);
+    *files = NULL;
+    *num = 0;
+    fd = openat(devfd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+	return ACPI_OK;
+    d = fdopendir(fd);
+    if (!d) {
+	close(fd);
+	return ACPI_ENOMEM;
+    }
+    while ((de = readdir(d))) {
+	id = found_file_id(device_nr, de->d_name, &detail);
+	if (id < 0)
+	    continue;
+	if (*num == max) {
+	    p = realloc(*files, (max ? max * 2 : 8) * sizeof(struct file_list));
+	    if (!p)
+		goto oom;
+	    *files = p;
+	    max = max ? max * 2 : 8;
+	}
+	p = &(*files)[*num];
+	p->file = p->attr = strdup(de->d_name);
+	if (!p->file)
+	    goto oom;
+	p->id = id;
+	p->detail = detail;
+	(*num)++;
     }
+    closedir(d);
+    if (*num)
+	qsort(*files, *num, sizeof(struct file_list), compare_ids);
+    return ACPI_OK;
 
-    if (chdir(device_type) == 0) {
-	d = opendir(".");
-	if (!d) 
-	return NULL;
+oom:
+    closedir(d);
+    free_files(*files, *num);
+    *files = NULL;
+    *num = 0;
+    return ACPI_ENOMEM;
+}
 
-	while ((de = readdir(d))) {
-	    if (ignore_directory_entry(de))
-		continue;
+/* file i of a device, the files of its class come before the ones found */
+static struct file_list *device_file(struct file_list *list, int n, struct file_list *found, int i)
+{
+    return i < n ? &list[i] : &found[i - n];
+}
 
-	    found_data = TRUE;
-	    device_info = get_info(de->d_name, proc_interface);
+/* the next number of a table line, after the blanks resp. the colon in
+ * front of it; *p moves behind it, returns -1 if there is none */
+static long long table_number(const char **p, const char *end)
+{
+    const char *s = *p;
+    long long x = 0;
 
-	    if (device_info)
-		rval = list_append(rval, device_info);
-	}
-	closedir(d);
+    while (s < end && (*s == ' ' || *s == '\t' || *s == ':'))
+	s++;
+    if (s == end || *s < '0' || *s > '9') {
+	*p = s;
+	return -1;
     }
+    while (s < end && *s >= '0' && *s <= '9')
+	x = x * 10 + (*s++ - '0');
+    *p = s;
+    return x;
+}
 
-    if (!found_data) {
-	fprintf(stderr, "No support for device type: %s\n", device_type);
-	return NULL;
+/* stats/time_in_state_ms has a line "state<n> <ms>" per state and
+ * stats/trans_table a row "state<n>: <count> ..." per state it was left
+ * from, below two header lines that start with a blank; they are parsed
+ * straight from buf, which need not be terminated, into an array of the
+ * snapshot, no field is made of them */
+static int parse_cooling_table(struct arena *arena, struct device_info *dev, const char *buf, size_t len, int id)
+{
+    struct cooling_stats *st = &dev->info.cooling.stats;
+    const char *line, *eol, *p, *end = buf + len;
+    long long *table, x;
+    int i, j, columns, states = dev->info.cooling.max_state + 1;
+
+    if (states <= 0)
+	return ACPI_OK;
+    if (states > MAX_COOLING_STATE)
+	states = MAX_COOLING_STATE;
+    columns = id == ATTR_TRANS_TABLE ? states : 1;
+    if (id == ATTR_TRANS_TABLE && states > MAX_TRANS_STATE)
+	return ACPI_OK;
+    table = arena_alloc(arena, states * columns * sizeof(long long));
+    if (!table)
+	return arena_error(arena);
+    for (i = 0; i < states * columns; i++)
+	table[i] = -1;
+
+    for (line = buf; line < end; line = eol + 1) {
+	eol = memchr(line, '\n', end - line);
+	if (!eol)
+	    eol = end;
+	if (eol - line < 5 || memcmp(line, "state", 5))
+	    continue;
+	p = line + 5;
+	i = table_number(&p, eol);
+	if (i < 0 || i >= states)
+	    continue;
+	for (j = 0; j < columns && (x = table_number(&p, eol)) >= 0; j++)
+	    table[i * columns + j] = x;
     }
 
-    return rval;
+    st->states = states;
+    if (id == ATTR_TRANS_TABLE)
+	st->trans_table = table;
+    else
+	st->time_in_state_ms = table;
+    return ACPI_OK;
+}
+
+/* parse what was read from one file of a list; only the names of the fixed
+ * lists are constants, the snapshot gets a copy of the others */
+static int parse_file(struct arena *arena, struct device_info *dev, struct list **fields, const char *buf,
+		      size_t len, struct file_list *file)
+{
+    char *attr = file->attr;
+
+    if (file->id == ATTR_TIME_IN_STATE || file->id == ATTR_TRANS_TABLE)
+	return parse_cooling_table(arena, dev, buf, len, file->id);
+    if (file->id >= ATTR_FOUND && !(attr = arena_strndup(arena, attr, strlen(attr))))
+	return arena_error(arena);
+    return parse_info_buffer(arena, dev, fields, buf, len, attr, file->id);
+}
+
+/* line names in the /proc files that map onto an attribute */
+static struct file_list proc_attributes[] = {
+    {NULL, "remaining capacity", ATTR_REMAINING_CAPACITY, FALSE},
+    {NULL, "present rate", ATTR_PRESENT_RATE, FALSE},
+    {NULL, "last full capacity", ATTR_LAST_FULL_CAPACITY, FALSE},
+    {NULL, "charging state", ATTR_CHARGING_STATE, FALSE},
+    {NULL, "state", ATTR_STATE, FALSE},
+    {NULL, "status", ATTR_STATUS, FALSE},
+    {NULL, "temperature", ATTR_TEMPERATURE, FALSE},
+};
+
+static int proc_attribute(char *attr)
+{
+    int i;
+
+    for (i = 0; i < sizeof(proc_attributes) / sizeof(struct file_list); i++)
+	if (!strcasecmp(attr, proc_attributes[i].attr))
+	    return proc_attributes[i].id;
+    return ATTR_UNKNOWN;
 }
 
 static int get_unit_value(char *value)
@@ -248,361 +649,1663 @@ static int get_unit_value(char *value)
     return n;
 }
 
-void print_battery_information(struct list *batteries, int show_empty_slots, int show_capacity)
-{
-    struct list *battery = batteries;
-    struct list *fields;
-    struct field *value;
-    int battery_num = 1;
-
-    while (battery) {
-	int remaining_capacity = -1;
-	int remaining_energy = -1;
-	int present_rate = -1;
-	int voltage = -1;
-	int design_capacity = -1;
-	int design_capacity_unit = -1;
-	int last_capacity = -1;
-	int last_capacity_unit = -1;
-	int hours, minutes, seconds;
-	int percentage;
-	char *state = NULL, *poststr;
-	int type_battery = TRUE;
-	char capacity_unit[4] = "mAh";
-
-	fields = battery->data;
-	while (fields) {
-	    value = fields->data;
-	    if (!strcasecmp(value->attr, "remaining capacity")) {
-		remaining_capacity = get_unit_value(value->value);
-		if (!state)
-		    state = strdup("available");
-	    } else if (!strcmp(value->attr, "charge_now")) {
-		remaining_capacity = get_unit_value(value->value) / 1000;
-		if (!state)
-		    state = strdup("available");
-	    } else if (!strcmp(value->attr, "energy_now")) {
-		remaining_energy = get_unit_value(value->value) / 1000;
-		if (!state)
-		    state = strdup("available");
-	    } else if (!strcasecmp(value->attr, "present rate")) {
-		present_rate = get_unit_value(value->value);
-	    } else if (!strcmp(value->attr, "current_now")) {
-		present_rate = get_unit_value(value->value) / 1000;
-	    } else if (!strcmp(value->attr, "power_now")) {
-		present_rate = get_unit_value(value->value) / 1000;
-	    } else if (!strcasecmp(value->attr, "last full capacity")) {
-		last_capacity = get_unit_value(value->value);
-		if (!state)
-		    state = strdup("available");
-	    } else if (!strcmp(value->attr, "charge_full")) {
-		last_capacity = get_unit_value(value->value) / 1000;
-		if (!state)
-		    state = strdup("available");
-	    } else if (!strcmp(value->attr, "energy_full")) {
-		last_capacity_unit = get_unit_value(value->value) / 1000;
-		if (!state)
-		    state = strdup("available");
-	    } else if (!strcmp(value->attr, "charge_full_design")) {
-		design_capacity = get_unit_value(value->value) / 1000;
-	    } else if (!strcmp(value->attr, "energy_full_design")) {
-		design_capacity_unit =
-		    get_unit_value(value->value) / 1000;
-	    } else if (!strcmp(value->attr, "type")) {
-		type_battery = (strcasecmp(value->value, "battery") == 0);
-	    } else if (!strcmp(value->attr, "charging state") || !strcmp(value->attr, "State")) {
-		state = value->value;
-	    } else if (!strcmp(value->attr, "voltage_now")) {
-		voltage = get_unit_value(value->value) / 1000;
-		if (!voltage) /* zero voltage makes all calculations mood */
-			voltage = -1;
-	    }
-	    fields = list_next(fields);
-	}
-	if (type_battery) {	/* or else this is the ac_adapter */
-	    if (!state) {
-		if (show_empty_slots) 
-		    printf("%s %d: slot empty\n", BATTERY_DESC, battery_num - 1);
-	    } else {
-		/* convert energy values (in mWh) to charge values (in mAh) if needed and possible */
-		if (last_capacity_unit != -1 && last_capacity == -1) {
-		    if (voltage != -1) {
-			last_capacity = last_capacity_unit * 1000 / voltage;
-		    } else {
-			last_capacity = last_capacity_unit;
-			strcpy(capacity_unit, "mWh");
-		    }
-		}
-		if (design_capacity_unit != -1 && design_capacity == -1) {
-		    if (voltage != -1) {
-			design_capacity = design_capacity_unit * 1000 / voltage;
-		    } else {
-			design_capacity = design_capacity_unit;
-			strcpy(capacity_unit, "mWh");
-		    }
-		}
-		if (remaining_energy != -1 && remaining_capacity == -1) {
-		    if (voltage != -1) {
-			remaining_capacity = remaining_energy * 1000 / voltage;
-			present_rate = present_rate * 1000 / voltage;
-		    } else {
-			remaining_capacity = remaining_energy;
-		    }
-		}
-		if (last_capacity < MIN_CAPACITY)
-		    percentage = 0;
-		else
-		    percentage = remaining_capacity * 100 / last_capacity;
-		
-		if (percentage > 100)
-		    percentage = 100;
-
-		printf("%s %d: %s, %d%%", BATTERY_DESC, battery_num - 1, state, percentage);
-
-		if (present_rate == -1) {
-		    poststr = "rate information unavailable";
-		    seconds = -1;
-		} else if (!strcasecmp(state, "charging")) {
-		    if (present_rate > MIN_PRESENT_RATE) {
-			seconds = 3600 * (last_capacity - remaining_capacity) / present_rate;
-			poststr = " until charged";
-		    } else {
-			poststr = "charging at zero rate - will never fully charge.";
-			seconds = -1;
-		    }
-		} else if (!strcasecmp(state, "discharging")) {
-		    if (present_rate > MIN_PRESENT_RATE) {
-			seconds = 3600 * remaining_capacity / present_rate;
-			poststr = " remaining";
-		    } else {
-			poststr = "discharging at zero rate - will never fully discharge.";
-			seconds = -1;
-		    }
-		} else {
-		    poststr = NULL;
-		    seconds = -1;
-		}
+static void set_battery_attribute(struct device_info *dev, int id, char *value)
+{
+    struct battery_info *b = &dev->info.battery;
 
-		if (seconds > 0) {
-		    hours = seconds / 3600;
-		    seconds -= 3600 * hours;
-		    minutes = seconds / 60;
-		    seconds -= 60 * minutes;
-		    printf(", %02d:%02d:%02d%s", hours, minutes, seconds, poststr);
-		} else if (poststr != NULL) {
-		    printf(", %s", poststr);
-		}
+    switch (id) {
+    case ATTR_REMAINING_CAPACITY:
+	b->remaining_capacity = get_unit_value(value);
+	dev->present = TRUE;
+	break;
+    case ATTR_CHARGE_NOW:
+	b->remaining_capacity = get_unit_value(value) / 1000;
+	dev->present = TRUE;
+	break;
+    case ATTR_ENERGY_NOW:
+	b->remaining_energy = get_unit_value(value) / 1000;
+	dev->present = TRUE;
+	break;
+    case ATTR_PRESENT_RATE:
+	b->present_rate = get_unit_value(value);
+	break;
+    case ATTR_CURRENT_NOW:
+    case ATTR_POWER_NOW:
+	b->present_rate = get_unit_value(value) / 1000;
+	break;
+    case ATTR_LAST_FULL_CAPACITY:
+	b->last_capacity = get_unit_value(value);
+	dev->present = TRUE;
+	break;
+    case ATTR_CHARGE_FULL:
+	b->last_capacity = get_unit_value(value) / 1000;
+	dev->present = TRUE;
+	break;
+    case ATTR_ENERGY_FULL:
+	b->last_capacity_unit = get_unit_value(value) / 1000;
+	dev->present = TRUE;
+	break;
+    case ATTR_CHARGE_FULL_DESIGN:
+	b->design_capacity = get_unit_value(value) / 1000;
+	break;
+    case ATTR_ENERGY_FULL_DESIGN:
+	b->design_capacity_unit = get_unit_value(value) / 1000;
+	break;
+    case ATTR_CHARGING_STATE:
+    case ATTR_STATE:
+	b->state = value;
+	break;
+    case ATTR_VOLTAGE_NOW:
+	b->voltage = get_unit_value(value) / 1000;
+	if (!b->voltage) /* zero voltage makes all calculations mood */
+	    b->voltage = -1;
+	break;
+    }
+}
 
-		printf("\n");
-
-		if (show_capacity && design_capacity > 0) {
-		    if (last_capacity <= 100) {
-			/* some broken systems just give a percentage here */
-			percentage = last_capacity;
-			last_capacity = percentage * design_capacity / 100;
-		    } else {
-			percentage = last_capacity * 100 / design_capacity;
-		    }
-		    if (percentage > 100)
-			percentage = 100;
-
-		    printf ("%s %d: design capacity %d %s, last full capacity %d %s = %d%%\n",
-			 BATTERY_DESC, battery_num - 1, design_capacity, capacity_unit, last_capacity, capacity_unit, percentage);
-		}
-	    }
-	    battery_num++;
+static void set_ac_adapter_attribute(struct device_info *dev, int id, char *value)
+{
+    struct ac_adapter_info *ac = &dev->info.ac_adapter;
+
+    switch (id) {
+    case ATTR_STATE:
+    case ATTR_STATUS:
+	ac->state = value;
+	break;
+    case ATTR_ONLINE:
+	ac->state = get_unit_value(value) ? "on-line" : "off-line";
+	break;
+    }
+}
+
+static void set_thermal_attribute(struct device_info *dev, int id, char *value)
+{
+    struct thermal_info *t = &dev->info.thermal;
+    int i;
+
+    switch (id) {
+    case ATTR_STATE:
+	t->state = value;
+	break;
+    case ATTR_TYPE:
+	dev->present = TRUE;
+	break;
+    case ATTR_TEMPERATURE:
+	t->temperature = get_unit_value(value);
+	if (strstr(value, "dK"))
+	    t->temperature = (t->temperature / 10) - ABSOLUTE_ZERO;
+	dev->present = TRUE;
+	break;
+    case ATTR_SYS_TEMP:
+	t->temperature = get_unit_value(value) / 1000.0;
+	dev->present = TRUE;
+	break;
+    default:
+	if (id < ATTR_FOUND)
+	    break;
+	i = (id - ATTR_FOUND) / TRIP_KINDS;
+	if (i >= t->trip_points)
+	    break;
+	switch ((id - ATTR_FOUND) % TRIP_KINDS) {
+	case TRIP_TYPE:
+	    t->trip[i].type = value;
+	    break;
+	case TRIP_TEMP:
+	    t->trip[i].temp = get_unit_value(value) / 1000.0;
+	    break;
+	case TRIP_HYST:
+	    t->trip[i].hyst = get_unit_value(value) / 1000.0;
+	    break;
 	}
-	battery = list_next(battery);
+	break;
+    }
+}
+
+static void set_cooling_attribute(struct device_info *dev, int id, char *value)
+{
+    struct cooling_info *c = &dev->info.cooling;
+    char *end;
+    long long x;
+
+    switch (id) {
+    case ATTR_STATUS:
+	c->state = value;
+	break;
+    case ATTR_TYPE:
+	c->type = value;
+	break;
+    case ATTR_CUR_STATE:
+	c->cur_state = get_unit_value(value);
+	break;
+    case ATTR_MAX_STATE:
+	c->max_state = get_unit_value(value);
+	break;
+    case ATTR_TOTAL_TRANS:
+	x = strtoll(value, &end, 10);
+	if (end != value && x >= 0)
+	    c->stats.total_trans = x;
+	break;
+    }
+}
+
+static void set_hwmon_attribute(struct device_info *dev, int id, char *value)
+{
+    struct hwmon_info *h = &dev->info.hwmon;
+    struct sensor *s;
+    char *end;
+    double x;
+    int i;
+
+    if (id == ATTR_NAME) {
+	h->name = value;
+	return;
+    }
+    if (id < ATTR_FOUND)
+	return;
+    i = (id - ATTR_FOUND) / SENSOR_FILES;
+    if (i >= h->sensors)
+	return;
+    s = &h->sensor[i];
+    if ((id - ATTR_FOUND) % SENSOR_FILES == SENSOR_FILE_LABEL) {
+	s->label = value;
+	return;
+    }
+    /* power is in microwatts, which do not fit an int for long */
+    x = strtod(value, &end);
+    if (end == value)
+	return;
+    if (s->type == SENSOR_TEMP)
+	x /= 1000;
+    else if (s->type == SENSOR_POWER)
+	x /= 1000000;
+    switch ((id - ATTR_FOUND) % SENSOR_FILES) {
+    case SENSOR_FILE_INPUT:
+	s->input = x;
+	s->known |= SENSOR_INPUT;
+	dev->present = TRUE;
+	break;
+    case SENSOR_FILE_CRIT:
+	s->crit = x;
+	s->known |= SENSOR_CRIT;
+	break;
+    case SENSOR_FILE_MAX:
+	s->max = x;
+	s->known |= SENSOR_MAX;
+	break;
     }
 }
 
-void print_ac_adapter_information(struct list *ac_adapters, int show_empty_slots)
+static void set_powercap_attribute(struct device_info *dev, int id, char *value)
 {
-    struct list *adapter = ac_adapters;
-    struct list *fields;
-    struct field *value;
-    int adapter_num = 1;
+    struct powercap_info *p = &dev->info.powercap;
+    char *end;
+    double x;
 
-    while (adapter) {
-	char *state = NULL;
-	int type_ac = TRUE;
+    if (id == ATTR_NAME) {
+	p->name = value;
+	return;
+    }
+    /* microjoules, which do not fit an int either */
+    x = strtod(value, &end);
+    if (end == value || x < 0)
+	return;
+    switch (id) {
+    case ATTR_ENERGY:
+	p->energy = x / 1000000;
+	dev->present = TRUE;
+	break;
+    case ATTR_MAX_ENERGY_RANGE:
+	p->max_range = x / 1000000;
+	break;
+    }
+}
+
+static void set_cpu_attribute(struct device_info *dev, int id, char *value)
+{
+    struct cpu_info *c = &dev->info.cpu;
+    char *end;
+    long long x;
+
+    x = strtoll(value, &end, 10);
+    if (end == value || x < 0)
+	return;
+    switch (id) {
+    case ATTR_PACKAGE_ID:
+	c->package = x;
+	break;
+    case ATTR_CORE_ID:
+	c->core = x;
+	break;
+    case ATTR_CORE_THROTTLE_COUNT:
+	c->scope[THROTTLE_CORE].count = x;
+	dev->present = TRUE;
+	break;
+    case ATTR_CORE_THROTTLE_TOTAL:
+	c->scope[THROTTLE_CORE].total_ms = x;
+	break;
+    case ATTR_CORE_THROTTLE_MAX:
+	c->scope[THROTTLE_CORE].max_ms = x;
+	break;
+    case ATTR_PACKAGE_THROTTLE_COUNT:
+	c->scope[THROTTLE_PACKAGE].count = x;
+	dev->present = TRUE;
+	break;
+    case ATTR_PACKAGE_THROTTLE_TOTAL:
+	c->scope[THROTTLE_PACKAGE].total_ms = x;
+	break;
+    case ATTR_PACKAGE_THROTTLE_MAX:
+	c->scope[THROTTLE_PACKAGE].max_ms = x;
+	break;
+    }
+}
 
-	 fields = adapter->data;
-	while (fields) {
-	    value = fields->data;
-	    if (!strcmp(value->attr, "state") || !strcmp(value->attr, "status"))
-		state = value->value;
-	    else if (!strcmp(value->attr, "online"))
-		state = get_unit_value(value->value) ? "on-line" : "off-line";
-	    else if (!strcmp(value->attr, "type"))
-		type_ac = (strcasecmp(value->value, "mains") == 0);
+static void set_attribute(struct device_info *dev, int id, char *value)
+{
+    switch (dev->type) {
+    case BATTERY:
+	set_battery_attribute(dev, id, value);
+	break;
+    case AC_ADAPTER:
+	set_ac_adapter_attribute(dev, id, value);
+	break;
+    case THERMAL_ZONE:
+	set_thermal_attribute(dev, id, value);
+	break;
+    case COOLING_DEV:
+	set_cooling_attribute(dev, id, value);
+	break;
+    case HWMON:
+	set_hwmon_attribute(dev, id, value);
+	break;
+    case POWERCAP:
+	set_powercap_attribute(dev, id, value);
+	break;
+    case CPU:
+	set_cpu_attribute(dev, id, value);
+	break;
+    }
+}
+
+static struct device_info *device_new(struct arena *arena, int device_nr, char *name)
+{
+    struct device_info *dev;
+    struct throttle *t;
+    int i;
 
-	    fields = list_next(fields);
+    dev = arena_alloc(arena, sizeof(struct device_info));
+    if (!dev)
+	return NULL;
+    memset(dev, 0, sizeof(struct device_info));
+    dev->type = device_nr;
+    dev->name = arena_strndup(arena, name, strlen(name));
+    if (!dev->name)
+	return NULL;
+    switch (device_nr) {
+    case BATTERY:
+	dev->info.battery.remaining_capacity = -1;
+	dev->info.battery.remaining_energy = -1;
+	dev->info.battery.present_rate = -1;
+	dev->info.battery.voltage = -1;
+	dev->info.battery.design_capacity = -1;
+	dev->info.battery.design_capacity_unit = -1;
+	dev->info.battery.last_capacity = -1;
+	dev->info.battery.last_capacity_unit = -1;
+	break;
+    case THERMAL_ZONE:
+	dev->info.thermal.temperature = -1;
+	break;
+    case COOLING_DEV:
+	dev->info.cooling.cur_state = -1;
+	dev->info.cooling.max_state = -1;
+	dev->info.cooling.stats.total_trans = -1;
+	dev->info.cooling.stats.total_trans_delta = -1;
+	break;
+    case POWERCAP:
+	dev->info.powercap.energy = -1;
+	dev->info.powercap.max_range = -1;
+	dev->info.powercap.power = -1;
+	break;
+    case CPU:
+	dev->info.cpu.package = -1;
+	dev->info.cpu.core = -1;
+	for (i = 0; i < THROTTLE_SCOPES; i++) {
+	    t = &dev->info.cpu.scope[i];
+	    t->count = t->total_ms = t->max_ms = t->count_delta = t->total_delta_ms = -1;
 	}
-	if (type_ac) {		/* or else this is a battery */
-	    if (!state) {
-		if (show_empty_slots) 
-		    printf("%s %d: slot empty\n", AC_ADAPTER_DESC, adapter_num - 1);
-	    } else  {
-		printf("%s %d: %s\n", AC_ADAPTER_DESC, adapter_num - 1, state);
-	    }
+	break;
+    }
+    return dev;
+}
+
+/* make room for the sensors of a chip before its files are parsed */
+static int device_prepare_sensors(struct arena *arena, struct device_info *dev, struct file_list *found, int num)
+{
+    struct hwmon_info *h = &dev->info.hwmon;
+    int i;
+
+    h->sensors = (found[num - 1].id - ATTR_FOUND) / SENSOR_FILES + 1;
+    h->sensor = arena_alloc(arena, h->sensors * sizeof(struct sensor));
+    if (!h->sensor)
+	return arena_error(arena);
+    memset(h->sensor, 0, h->sensors * sizeof(struct sensor));
+    for (i = 0; i < h->sensors; i++) {
+	h->sensor[i].type = i % SENSOR_TYPES;
+	h->sensor[i].index = i / SENSOR_TYPES;
+    }
+    return ACPI_OK;
+}
+
+/* make room for the trip points of a zone resp. the sensors of a chip
+ * before the files that were found are parsed, they are sorted by id so
+ * the last one has the highest index */
+static int device_prepare(struct arena *arena, struct device_info *dev, struct file_list *found, int num)
+{
+    struct thermal_info *t = &dev->info.thermal;
+    int i;
+
+    if (!num)
+	return ACPI_OK;
+    if (dev->type == HWMON)
+	return device_prepare_sensors(arena, dev, found, num);
+    t->trip_points = (found[num - 1].id - ATTR_FOUND) / TRIP_KINDS + 1;
+    t->trip = arena_alloc(arena, t->trip_points * sizeof(struct trip_point));
+    if (!t->trip)
+	return arena_error(arena);
+    for (i = 0; i < t->trip_points; i++) {
+	t->trip[i].temp = 0;
+	t->trip[i].hyst = -1;
+	t->trip[i].type = NULL;
+    }
+    return ACPI_OK;
+}
 
-	    adapter_num++;
+/* store the raw fields in the order they were read and derive the values
+ * that depend on more than one attribute */
+static int device_finish(struct arena *arena, struct device_info *dev, struct list *fields)
+{
+    struct battery_info *b = &dev->info.battery;
+    struct thermal_info *t = &dev->info.thermal;
+    int i;
+
+    dev->num_fields = list_length(fields);
+    dev->fields = arena_alloc(arena, dev->num_fields * sizeof(struct field));
+    if (!dev->fields)
+	return arena_error(arena);
+    for (i = dev->num_fields - 1; fields; i--, fields = list_next(fields))
+	dev->fields[i] = *(struct field *) fields->data;
+
+    switch (dev->type) {
+    case BATTERY:
+	if (!b->state && dev->present)
+	    b->state = "available";
+	if (b->state && !strcasecmp(b->state, "charging"))
+	    b->charging = BATTERY_CHARGING;
+	else if (b->state && !strcasecmp(b->state, "discharging"))
+	    b->charging = BATTERY_DISCHARGING;
+	break;
+    case THERMAL_ZONE:
+	if (!t->state && dev->present)
+	    t->state = "ok";
+	for (i = 0; i < t->trip_points; i++) {
+	    if (t->trip[i].type && t->temperature >= t->trip[i].temp && t->trip[i].temp >= MIN_TEMP) {
+		t->state = t->trip[i].type;
+		break;
+	    }
 	}
-	adapter = list_next(adapter);
+	break;
     }
+    return ACPI_OK;
 }
 
-static double get_real_temp(float temperature, char **scale, int temp_units)
+/* read one device of the class classify_entry() found, *rval stays NULL
+ * if there was nothing to read */
+static int get_info(struct arena *arena, int dirfd, char *device_name, int device_nr, int flags,
+		    struct device_info **rval)
 {
-	double real_temp = (double) temperature;
+    struct device_info *dev;
+    struct list *fields = NULL;
+    struct file_list *list, *found = NULL, *file;
+    int i, n, num_found = 0, devfd, err = ACPI_OK;
+    char buf[FILE_SIZE];
+    ssize_t len;
 
-	switch (temp_units) {
-	case TEMP_CELSIUS:
-	    *scale = "degrees C";
-	    break;
-	case TEMP_FAHRENHEIT:
-	    real_temp = (real_temp * 1.8) + 32;
-	    *scale = "degrees F";
-	    break;
-	case TEMP_KELVIN:
-	default:
-	    real_temp += ABSOLUTE_ZERO;
-	    *scale = "kelvin";
+    *rval = NULL;
+    list = class_files(device_nr, flags & ACPI_PROC, &n);
+    devfd = openat(dirfd, device_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (devfd < 0)
+	return ACPI_OK;
+
+    dev = device_new(arena, device_nr, device_name);
+    if (!dev) {
+	close(devfd);
+	return arena_error(arena);
+    }
+    if (finds_files(device_nr, flags)) {
+	err = find_files(device_nr, devfd, &found, &num_found);
+	if (err == ACPI_OK)
+	    err = device_prepare(arena, dev, found, num_found);
+    }
+    for (i = 0; i < n + num_found && err == ACPI_OK; i++) {
+	file = device_file(list, n, found, i);
+	if (!want_file(file, flags) || (len = read_info_file(devfd, file->file, buf, sizeof(buf))) < 0)
+	    continue;
+	err = parse_file(arena, dev, &fields, buf, len, file);
+    }
+    free_files(found, num_found);
+    close(devfd);
+    if (err == ACPI_OK && fields)
+	err = device_finish(arena, dev, fields);
+    if (err == ACPI_OK && fields)
+	*rval = dev;
+
+    return err;
+}
+
+static int device_append(struct arena *arena, struct list **l, struct device_info *dev)
+{
+    struct list *r;
+
+    r = arena_alloc(arena, sizeof(struct list));
+    if (!r)
+	return arena_error(arena);
+    r->data = dev;
+    r->next = *l;
+    *l = r;
+    return ACPI_OK;
+}
+
+/* returned by find_devices_batch() if the ring gave up on us */
+#define URING_FALLBACK	1
+
+/* threads that read a batch without a ring */
+#define BATCH_THREADS	4
+
+/* the classes that are read in one batch even without a ring */
+static int batch_class(int device_nr)
+{
+    return device_nr == CPU;
+}
+
+/* the same as the loop in find_devices(), but the attributes of all
+ * entries are read in one batch, by the ring if there is one and by a few
+ * threads otherwise */
+static int find_devices_batch(struct arena *arena, struct uring *uring, DIR *d, int device_nr, int classes, int flags,
+			      struct list **devices, int *found_data)
+{
+    struct file_list *list, *file, **found = NULL;
+    size_t size = (flags & ACPI_PROC) ? BUF_SIZE : BUF_SIZE / 4;
+    struct uring_read *reads = NULL;
+    struct dirent *de;
+    char **names = NULL, **p;
+    char *bufs = NULL;
+    char buf[FILE_SIZE];
+    ssize_t len;
+    int *devfds = NULL, *types = NULL, *num_found = NULL, *t;
+    int i, j, k, n, total = 0, count = 0, err = ACPI_OK;
+
+    while ((de = readdir(d))) {
+	if (ignore_directory_entry(de))
+	    continue;
+	*found_data = TRUE;
+	k = classify_entry(dirfd(d), de->d_name, device_nr, flags);
+	if (k < 0 || !(classes & ACPI_CLASS(k)))
+	    continue;
+	if (!(count & (count - 1))) {
+	    p = realloc(names, (count ? count * 2 : 1) * sizeof(char *));
+	    if (p)
+		names = p;
+	    t = realloc(types, (count ? count * 2 : 1) * sizeof(int));
+	    if (t)
+		types = t;
+	    if (!p || !t) {
+		err = ACPI_ENOMEM;
+		goto out;
+	    }
+	}
+	names[count] = arena_strndup(arena, de->d_name, strlen(de->d_name));
+	if (!names[count]) {
+	    err = arena_error(arena);
+	    goto out;
+	}
+	types[count++] = k;
+    }
+    if (!count)
+	goto out;
+
+    devfds = malloc(count * sizeof(int));
+    found = calloc(count, sizeof(struct file_list *));
+    num_found = calloc(count, sizeof(int));
+    if (!devfds || !found || !num_found) {
+	free(devfds);
+	devfds = NULL;
+	err = ACPI_ENOMEM;
+	goto out;
+    }
+    for (i = 0; i < count; i++)
+	devfds[i] = openat(dirfd(d), names[i], O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    /* entries we cannot open are left out of the batch, the zones and
+     * chips each bring their own number of files */
+    for (i = 0; i < count; i++) {
+	if (devfds[i] < 0)
+	    continue;
+	if (finds_files(types[i], flags) &&
+	    (err = find_files(types[i], devfds[i], &found[i], &num_found[i])) != ACPI_OK)
+	    goto out;
+	class_files(types[i], flags & ACPI_PROC, &n);
+	total += n + num_found[i];
+    }
+    reads = malloc(total * sizeof(struct uring_read));
+    bufs = malloc(total * size);
+    if (total && (!reads || !bufs)) {
+	err = ACPI_ENOMEM;
+	goto out;
+    }
+
+    for (i = 0, j = 0; i < count; i++) {
+	if (devfds[i] < 0)
+	    continue;
+	list = class_files(types[i], flags & ACPI_PROC, &n);
+	for (k = 0; k < n + num_found[i]; k++) {
+	    file = device_file(list, n, found[i], k);
+	    if (!want_file(file, flags))
+		continue;
+	    reads[j].dirfd = devfds[i];
+	    reads[j].file = file->file;
+	    reads[j].buf = bufs + j * size;
+	    reads[j].size = size;
+	    j++;
+	}
+    }
+    if (!uring || uring_read_files(uring, reads, j) < 0) {
+	/* the plain loop is just as good for the others */
+	if (!batch_class(device_nr)) {
+	    err = URING_FALLBACK;
+	    goto out;
+	}
+	batch_read_files(reads, j, BATCH_THREADS);
+    }
+
+    for (i = 0, j = 0; i < count && err == ACPI_OK; i++) {
+	struct device_info *dev;
+	struct list *fields = NULL;
+
+	if (devfds[i] < 0)
+	    continue;
+	dev = device_new(arena, types[i], names[i]);
+	if (!dev) {
+	    err = arena_error(arena);
 	    break;
 	}
-	return (real_temp);
-}
-
-void print_thermal_information(struct list *thermal, int show_empty_slots, int temp_units, int show_trip_points)
-{
-    struct list *sensor = thermal;
-    struct list *fields;
-    struct field *value;
-    int sensor_num = 1;
-    int type_zone = TRUE;
-
-    while (sensor) {
-	float temperature = -1;
-	struct {
-			float trip_temp;
-			char *trip_type;
-	} trip[TRIP_POINTS];
-	char str[]="trip_point_123_type";
-	char *state = NULL, *scale;
-	double real_temp;
-	int i, trip_points = -1;
-
-	memset(trip, 0, sizeof trip);
-	fields = sensor->data;
-	while (fields) {
-	    value = fields->data;
-	    if (!strcmp(value->attr, "state")) {
-		state = value->value;
-	    } else if (!strcmp(value->attr, "type")) {
-		type_zone = (strstr(value->value, "thermal zone") != NULL || strstr(value->value, "acpitz") != NULL);
-		if (!state)
-		    state = strdup("ok");
-	    } else if (!strcmp(value->attr, "temperature")) {
-		temperature = get_unit_value(value->value);
-		if (strstr(value->value, "dK"))
-		    temperature = (temperature / 10) - ABSOLUTE_ZERO;
-		if (!state)
-		    state = strdup("ok");
-	    } else if (!strcmp(value->attr, "sys_temp")) {
-		temperature = get_unit_value(value->value) / 1000.0;
-		if (!state)
-		    state = strdup("ok");
+	err = device_prepare(arena, dev, found[i], num_found[i]);
+	list = class_files(types[i], flags & ACPI_PROC, &n);
+	for (k = 0; k < n + num_found[i] && err == ACPI_OK; k++) {
+	    struct uring_read *r;
+
+	    file = device_file(list, n, found[i], k);
+	    if (!want_file(file, flags))
+		continue;
+	    r = &reads[j++];
+	    if (r->len < 0)
+		continue;
+	    if (r->len == r->size - 1) {
+		/* there may be more, read it the slow way */
+		if ((len = read_info_file(devfds[i], file->file, buf, sizeof(buf))) < 0)
+		    continue;
+		err = parse_file(arena, dev, &fields, buf, len, file);
 	    } else {
-		for (i = 0; i < TRIP_POINTS; i++)
-		{
-			sprintf(str, "trip_point_%d_temp", i);
-			if (!strcmp(value->attr, str)) {
-				trip[i].trip_temp = get_unit_value(value->value) / 1000.0;
-			}
-			sprintf(str, "trip_point_%d_type", i);
-			if (!strcmp(value->attr, str)) {
-				trip[i].trip_type = value->value;
-				if (i > trip_points)
-					trip_points = i;
-			}
-		}
-	    }
-	    fields = list_next(fields);
-	}
-	if (type_zone) {	/* or else this is a cooling device */
-	    for (i = 0; i <= trip_points; i++)
-	    {
-		if (temperature >= trip[i].trip_temp && trip[i].trip_temp >= MIN_TEMP) {
-			state = trip[i].trip_type;
-			break;
-		}
+		err = parse_file(arena, dev, &fields, r->buf, r->len, file);
 	    }
-	    if (!state) {
-		if (show_empty_slots) 
-		    printf("%s %d: slot empty\n", THERMAL_DESC, sensor_num - 1);
+	}
+	if (err == ACPI_OK && fields)
+	    err = device_finish(arena, dev, fields);
+	if (err == ACPI_OK && fields)
+	    err = device_append(arena, &devices[types[i]], dev);
+    }
+
+out:
+    if (devfds)
+	for (i = 0; i < count; i++) {
+	    if (devfds[i] >= 0)
+		close(devfds[i]);
+	    free_files(found[i], num_found[i]);
+	}
+    free(devfds);
+    free(found);
+    free(num_found);
+    free(reads);
+    free(bufs);
+    free(names);
+    free(types);
+    return err;
+}
+
+/* read the devices of all classes in the mask, which have to share the
+ * directory of device_nr, in one pass over it; devices is indexed by class
+ *
+ * does not touch the working directory or any other process wide state,
+ * so it may run in several threads at once */
+static int find_devices(struct arena *arena, struct uring *uring, int rootfd, int device_nr, int classes, int flags,
+			struct list **devices)
+{
+    DIR *d;
+    struct dirent *de;
+    struct device_info *device_info;
+    char *device_type = (flags & ACPI_PROC) ? device[device_nr].proc : device[device_nr].sys;
+    int found_data = FALSE;
+    int dirfd, type, err = ACPI_OK;
+
+    for (type = 0; type < ACPI_CLASSES; type++)
+	devices[type] = NULL;
+    dirfd = openat(rootfd, device_type, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd < 0)
+	return ACPI_ENODEV;
+    d = fdopendir(dirfd);
+    if (!d) {
+	close(dirfd);
+	return ACPI_ENOMEM;
+    }
+
+    if (uring || batch_class(device_nr)) {
+	err = find_devices_batch(arena, uring, d, device_nr, classes, flags, devices, &found_data);
+	if (err == URING_FALLBACK) {
+	    err = ACPI_OK;
+	    for (type = 0; type < ACPI_CLASSES; type++)
+		devices[type] = NULL;
+	    found_data = FALSE;
+	    rewinddir(d);
+	} else {
+	    closedir(d);
+	    if (err == ACPI_OK && !found_data)
+		return ACPI_ENODEV;
+	    return err;
+	}
+    }
+
+    while (err == ACPI_OK && (de = readdir(d))) {
+	if (ignore_directory_entry(de))
+	    continue;
+
+	found_data = TRUE;
+	type = classify_entry(dirfd, de->d_name, device_nr, flags);
+	if (type < 0 || !(classes & ACPI_CLASS(type)))
+	    continue;
+	err = get_info(arena, dirfd, de->d_name, type, flags, &device_info);
+
+	if (err == ACPI_OK && device_info)
+	    err = device_append(arena, &devices[type], device_info);
+    }
+    closedir(d);
+
+    if (err == ACPI_OK && !found_data)
+	return ACPI_ENODEV;
+
+    return err;
+}
+
+struct watch_device {
+    char name[256];
+    struct file_list *found;	/* trip points resp. sensors, read after the files of the class */
+    int num_found;
+    int num_files;	/* of the class and the ones found */
+    int *fds;
+    char **values;	/* with events, what was read last time, NULL if nothing */
+    int wd;		/* inotify watch of the device directory */
+    int dirty;		/* has to be read again */
+    int foreign;	/* belongs to the other class sharing the directory */
+    double energy;	/* of a powercap zone when it was last read, -1 if never */
+    double energy_time;
+    double next_energy;	/* what this read, it counts once the snapshot fits */
+    double next_energy_time;
+};
+
+struct watch {
+    int device_nr;
+    int flags;
+    struct file_list *files;
+    int num_files;
+    DIR *dir;
+    struct watch_device *devices;
+    int num_devices;
+    struct events *events;	/* only re-read what the events tell us about */
+    char *path;		/* of the class directory, for inotify */
+    int dir_wd;
+    int rescan;		/* devices came or went */
+};
+
+static void watch_close_device(struct watch *w, struct watch_device *dev)
+{
+    int j;
+
+    for (j = 0; j < dev->num_files; j++)
+	if (dev->fds[j] >= 0) {
+	    close(dev->fds[j]);
+	    dev->fds[j] = -1;
+	}
+}
+
+static void watch_close_devices(struct watch *w)
+{
+    int i, j;
+
+    for (i = 0; i < w->num_devices; i++) {
+	watch_close_device(w, &w->devices[i]);
+	free(w->devices[i].fds);
+	if (w->devices[i].values) {
+	    for (j = 0; j < w->devices[i].num_files; j++)
+		free(w->devices[i].values[j]);
+	    free(w->devices[i].values);
+	}
+	free_files(w->devices[i].found, w->devices[i].num_found);
+    }
+    free(w->devices);
+    w->devices = NULL;
+    w->num_devices = 0;
+}
+
+/* compare the current directory listing against the devices we hold open,
+ * this costs a getdents but no open */
+static int watch_devices_changed(struct watch *w)
+{
+    struct dirent *de;
+    int i = 0;
+
+    rewinddir(w->dir);
+    while ((de = readdir(w->dir))) {
+	if (ignore_directory_entry(de))
+	    continue;
+	if (i >= w->num_devices || strcmp(de->d_name, w->devices[i].name))
+	    return TRUE;
+	i++;
+    }
+    return i != w->num_devices;
+}
+
+static void watch_open_device(struct watch *w, struct watch_device *dev)
+{
+    struct file_list *file;
+    int i, devfd;
+
+    devfd = dev->foreign ? -1 : openat(dirfd(w->dir), dev->name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    for (i = 0; i < dev->num_files; i++) {
+	file = device_file(w->files, w->num_files, dev->found, i);
+	dev->fds[i] = devfd < 0 || !want_file(file, w->flags) ? -1 : openat(devfd, file->file, O_RDONLY | O_CLOEXEC);
+    }
+    if (devfd >= 0)
+	close(devfd);
+}
+
+/* the trip points resp. sensors a device has when it is scanned, new ones
+ * are picked up with the next scan */
+static int watch_find_files(struct watch *w, struct watch_device *dev)
+{
+    int devfd, err;
+
+    if (dev->foreign || !finds_files(w->device_nr, w->flags))
+	return ACPI_OK;
+    devfd = openat(dirfd(w->dir), dev->name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (devfd < 0)
+	return ACPI_OK;
+    err = find_files(w->device_nr, devfd, &dev->found, &dev->num_found);
+    close(devfd);
+    return err;
+}
+
+static int watch_scan(struct watch *w)
+{
+    char path[PATH_MAX];
+    struct dirent *de;
+
+    watch_close_devices(w);
+    w->rescan = FALSE;
+
+    rewinddir(w->dir);
+    while ((de = readdir(w->dir))) {
+	struct watch_device *dev;
+
+	if (ignore_directory_entry(de))
+	    continue;
+
+	dev = realloc(w->devices, (w->num_devices + 1) * sizeof(struct watch_device));
+	if (!dev)
+	    return ACPI_ENOMEM;
+	w->devices = dev;
+	dev = &w->devices[w->num_devices];
+	memset(dev, 0, sizeof(struct watch_device));
+	snprintf(dev->name, sizeof(dev->name), "%s", de->d_name);
+	/* kept in the list, so watch_devices_changed() can compare it */
+	dev->foreign = classify_entry(dirfd(w->dir), dev->name, w->device_nr, w->flags) != w->device_nr;
+	if (watch_find_files(w, dev) != ACPI_OK)
+	    return ACPI_ENOMEM;
+	dev->num_files = w->num_files + dev->num_found;
+	dev->fds = malloc(dev->num_files * sizeof(int));
+	if (w->events && dev->fds)
+	    dev->values = calloc(dev->num_files, sizeof(char *));
+	if (!dev->fds || (w->events && !dev->values)) {
+	    free(dev->fds);
+	    free(dev->values);
+	    free_files(dev->found, dev->num_found);
+	    return ACPI_ENOMEM;
+	}
+	w->num_devices++;
+	watch_open_device(w, dev);
+	dev->dirty = TRUE;
+	dev->wd = -1;
+	dev->energy = dev->next_energy = -1;
+	if (w->events && !dev->foreign) {
+	    snprintf(path, sizeof(path), "%s/%s", w->path, dev->name);
+	    dev->wd = events_add_dir(w->events, path, FALSE);
+	}
+    }
+    return ACPI_OK;
+}
+
+static struct watch *watch_new(int rootfd, const char *root, int device_nr, int flags, struct events *events)
+{
+    struct watch *w;
+    char *device_type = (flags & ACPI_PROC) ? device[device_nr].proc : device[device_nr].sys;
+    int fd;
+
+    w = calloc(1, sizeof(struct watch));
+    if (!w)
+	return NULL;
+    w->device_nr = device_nr;
+    w->flags = flags;
+    w->files = class_files(device_nr, flags & ACPI_PROC, &w->num_files);
+    w->events = events;
+    w->dir_wd = -1;
+    if (events) {
+	w->path = malloc(strlen(root) + strlen(device_type) + 2);
+	if (!w->path) {
+	    free(w);
+	    return NULL;
+	}
+	sprintf(w->path, "%s/%s", root, device_type);
+    }
+    fd = openat(rootfd, device_type, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0 && !(w->dir = fdopendir(fd)))
+	close(fd);
+    if (w->dir && events)
+	w->dir_wd = events_add_dir(events, w->path, TRUE);
+    /* a missing class is reported by every refresh */
+    if (w->dir && watch_scan(w) != ACPI_OK) {
+	watch_close_devices(w);
+	closedir(w->dir);
+	free(w->path);
+	free(w);
+	return NULL;
+    }
+    return w;
+}
+
+/* read the files of a device again and keep what they contain */
+static void watch_read_values(struct watch *w, struct watch_device *dev)
+{
+    char buf[FILE_SIZE], *p;
+    int j;
+    ssize_t len;
+
+    /* the files may have been replaced, not just rewritten */
+    watch_close_device(w, dev);
+    watch_open_device(w, dev);
+    for (j = 0; j < dev->num_files; j++) {
+	len = dev->fds[j] < 0 ? -1 : pread(dev->fds[j], buf, sizeof(buf) - 1, 0);
+	if (len < 0) {
+	    free(dev->values[j]);
+	    dev->values[j] = NULL;
+	    continue;
+	}
+	p = realloc(dev->values[j], len + 1);
+	if (!p)
+	    continue;
+	memcpy(p, buf, len);
+	p[len] = '\0';
+	dev->values[j] = p;
+    }
+    dev->dirty = FALSE;
+}
+
+static double monotonic_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* the average power of a zone since its counter was read last time; the
+ * counter wraps after max_range, which takes hours even for a package,
+ * so it cannot have wrapped more than once */
+static void watch_power(struct watch_device *wd, struct device_info *dev, double now)
+{
+    struct powercap_info *p = &dev->info.powercap;
+    double delta;
+
+    if (p->energy < 0) {
+	wd->next_energy = -1;
+	return;
+    }
+    if (wd->energy >= 0 && now > wd->energy_time) {
+	delta = p->energy - wd->energy;
+	if (delta < 0 && p->max_range > 0)
+	    delta += p->max_range;
+	if (delta >= 0) {
+	    p->interval = now - wd->energy_time;
+	    p->power = delta / p->interval;
+	}
+    }
+    wd->next_energy = p->energy;
+    wd->next_energy_time = now;
+}
+
+/* take the energies of a snapshot that fit as the ones the next powers
+ * are averaged from */
+static void watch_commit(struct watch *w)
+{
+    int i;
+
+    for (i = 0; i < w->num_devices; i++) {
+	w->devices[i].energy = w->devices[i].next_energy;
+	w->devices[i].energy_time = w->devices[i].next_energy_time;
+    }
+}
+
+/* the statistics of a cooling device count on without events */
+static int counts_on(struct file_list *file)
+{
+    return file->id == ATTR_TOTAL_TRANS || file->id == ATTR_TIME_IN_STATE || file->id == ATTR_TRANS_TABLE;
+}
+
+/* re-read every attribute we hold open into the same structure
+ * find_devices() would have built; with events only the devices that
+ * changed are read and the others are parsed from what we kept; energy
+ * counters and the statistics of cooling devices change without events,
+ * so they are always read */
+static int watch_refresh(struct arena *arena, struct watch *w, struct list **devices)
+{
+    struct watch_device *wd;
+    char buf[FILE_SIZE];
+    int i, j, err = ACPI_OK, rescan = FALSE;
+    int cached = w->events && w->device_nr != POWERCAP;
+    double now = 0;
+
+    *devices = NULL;
+    if (!w->dir)
+	return ACPI_ENODEV;
+
+    if ((w->events ? w->rescan : watch_devices_changed(w)) && (err = watch_scan(w)) != ACPI_OK)
+	return err;
+    if (!w->num_devices)
+	return ACPI_ENODEV;
+
+    for (i = 0; i < w->num_devices && err == ACPI_OK; i++) {
+	struct device_info *dev;
+	struct list *fields = NULL;
+
+	wd = &w->devices[i];
+	if (wd->foreign)
+	    continue;
+	dev = device_new(arena, w->device_nr, wd->name);
+	if (!dev)
+	    return arena_error(arena);
+	err = device_prepare(arena, dev, wd->found, wd->num_found);
+	if (cached && wd->dirty)
+	    watch_read_values(w, wd);
+	if (w->device_nr == POWERCAP)
+	    now = monotonic_time();
+	for (j = 0; j < wd->num_files && err == ACPI_OK; j++) {
+	    struct file_list *file = device_file(w->files, w->num_files, wd->found, j);
+	    const char *text = buf;
+	    ssize_t len;
+
+	    if (cached && !counts_on(file)) {
+		if (!wd->values[j])
+		    continue;
+		text = wd->values[j];
+		len = strlen(text);
 	    } else {
-		real_temp = get_real_temp(temperature, &scale, temp_units);
-		printf("%s %d: %s, %.1f %s\n", THERMAL_DESC, sensor_num - 1, state, real_temp, scale);
-		if (show_trip_points) {
-		    for (i = 0; i <= trip_points; i++)
-		    {
-			if (trip[i].trip_temp >= MIN_TEMP) {
-				real_temp = get_real_temp(trip[i].trip_temp, &scale, temp_units);
-				printf("%s %d: trip point %d switches to mode %s at temperature %.1f %s\n",
-				THERMAL_DESC, sensor_num - 1, i, trip[i].trip_type, real_temp, scale);
-			}
-		    }
+		if (wd->fds[j] < 0)
+		    continue;
+		len = pread(wd->fds[j], buf, sizeof(buf) - 1, 0);
+		if (len < 0) {
+		    /* the device went away under us */
+		    if (errno == ENODEV || errno == ENOENT)
+			rescan = TRUE;
+		    continue;
 		}
+		buf[len] = '\0';
 	    }
-	    sensor_num++;
+	    err = parse_file(arena, dev, &fields, text, len, file);
 	}
-	sensor = list_next(sensor);
+	if (err == ACPI_OK && fields)
+	    err = device_finish(arena, dev, fields);
+	if (err == ACPI_OK && w->device_nr == POWERCAP)
+	    watch_power(wd, dev, now);
+	if (err == ACPI_OK && fields)
+	    err = device_append(arena, devices, dev);
     }
+
+    if (rescan && err == ACPI_OK)
+	err = watch_scan(w);
+
+    return err;
 }
 
-void print_cooling_information(struct list *cooling, int show_empty_slots)
+/* mark what an event is about, returns TRUE if it concerns this class */
+static int watch_event(struct watch *w, const struct event *ev)
 {
-    struct list *sensor = cooling;
-    struct list *fields;
-    struct field *value;
-    int sensor_num = 1;
+    int i, rval = FALSE;
 
-    while (sensor) {
-	char *state = NULL, *type = NULL;
-	int cur_state = -1, max_state = -1;
-	int type_cooling = TRUE;
+    if (!w->dir)
+	return FALSE;
+    if (ev->overflow) {
+	w->rescan = TRUE;
+	return TRUE;
+    }
+    if (ev->wd >= 0 && ev->wd == w->dir_wd) {
+	w->rescan = TRUE;
+	return TRUE;
+    }
+    if (ev->subsystem) {
+	if ((w->flags & ACPI_PROC) || strcmp(ev->subsystem, device[w->device_nr].sys))
+	    return FALSE;
+	if (ev->structural) {
+	    w->rescan = TRUE;
+	    return TRUE;
+	}
+    }
+    for (i = 0; i < w->num_devices; i++) {
+	if ((ev->wd >= 0 && ev->wd == w->devices[i].wd) ||
+	    (ev->name && !strcmp(ev->name, w->devices[i].name))) {
+	    w->devices[i].dirty = TRUE;
+	    rval = TRUE;
+	}
+    }
+    return rval;
+}
 
-	fields = sensor->data;
-	while (fields) {
-	    value = fields->data;
-	    if (!strcmp(value->attr, "status")) {
-		state = value->value;
-	    } else if (!strcmp(value->attr, "type")) {
-		type = value->value;
-		type_cooling = (strstr(type, "thermal zone") == NULL && strstr(type, "acpitz") == NULL);
-	    } else if (!strcmp(value->attr, "cur_state")) {
-		cur_state = get_unit_value(value->value);
-	    } else if (!strcmp(value->attr, "max_state")) {
-		max_state = get_unit_value(value->value);
-	    }
-	    fields = list_next(fields);
-	}
-	if (type_cooling) {	/* or else this is a thermal zone */
-	    if (!state && !type) {
-		if (show_empty_slots)
-		    printf("%s %d: slot empty\n", COOLING_DESC, sensor_num - 1);
-	    } else if (state) {
-		printf("%s %d: %s\n", COOLING_DESC, sensor_num - 1, state);
-	    } else if (cur_state < 0 || max_state < 0) {
-		printf("%s %d: %s no state information available\n", COOLING_DESC, sensor_num - 1, type);
-	    } else {
-		printf("%s %d: %s %d of %d\n", COOLING_DESC, sensor_num - 1, type, cur_state, max_state);
-	    }
+static void watch_invalidate(struct watch *w)
+{
+    int i;
+
+    w->rescan = TRUE;
+    for (i = 0; i < w->num_devices; i++)
+	w->devices[i].dirty = TRUE;
+}
 
-	    sensor_num++;
+static int watch_invalidate_device(struct watch *w, const char *name)
+{
+    int i;
+
+    for (i = 0; i < w->num_devices; i++)
+	if (!strcmp(w->devices[i].name, name)) {
+	    w->devices[i].dirty = TRUE;
+	    return TRUE;
 	}
+    return FALSE;
+}
+
+static void watch_free(struct watch *w)
+{
+    watch_close_devices(w);
+    if (w->dir)
+	closedir(w->dir);
+    free(w->path);
+    free(w);
+}
+
+struct cpu_sample {
+    double time;		/* -1 if the cpu was not read yet */
+    long long count[THROTTLE_SCOPES];
+    long long total_ms[THROTTLE_SCOPES];
+};
+
+/* the counters of a cpu its deltas are taken against, and what the
+ * current snapshot read, which replaces them once the snapshot fits */
+struct cpu_counters {
+    struct cpu_sample last;
+    struct cpu_sample next;
+};
+
+struct cooling_sample {
+    double time;		/* -1 if the device was not read yet */
+    long long total_trans;
+    int has_time;		/* whether the tables below were read */
+    int has_trans;
+    long long *time_in_state_ms;	/* [states] */
+    long long *trans_table;	/* [states * states], NULL if there is none */
+};
 
-	sensor = list_next(sensor);
+/* the same for the statistics of a cooling device; the tables are swapped
+ * rather than copied once the snapshot fits */
+struct cooling_counters {
+    int states;			/* of the tables, 0 if there are none yet */
+    int fresh;			/* next was read by the current snapshot */
+    struct cooling_sample last;
+    struct cooling_sample next;
+};
+
+struct acpi_context {
+    int rootfd;
+    int flags;
+    char *path;
+    struct uring *uring;
+    struct events *events;
+    struct watch *watch[ACPI_CLASSES];
+    int changed;		/* classes the events told us about */
+    struct cpu_counters *cpus;	/* what the last snapshot read, by cpu number */
+    int num_cpus;
+    struct cooling_counters *coolings;	/* by the number of the cooling device */
+    int num_coolings;
+    struct shm_reader *shm;	/* with ACPI_SHM, instead of everything above */
+};
+
+struct acpi_snapshot {
+    int count[ACPI_CLASSES];
+    struct device_info **devices[ACPI_CLASSES];
+};
+
+/* the deltas of the throttle counters since the previous snapshot; the
+ * cpus are kept by number, they come and go with hotplug but the numbers
+ * stay */
+static int cpu_deltas(struct acpi_context *ctx, struct list *devices, double now)
+{
+    struct cpu_counters *c;
+    struct cpu_info *cpu;
+    struct throttle *t;
+    struct list *p;
+    int i, k, n;
+
+    for (p = devices; p; p = list_next(p)) {
+	cpu = &((struct device_info *) p->data)->info.cpu;
+	n = atoi(((struct device_info *) p->data)->name + 3);
+	if (n >= ctx->num_cpus) {
+	    c = realloc(ctx->cpus, (n + 1) * sizeof(struct cpu_counters));
+	    if (!c)
+		return ACPI_ENOMEM;
+	    for (i = ctx->num_cpus; i <= n; i++)
+		c[i].last.time = c[i].next.time = -1;
+	    ctx->cpus = c;
+	    ctx->num_cpus = n + 1;
+	}
+	c = &ctx->cpus[n];
+	for (k = 0; k < THROTTLE_SCOPES; k++) {
+	    t = &cpu->scope[k];
+	    /* a counter that went back was reset, by an offline cpu coming back */
+	    if (c->last.time >= 0 && c->last.count[k] >= 0 && t->count >= c->last.count[k])
+		t->count_delta = t->count - c->last.count[k];
+	    if (c->last.time >= 0 && c->last.total_ms[k] >= 0 && t->total_ms >= c->last.total_ms[k])
+		t->total_delta_ms = t->total_ms - c->last.total_ms[k];
+	    c->next.count[k] = t->count;
+	    c->next.total_ms[k] = t->total_ms;
+	}
+	if (c->last.time >= 0)
+	    cpu->interval = now - c->last.time;
+	c->next.time = now;
+    }
+    return ACPI_OK;
+}
+
+static void cooling_free_tables(struct cooling_counters *c)
+{
+    free(c->last.time_in_state_ms);
+    free(c->last.trans_table);
+    free(c->next.time_in_state_ms);
+    free(c->next.trans_table);
+    c->last.time_in_state_ms = c->last.trans_table = NULL;
+    c->next.time_in_state_ms = c->next.trans_table = NULL;
+    c->states = 0;
+}
+
+/* make the tables of a device as large as its number of states, it only
+ * changes if a driver reconfigures the device, which resets its counters */
+static int cooling_size_tables(struct cooling_counters *c, int states)
+{
+    size_t trans = states <= MAX_TRANS_STATE ? states * states * sizeof(long long) : 0;
+
+    if (c->states == states)
+	return ACPI_OK;
+    cooling_free_tables(c);
+    c->last.time = c->next.time = -1;
+    c->last.time_in_state_ms = malloc(states * sizeof(long long));
+    c->next.time_in_state_ms = malloc(states * sizeof(long long));
+    if (trans) {
+	c->last.trans_table = malloc(trans);
+	c->next.trans_table = malloc(trans);
+    }
+    if (!c->last.time_in_state_ms || !c->next.time_in_state_ms ||
+	(trans && (!c->last.trans_table || !c->next.trans_table))) {
+	cooling_free_tables(c);
+	return ACPI_ENOMEM;
+    }
+    c->states = states;
+    return ACPI_OK;
+}
+
+/* the delta of each entry of a table, NULL if an entry went back because
+ * the statistics were reset through stats/reset or is unknown */
+static long long *table_delta(struct arena *arena, const long long *now, const long long *last, int n, int *err)
+{
+    long long *delta;
+    int i;
+
+    for (i = 0; i < n; i++)
+	if (now[i] < 0 || last[i] < 0 || now[i] < last[i])
+	    return NULL;
+    delta = arena_alloc(arena, n * sizeof(long long));
+    if (!delta) {
+	*err = arena_error(arena);
+	return NULL;
+    }
+    for (i = 0; i < n; i++)
+	delta[i] = now[i] - last[i];
+    return delta;
+}
+
+/* the deltas of the statistics of the cooling devices since the previous
+ * snapshot, they are kept by the number in their name like the cpus */
+static int cooling_deltas(struct acpi_context *ctx, struct arena *arena, struct list *devices, double now)
+{
+    struct cooling_counters *c;
+    struct cooling_stats *st;
+    struct device_info *dev;
+    struct list *p;
+    int n, cells, err = ACPI_OK;
+
+    for (p = devices; p && err == ACPI_OK; p = list_next(p)) {
+	dev = p->data;
+	st = &dev->info.cooling.stats;
+	if (!st->states || strncmp(dev->name, "cooling_device", 14))
+	    continue;
+	n = atoi(dev->name + 14);
+	if (n >= ctx->num_coolings) {
+	    c = realloc(ctx->coolings, (n + 1) * sizeof(struct cooling_counters));
+	    if (!c)
+		return ACPI_ENOMEM;
+	    memset(c + ctx->num_coolings, 0, (n + 1 - ctx->num_coolings) * sizeof(struct cooling_counters));
+	    ctx->coolings = c;
+	    ctx->num_coolings = n + 1;
+	}
+	c = &ctx->coolings[n];
+	if ((err = cooling_size_tables(c, st->states)) != ACPI_OK)
+	    return err;
+	cells = st->states * st->states;
+
+	if (c->last.time >= 0) {
+	    if (c->last.total_trans >= 0 && st->total_trans >= c->last.total_trans)
+		st->total_trans_delta = st->total_trans - c->last.total_trans;
+	    if (c->last.has_time && st->time_in_state_ms)
+		st->time_in_state_delta_ms = table_delta(arena, st->time_in_state_ms, c->last.time_in_state_ms,
+							 st->states, &err);
+	    if (c->last.has_trans && st->trans_table)
+		st->trans_delta = table_delta(arena, st->trans_table, c->last.trans_table, cells, &err);
+	    st->interval = now - c->last.time;
+	}
+
+	c->next.total_trans = st->total_trans;
+	c->next.has_time = st->time_in_state_ms != NULL;
+	if (c->next.has_time)
+	    memcpy(c->next.time_in_state_ms, st->time_in_state_ms, st->states * sizeof(long long));
+	c->next.has_trans = st->trans_table && c->next.trans_table;
+	if (c->next.has_trans)
+	    memcpy(c->next.trans_table, st->trans_table, cells * sizeof(long long));
+	c->next.time = now;
+	c->fresh = TRUE;
+    }
+    return err;
+}
+
+/* take what the snapshot read as the counters of the next deltas */
+static void cooling_commit(struct acpi_context *ctx)
+{
+    struct cooling_sample s;
+    int i;
+
+    for (i = 0; i < ctx->num_coolings; i++) {
+	if (!ctx->coolings[i].fresh)
+	    continue;
+	s = ctx->coolings[i].last;
+	ctx->coolings[i].last = ctx->coolings[i].next;
+	ctx->coolings[i].next = s;
+	ctx->coolings[i].fresh = FALSE;
+    }
+}
+
+int acpi_open(const char *path, int flags, struct acpi_context **ctx)
+{
+    struct acpi_context *c;
+
+    if (!path || !ctx)
+	return ACPI_EINVAL;
+
+    if (flags & ACPI_SHM) {
+	c = calloc(1, sizeof(struct acpi_context));
+	if (!c)
+	    return ACPI_ENOMEM;
+	c->flags = ACPI_SHM;
+	c->rootfd = -1;
+	c->shm = shm_attach(path);
+	if (!c->shm) {
+	    free(c);
+	    return ACPI_ENOACPI;
+	}
+	*ctx = c;
+	return ACPI_OK;
+    }
+
+    /* events only make sense for files we keep open */
+    if (flags & ACPI_EVENTS)
+	flags |= ACPI_KEEP_OPEN;
+    c = calloc(1, sizeof(struct acpi_context));
+    if (!c)
+	return ACPI_ENOMEM;
+    c->flags = flags;
+    c->rootfd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (c->rootfd < 0) {
+	free(c);
+	return ACPI_ENOACPI;
+    }
+    if (flags & ACPI_EVENTS) {
+	c->path = strdup(path);
+	c->events = c->path ? events_new(path, (flags & ACPI_PROC) != 0) : NULL;
+	if (!c->events) {
+	    free(c->path);
+	    close(c->rootfd);
+	    free(c);
+	    return ACPI_ENOMEM;
+	}
     }
+    /* without a usable ring we silently read file by file */
+    if (flags & ACPI_URING)
+	c->uring = uring_new();
+    *ctx = c;
+    return ACPI_OK;
+}
+
+/* an empty string of a published device is a NULL one */
+static char *shm_string(struct arena *arena, const char *s, int *err)
+{
+    char *rval;
+
+    if (!*s)
+	return NULL;
+    rval = arena_strndup(arena, s, strnlen(s, SHM_NAME_SIZE - 1));
+    if (!rval)
+	*err = arena_error(arena);
+    return rval;
+}
+
+static struct device_info *shm_device(struct arena *arena, const struct shm_device *d)
+{
+    struct device_info *dev;
+    struct battery_info *b;
+    struct thermal_info *t;
+    struct cooling_info *c;
+    char name[SHM_NAME_SIZE];
+    int i, err = ACPI_OK;
+
+    snprintf(name, sizeof(name), "%.*s", SHM_NAME_SIZE - 1, d->name);
+    dev = device_new(arena, d->type, name);
+    if (!dev)
+	return NULL;
+    dev->present = d->present;
+    switch (d->type) {
+    case BATTERY:
+	b = &dev->info.battery;
+	b->state = shm_string(arena, d->state, &err);
+	b->charging = d->info.battery.charging;
+	b->remaining_capacity = d->info.battery.remaining_capacity;
+	b->remaining_energy = d->info.battery.remaining_energy;
+	b->present_rate = d->info.battery.present_rate;
+	b->voltage = d->info.battery.voltage;
+	b->design_capacity = d->info.battery.design_capacity;
+	b->design_capacity_unit = d->info.battery.design_capacity_unit;
+	b->last_capacity = d->info.battery.last_capacity;
+	b->last_capacity_unit = d->info.battery.last_capacity_unit;
+	break;
+    case AC_ADAPTER:
+	dev->info.ac_adapter.state = shm_string(arena, d->state, &err);
+	break;
+    case THERMAL_ZONE:
+	t = &dev->info.thermal;
+	t->state = shm_string(arena, d->state, &err);
+	t->temperature = d->info.thermal.temperature;
+	t->trip_points = d->info.thermal.trip_points;
+	if (t->trip_points < 0 || t->trip_points > SHM_TRIP_POINTS)
+	    t->trip_points = 0;
+	if (t->trip_points && !(t->trip = arena_alloc(arena, t->trip_points * sizeof(struct trip_point))))
+	    return NULL;
+	for (i = 0; i < t->trip_points; i++) {
+	    t->trip[i].temp = d->info.thermal.trip[i].temp;
+	    t->trip[i].hyst = d->info.thermal.trip[i].hyst;
+	    t->trip[i].type = shm_string(arena, d->info.thermal.trip[i].type, &err);
+	}
+	break;
+    case COOLING_DEV:
+	c = &dev->info.cooling;
+	c->state = shm_string(arena, d->state, &err);
+	c->type = shm_string(arena, d->info.cooling.type, &err);
+	c->cur_state = d->info.cooling.cur_state;
+	c->max_state = d->info.cooling.max_state;
+	break;
+    }
+    return err == ACPI_OK ? dev : NULL;
+}
+
+/* a snapshot of what was published last; the classes that were not are
+ * not supported */
+static int shm_snapshot(struct acpi_context *ctx, int classes, void *buf, size_t size, struct acpi_snapshot **snap)
+{
+    const struct shm_region *region;
+    const struct shm_device *d;
+    struct acpi_snapshot *s;
+    struct arena arena;
+    int type, i, err, count[ACPI_CLASSES] = { 0 };
+
+    err = shm_read(ctx->shm, &region);
+    if (err != ACPI_OK)
+	return err;
+    if (arena_init(&arena, buf, size) < 0 || !(s = arena_alloc(&arena, sizeof(struct acpi_snapshot))))
+	return ACPI_ENOSPC;
+
+    for (type = 0; type < ACPI_CLASSES; type++) {
+	s->count[type] = ACPI_ENODEV;
+	s->devices[type] = NULL;
+	if (type >= SHM_CLASSES || !(classes & ACPI_CLASS(type)) || region->count[type] < 0)
+	    continue;
+	s->count[type] = 0;
+	for (i = 0; i < region->num_devices; i++)
+	    if (region->device[i].type == type)
+		count[type]++;
+	s->devices[type] = arena_alloc(&arena, count[type] * sizeof(struct device_info *));
+	if (!s->devices[type])
+	    return ACPI_ENOSPC;
+    }
+    for (i = 0; i < region->num_devices; i++) {
+	d = &region->device[i];
+	if (d->type < 0 || d->type >= ACPI_CLASSES || s->count[d->type] < 0)
+	    continue;
+	s->devices[d->type][s->count[d->type]] = shm_device(&arena, d);
+	if (!s->devices[d->type][s->count[d->type]++])
+	    return ACPI_ENOSPC;
+    }
+
+    *snap = s;
+    return ACPI_OK;
+}
+
+int acpi_snapshot(struct acpi_context *ctx, int classes, void *buf, size_t size, struct acpi_snapshot **snap)
+{
+    struct arena arena;
+    struct acpi_snapshot *s;
+    struct list *devices[ACPI_CLASSES], *p;
+    int type, t, i, err, read, done = 0;
+    double now = 0;
+
+    if (ctx->shm)
+	return shm_snapshot(ctx, classes, buf, size, snap);
+    if (arena_init(&arena, buf, size) < 0)
+	return ACPI_ENOSPC;
+    s = arena_alloc(&arena, sizeof(struct acpi_snapshot));
+    if (!s)
+	return ACPI_ENOSPC;
+
+    for (type = 0; type < ACPI_CLASSES; type++) {
+	s->count[type] = ACPI_ENODEV;
+	s->devices[type] = NULL;
+    }
+
+    for (type = 0; type < ACPI_CLASSES; type++) {
+	if (!(classes & ACPI_CLASS(type)) || (done & ACPI_CLASS(type)))
+	    continue;
+
+	/* too many files to keep open, the context keeps the counters */
+	if ((ctx->flags & ACPI_KEEP_OPEN) && !batch_class(type)) {
+	    if (!ctx->watch[type] &&
+		!(ctx->watch[type] = watch_new(ctx->rootfd, ctx->path, type, ctx->flags, ctx->events)))
+		return ACPI_ENOMEM;
+	    read = ACPI_CLASS(type);
+	    err = watch_refresh(&arena, ctx->watch[type], &devices[type]);
+	} else {
+	    /* classes sharing a directory are read in the same pass */
+	    read = shared_classes(type, ctx->flags) & classes;
+	    now = monotonic_time();
+	    err = find_devices(&arena, ctx->uring, ctx->rootfd, type, read, ctx->flags, devices);
+	}
+	done |= read;
+	if (err == ACPI_OK && (read & ACPI_CLASS(CPU)))
+	    err = cpu_deltas(ctx, devices[CPU], now);
+	if (err == ACPI_OK && (read & ACPI_CLASS(COOLING_DEV)))
+	    err = cooling_deltas(ctx, &arena, devices[COOLING_DEV], monotonic_time());
+	if (err == ACPI_ENODEV)
+	    continue;
+	if (err != ACPI_OK)
+	    return err;
+
+	for (t = 0; t < ACPI_CLASSES; t++) {
+	    if (!(read & ACPI_CLASS(t)))
+		continue;
+	    s->count[t] = list_length(devices[t]);
+	    s->devices[t] = arena_alloc(&arena, s->count[t] * sizeof(struct device_info *));
+	    if (!s->devices[t])
+		return ACPI_ENOSPC;
+	    for (i = 0, p = devices[t]; p; i++, p = list_next(p))
+		s->devices[t][i] = p->data;
+	}
+    }
+
+    /* a snapshot that did not fit is taken again, its counters must not
+     * count as read */
+    if (ctx->watch[POWERCAP])
+	watch_commit(ctx->watch[POWERCAP]);
+    for (i = 0; i < ctx->num_cpus; i++)
+	ctx->cpus[i].last = ctx->cpus[i].next;
+    cooling_commit(ctx);
+
+    *snap = s;
+    return ACPI_OK;
+}
+
+int acpi_count(const struct acpi_snapshot *snap, int type)
+{
+    if (type < 0 || type >= ACPI_CLASSES)
+	return ACPI_EINVAL;
+    return snap->count[type];
+}
+
+const struct device_info *acpi_device(const struct acpi_snapshot *snap, int type, int index)
+{
+    if (type < 0 || type >= ACPI_CLASSES || index < 0 || index >= snap->count[type])
+	return NULL;
+    return snap->devices[type][index];
+}
+
+const char *acpi_strerror(int err)
+{
+    switch (err) {
+    case ACPI_OK:
+	return "Success";
+    case ACPI_ENOMEM:
+	return "Out of memory";
+    case ACPI_ENOSPC:
+	return "Snapshot buffer too small";
+    case ACPI_ENOACPI:
+	return "No ACPI support in kernel, or incorrect acpi_path";
+    case ACPI_ENODEV:
+	return "No support for device type";
+    case ACPI_EINVAL:
+	return "Invalid argument";
+    case ACPI_EBUSY:
+	return "The published snapshot is being written";
+    }
+    return "Unknown error";
+}
+
+int acpi_event_fd(struct acpi_context *ctx)
+{
+    return ctx->events ? events_fd(ctx->events) : ACPI_EINVAL;
+}
+
+static void handle_event(void *arg, const struct event *ev)
+{
+    struct acpi_context *ctx = arg;
+    int type;
+
+    for (type = 0; type < ACPI_CLASSES; type++)
+	if (ctx->watch[type] && watch_event(ctx->watch[type], ev))
+	    ctx->changed |= ACPI_CLASS(type);
+}
+
+int acpi_process_events(struct acpi_context *ctx)
+{
+    int changed;
+
+    if (!ctx->events)
+	return ACPI_EINVAL;
+    if (events_read(ctx->events, handle_event, ctx) < 0)
+	return ACPI_ENOACPI;
+    changed = ctx->changed;
+    ctx->changed = 0;
+    return changed;
+}
+
+void acpi_invalidate(struct acpi_context *ctx, int classes)
+{
+    int type;
+
+    for (type = 0; type < ACPI_CLASSES; type++)
+	if ((classes & ACPI_CLASS(type)) && ctx->watch[type])
+	    watch_invalidate(ctx->watch[type]);
+}
+
+int acpi_invalidate_device(struct acpi_context *ctx, int type, const char *name)
+{
+    if (type < 0 || type >= ACPI_CLASSES || !name)
+	return ACPI_EINVAL;
+    if (!ctx->watch[type] || !watch_invalidate_device(ctx->watch[type], name))
+	return ACPI_ENODEV;
+    return ACPI_OK;
+}
+
+void acpi_close(struct acpi_context *ctx)
+{
+    int i;
+
+    for (i = 0; i < ACPI_CLASSES; i++)
+	if (ctx->watch[i])
+	    watch_free(ctx->watch[i]);
+    if (ctx->events)
+	events_free(ctx->events);
+    free(ctx->path);
+    if (ctx->uring)
+	uring_free(ctx->uring);
+    free(ctx->cpus);
+    for (i = 0; i < ctx->num_coolings; i++)
+	cooling_free_tables(&ctx->coolings[i]);
+    free(ctx->coolings);
+    if (ctx->shm)
+	shm_detach(ctx->shm);
+    else
+	close(ctx->rootfd);
+    free(ctx);
 }
@@ -23,20 +23,51 @@
 #ifndef _ACPI_H
 #define _APCI_H
 
+#include <stdio.h>
+#include <time.h>
+
 #include "config.h"
+#include "libacpi.h"
 
 /* remember to update this when making new releases */
 #define ACPI_VERSION_STRING "acpi " VERSION
 
-#define ACPI_PATH_PROC   "/proc/acpi"
-#define ACPI_PATH_SYS   "/sys/class"
 #define BUF_SIZE    1024
+#define FILE_SIZE   4096	/* a sysfs attribute holds at most a page, like stats/trans_table */
 
 #define TEMP_KELVIN     0
 #define TEMP_CELSIUS    1
 #define TEMP_FAHRENHEIT 2
 #define ABSOLUTE_ZERO   273.1
 
+#define FORMAT_TEXT	0
+#define FORMAT_JSON	1
+#define FORMAT_CSV	2
+#define FORMAT_PROM	3
+
+#define ACPI_SOCKET_PATH	"/run/acpi.sock"
+#define ACPI_SHM_PATH		"/run/acpi.shm"
+#define DAEMON_TTL		1.0
+#define REQUEST_SIZE		4096
+
+#define SNAPSHOT_SIZE		(BUF_SIZE * 16)	/* the first buffer of take_snapshot(), it doubles until a snapshot fits */
+
+#define HISTORY_INTERVAL	60.0	/* seconds between samples if no -w is given */
+
+#define RULES_INTERVAL		1.0	/* seconds between the checks of the rules if no -w is given */
+
+#define SAMPLE_INTERVAL		0.25	/* seconds between the counter readings of a single reading */
+
+#define ADAPTIVE_INTERVAL	8.0	/* the longest seconds between the readings of a device with -A */
+#define SCHEDULE_MIN		0.25	/* and the shortest */
+
+#define EVENT_SETTLE_MS		10	/* events closer than this are read together */
+#define EVENT_SETTLE_ROUNDS	5
+
+#define MIN_PRESENT_RATE 0.01
+#define MIN_CAPACITY	 0.01
+#define MIN_TEMP	 0.01
+
 #ifndef FALSE
 #define FALSE           0
 #endif
@@ -44,10 +75,7 @@
 #define TRUE            !(FALSE)
 #endif
 
-#define BATTERY 0
-#define AC_ADAPTER 1
-#define THERMAL_ZONE 2
-#define COOLING_DEV 3
+struct file_list;
 
 extern struct device
 {
@@ -55,19 +83,124 @@ extern struct device
 	char *proc;
 	char *sys;
 	char *sys_dev;
-} device[4];
+	struct file_list *sys_files;	/* what is read of a device of the class */
+	int num_sys_files;
+	struct file_list *proc_files;
+	int num_proc_files;
+} device[ACPI_CLASSES];
+
+/* what is shown of a battery, the same for every output format */
+struct battery_status
+{
+	int percentage;		/* of the last full capacity */
+	int seconds;		/* until charged resp. discharged, -1 if unknown */
+	char *poststr;		/* what seconds means or why it is unknown, NULL if neither */
+	char capacity_unit[4];	/* mAh, or mWh if there was no voltage to convert energies */
+	int remaining_capacity;
+	int present_rate;
+	int last_capacity;	/* fixed up for systems that give a percentage here */
+	int design_capacity;
+	int health;		/* last full capacity in percent of the design capacity, -1 if unknown */
+};
+
+/* what a client asks the daemon for, the daemon only answers if it
+ * reads the same path the same way */
+struct request
+{
+	int format;
+	int classes;
+	int show_empty_slots;
+	int show_details;
+	int temp_units;
+	int proc_interface;
+	const char *path;
+	int tag_root;		/* put the path in front of the output, never sent to the daemon */
+	const struct trends *trends;	/* the windows of -W, NULL if there are none; not sent either */
+};
 
-struct list *find_devices(char *acpi_path, int device_nr, int proc_interface);
+struct report;
+struct trends;
+struct window;
 
-void free_devices(struct list *devices);
+const char *get_class_name(int type, int proc_interface);
 
-void print_battery_information(struct list *batteries, int show_empty_slots, int show_capacity);
+void get_battery_status(const struct battery_info *b, struct battery_status *s);
 
-void print_ac_adapter_information(struct list *batteries, int show_empty_slots);
+void get_smoothed_status(const struct battery_info *b, const struct window *w, struct battery_status *s);
 
-void print_thermal_information(struct list *batteries, int show_empty_slots, int temp_units, int show_trip_points);
+double get_real_temp(float temperature, char **scale, int temp_units);
 
-void print_cooling_information(struct list *batteries, int show_empty_slots);
+double get_temp_delta(double delta, int temp_units);
 
-#endif
+void print_battery_information(FILE *out, const struct acpi_snapshot *snap, int show_empty_slots, int show_capacity,
+			       const struct trends *trends);
+
+void print_ac_adapter_information(FILE *out, const struct acpi_snapshot *snap, int show_empty_slots);
+
+void print_thermal_information(FILE *out, const struct acpi_snapshot *snap, int show_empty_slots, int temp_units, int show_trip_points,
+			       const struct trends *trends);
+
+void print_cooling_information(FILE *out, const struct acpi_snapshot *snap, int show_empty_slots, int show_stats);
+
+const char *get_sensor_label(const struct sensor *s, char *buf, size_t size);
+
+double get_sensor_value(const struct sensor *s, double value, char **unit, int temp_units);
+
+void print_hwmon_information(FILE *out, const struct acpi_snapshot *snap, int show_empty_slots, int temp_units, int show_limits);
+
+void print_powercap_information(FILE *out, const struct acpi_snapshot *snap, int show_empty_slots, int show_energy);
+
+void print_throttle_information(FILE *out, const struct acpi_snapshot *snap, int show_all_cores, int show_max);
+
+void format_snapshot(struct report *r, const struct acpi_snapshot *snap, const struct request *q);
 
+void format_prom_roots(struct report *r, const struct acpi_snapshot **snaps, const char **roots, int n,
+		       const struct request *q);
+
+void format_header(struct report *r, const struct request *q);
+
+void render_snapshot(struct report *r, const struct acpi_snapshot *snap, const struct request *q);
+
+/* take a snapshot into *buf, which is grown as long as the snapshot does
+ * not fit; *buf has to be freed by the caller
+ *
+ * Pre: ctx was returned by acpi_open(), *buf is NULL or holds *size bytes
+ * Post: returns ACPI_OK and sets *snap, or an error code of acpi_snapshot()
+ */
+int take_snapshot(struct acpi_context *ctx, int classes, void **buf, size_t *size, struct acpi_snapshot **snap);
+
+/* have SIGTERM and SIGINT end the loop of a mode that keeps running,
+ * instead of the program
+ *
+ * Pre:
+ * Post: stop_requested() returns TRUE after either signal, they interrupt
+ *       sleeps and blocking calls
+ */
+void catch_stop(void);
+
+int stop_requested(void);
+
+/* sleep for the given seconds, or until a stop is requested
+ *
+ * Pre: seconds >= 0
+ * Post: the time passed or stop_requested() is TRUE
+ */
+void sleep_interval(double seconds);
+
+int daemon_serve(struct acpi_context *ctx, const char *socket_path, const char *path, int proc_interface, double ttl);
+
+int daemon_query(const char *socket_path, const struct request *q, struct report *r, int *unsupported);
+
+int publish_serve(struct acpi_context *ctx, const char *file, double interval);
+
+int rules_run(struct acpi_context *ctx, const char *file, double interval);
+
+int scan_roots(char **roots, int num_roots, int jobs, int flags, const struct request *q);
+
+int history_record(struct acpi_context *ctx, const char *file, int classes, double interval);
+
+int history_query(const char *file, int classes, time_t from, time_t until, int temp_units);
+
+int history_parse_time(const char *s, time_t *t);
+
+#endif
@@ -0,0 +1,157 @@
+/* a simple bump allocator for short-lived data
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+#define ARENA_CHUNK_SIZE	4096
+#define ARENA_ALIGN		(sizeof(void *) > sizeof(double) ? sizeof(void *) : sizeof(double))
+
+struct arena_chunk {
+    struct arena_chunk *prev;
+    size_t size;
+    size_t used;
+    /* data follows */
+};
+
+#define CHUNK_HEADER	((sizeof(struct arena_chunk) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+#define CHUNK_DATA(c)	((char *) (c) + CHUNK_HEADER)
+
+static struct arena_chunk *arena_chunk_new(struct arena_chunk *prev, size_t size)/*{{{*/
+{
+    struct arena_chunk *c;
+
+    c = malloc(CHUNK_HEADER + size);
+    if (!c)
+	return NULL;
+    c->prev = prev;
+    c->size = size;
+    c->used = 0;
+    return c;
+}
+
+struct arena *arena_new(void)/*{{{*/
+{
+    struct arena *a;
+
+    a = malloc(sizeof(struct arena));
+    if (!a)
+	return NULL;
+    a->chunk = arena_chunk_new(NULL, ARENA_CHUNK_SIZE);
+    if (!a->chunk) {
+	free(a);
+	return NULL;
+    }
+    a->used = 0;
+    a->fixed = 0;
+    return a;
+}
+
+int arena_init(struct arena *a, void *buf, size_t size)/*{{{*/
+{
+    size_t skip = (ARENA_ALIGN - (size_t) buf % ARENA_ALIGN) % ARENA_ALIGN;
+
+    if (size < skip + CHUNK_HEADER)
+	return -1;
+    a->chunk = (struct arena_chunk *) ((char *) buf + skip);
+    a->chunk->prev = NULL;
+    a->chunk->size = size - skip - CHUNK_HEADER;
+    a->chunk->used = 0;
+    a->used = 0;
+    a->fixed = 1;
+    return 0;
+}
+
+void *arena_alloc(struct arena *a, size_t size)/*{{{*/
+{
+    struct arena_chunk *c = a->chunk;
+    void *r;
+
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    if (c->used + size > c->size) {
+	size_t n = c->size * 2;
+
+	if (a->fixed)
+	    return NULL;
+	while (n < size)
+	    n *= 2;
+	c = arena_chunk_new(c, n);
+	if (!c)
+	    return NULL;
+	a->chunk = c;
+    }
+    r = CHUNK_DATA(c) + c->used;
+    c->used += size;
+    a->used += size;
+    return r;
+}
+
+char *arena_strndup(struct arena *a, const char *s, size_t len)/*{{{*/
+{
+    char *r;
+
+    r = arena_alloc(a, len + 1);
+    if (!r)
+	return NULL;
+    memcpy(r, s, len);
+    r[len] = '\0';
+    return r;
+}
+
+void arena_reset(struct arena *a)/*{{{*/
+{
+    struct arena_chunk *c = a->chunk, *prev;
+    size_t size = c->size;
+
+    if (c->prev) {
+	/* more than one chunk was needed, replace them all by one that fits */
+	while (size < a->used)
+	    size *= 2;
+	while (c->prev) {
+	    prev = c->prev;
+	    free(c);
+	    c = prev;
+	}
+	/* keep the first chunk if we cannot get a bigger one */
+	prev = arena_chunk_new(NULL, size);
+	if (prev) {
+	    free(c);
+	    a->chunk = prev;
+	} else {
+	    a->chunk = c;
+	}
+    }
+    a->chunk->used = 0;
+    a->used = 0;
+}
+
+void arena_free(struct arena *a)/*{{{*/
+{
+    struct arena_chunk *c = a->chunk, *prev;
+
+    while (c) {
+	prev = c->prev;
+	free(c);
+	c = prev;
+    }
+    free(a);
+}
@@ -0,0 +1,81 @@
+/* a simple bump allocator for short-lived data
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stddef.h>
+
+struct arena_chunk;
+
+struct arena {
+    struct arena_chunk *chunk;
+    size_t used;
+    int fixed;
+};
+
+/* create a new arena
+ *
+ * Pre:
+ * Post: returns a pointer to an empty arena or NULL if out of memory
+ */
+struct arena *arena_new(void);
+
+/* set up an arena that hands out the memory of a caller supplied buffer
+ * and never grows, it may be reset but must not be freed
+ *
+ * Pre: a != NULL, buf != NULL
+ * Post: returns 0, or -1 if size is too small to hold any data
+ */
+int arena_init(struct arena *a, void *buf, size_t size);
+
+/* allocate memory from an arena, it stays valid until the arena is
+ * reset or freed
+ *
+ * Pre: a != NULL
+ * Post: returns a pointer to size bytes of uninitialized, aligned memory
+ *       or NULL if the arena cannot grow
+ */
+void *arena_alloc(struct arena *a, size_t size);
+
+/* copy len bytes of a string into an arena and terminate it
+ *
+ * Pre: a != NULL
+ * Post: returns a pointer to the copy or NULL if the arena cannot grow
+ */
+char *arena_strndup(struct arena *a, const char *s, size_t len);
+
+/* release everything allocated from an arena but keep it for reuse
+ *
+ * Pre: a != NULL
+ * Post: the arena is empty and large enough to hold the previous contents
+ *       in one chunk
+ */
+void arena_reset(struct arena *a);
+
+/* free an arena and everything allocated from it
+ *
+ * Pre: a != NULL
+ * Post: all memory is released
+ */
+void arena_free(struct arena *a);
+
+#endif
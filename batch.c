@@ -0,0 +1,101 @@
+/* batched reading of attribute files with a few threads
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include "batch.h"
+
+/* files a thread takes at once, and that make another thread worth it */
+#define BATCH_CHUNK	32
+#define BATCH_MAX_THREADS	16
+
+struct batch {
+    struct uring_read *reads;
+    int n;
+    int next;			/* the first file nobody took yet */
+    pthread_mutex_t lock;
+};
+
+static void read_file(struct uring_read *r)
+{
+    ssize_t len;
+    int fd;
+
+    r->len = -1;
+    fd = openat(r->dirfd, r->file, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+	return;
+    while ((len = read(fd, r->buf, r->size - 1)) < 0 && errno == EINTR)
+	;
+    close(fd);
+    if (len < 0)
+	return;
+    r->len = len;
+    r->buf[len] = '\0';
+}
+
+static void *worker(void *arg)
+{
+    struct batch *b = arg;
+    int i, end;
+
+    for (;;) {
+	pthread_mutex_lock(&b->lock);
+	i = b->next;
+	b->next += BATCH_CHUNK;
+	pthread_mutex_unlock(&b->lock);
+	if (i >= b->n)
+	    break;
+	end = i + BATCH_CHUNK < b->n ? i + BATCH_CHUNK : b->n;
+	for (; i < end; i++)
+	    read_file(&b->reads[i]);
+    }
+    return NULL;
+}
+
+void batch_read_files(struct uring_read *reads, int n, int threads)
+{
+    struct batch b;
+    pthread_t tid[BATCH_MAX_THREADS];
+    int i, started;
+
+    if (threads > BATCH_MAX_THREADS)
+	threads = BATCH_MAX_THREADS;
+    if (threads > sysconf(_SC_NPROCESSORS_ONLN))
+	threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > (n + BATCH_CHUNK - 1) / BATCH_CHUNK)
+	threads = (n + BATCH_CHUNK - 1) / BATCH_CHUNK;
+    b.reads = reads;
+    b.n = n;
+    b.next = 0;
+    pthread_mutex_init(&b.lock, NULL);
+    /* if no thread can be had, we do it all ourselves */
+    for (started = 0; started < threads - 1; started++)
+	if (pthread_create(&tid[started], NULL, worker, &b) != 0)
+	    break;
+    worker(&b);
+    for (i = 0; i < started; i++)
+	pthread_join(tid[i], NULL);
+    pthread_mutex_destroy(&b.lock);
+}
@@ -0,0 +1,36 @@
+/* batched reading of attribute files with a few threads
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#ifndef _BATCH_H
+#define _BATCH_H
+
+#include "uring.h"
+
+/* open, read and close all files, split between at most threads threads
+ * including the calling one; the same batch uring_read_files() takes, for
+ * when there is no ring
+ *
+ * Pre: reads != NULL or n == 0, every buf holds size bytes, threads > 0
+ * Post: every len is set
+ */
+void batch_read_files(struct uring_read *reads, int n, int threads);
+
+#endif
@@ -0,0 +1,305 @@
+/* microbenchmarks for scanning, parsing and printing a device tree
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+/* the scanner internals are static, so we pull them in directly */
+#include "acpi.c"
+
+#include <stdio.h>
+#include <time.h>
+#include <getopt.h>
+
+#define MIN_NSEC	200000000LL	/* run every benchmark for at least 0.2s */
+
+static FILE *results;
+static int num_devices;
+static int min_iterations = 1;
+
+typedef void (*bench_fn)(void *arg);
+
+static long long now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* one line per benchmark: name, devices in the tree, iterations, ns per iteration */
+static void run(const char *name, bench_fn fn, void *arg)
+{
+    long long start, elapsed;
+    long iterations = 0;
+
+    fn(arg);	/* warm the dentry and page cache */
+    start = now();
+    do {
+	fn(arg);
+	iterations++;
+	elapsed = now() - start;
+    } while (iterations < min_iterations || elapsed < MIN_NSEC);
+    fprintf(results, "%s\t%d\t%ld\t%.1f\n", name, num_devices, iterations, (double)elapsed / iterations);
+}
+
+struct tree {
+    int rootfd;
+    int proc_interface;
+    int entries;
+    struct acpi_context *ctx;
+    struct acpi_context *uring_ctx;
+    char *buf;
+    size_t size;
+    struct acpi_snapshot *snap;
+};
+
+static void bench_enumerate(void *arg)
+{
+    struct tree *t = arg;
+    struct dirent *de;
+    DIR *d;
+    int type, fd, entries = 0;
+
+    for (type = 0; type < ACPI_CLASSES; type++) {
+	fd = openat(t->rootfd, t->proc_interface ? device[type].proc : device[type].sys,
+		    O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+	    continue;
+	d = fdopendir(fd);
+	if (!d) {
+	    close(fd);
+	    continue;
+	}
+	while ((de = readdir(d)))
+	    if (!ignore_directory_entry(de))
+		entries++;
+	closedir(d);
+    }
+    t->entries = entries;
+}
+
+/* open and read every attribute file of every device, without parsing */
+static void bench_read(void *arg)
+{
+    struct tree *t = arg;
+    struct file_list *files;
+    char buf[BUF_SIZE];
+    struct dirent *de;
+    DIR *d;
+    int type, fd, devfd, i, n;
+
+    for (type = 0; type < ACPI_CLASSES; type++) {
+	files = class_files(type, t->proc_interface, &n);
+	fd = openat(t->rootfd, t->proc_interface ? device[type].proc : device[type].sys,
+		    O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+	    continue;
+	d = fdopendir(fd);
+	if (!d) {
+	    close(fd);
+	    continue;
+	}
+	while ((de = readdir(d))) {
+	    if (ignore_directory_entry(de))
+		continue;
+	    devfd = openat(fd, de->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	    if (devfd < 0)
+		continue;
+	    for (i = 0; i < n; i++)
+		read_info_file(devfd, files[i].file, buf, sizeof(buf));
+	    close(devfd);
+	}
+	closedir(d);
+    }
+}
+
+/* an info and a state file of a /proc battery */
+static const char proc_text[] =
+    "present:                 yes\n"
+    "design capacity:         4400 mAh\n"
+    "last full capacity:      4000 mAh\n"
+    "battery technology:      rechargeable\n"
+    "design voltage:          10800 mV\n"
+    "design capacity warning: 200 mAh\n"
+    "design capacity low:     100 mAh\n"
+    "model number:            BAT0\n"
+    "battery type:            LION\n"
+    "present:                 yes\n"
+    "capacity state:          ok\n"
+    "charging state:          discharging\n"
+    "present rate:            1500 mA\n"
+    "remaining capacity:      2000 mAh\n"
+    "present voltage:         12000 mV\n";
+
+static char *sys_values[] = {
+    "Discharging\n", "11000000\n", "20000000\n", "50000000\n", "8000000\n", "Battery\n",
+};
+
+#define PARSE_ROUNDS	1000
+
+/* splitting files into fields alone, over a fixed set of files, resetting
+ * the arena each round */
+static void bench_parse(void *arg)
+{
+    struct arena *arena = arg;
+    struct device_info *dev;
+    struct list *fields;
+    int round, i;
+
+    for (round = 0; round < PARSE_ROUNDS; round++) {
+	fields = NULL;
+	dev = device_new(arena, BATTERY, "BAT0");
+	if (!dev)
+	    return;
+	parse_info_buffer(arena, dev, &fields, proc_text, sizeof(proc_text) - 1, NULL, ATTR_UNKNOWN);
+	for (i = 0; i < sizeof(sys_values) / sizeof(sys_values[0]); i++)
+	    parse_info_buffer(arena, dev, &fields, sys_values[i], strlen(sys_values[i]), "value", ATTR_UNKNOWN);
+	arena_reset(arena);
+    }
+}
+
+static int snapshot(struct acpi_context *ctx, struct tree *t)
+{
+    int err;
+
+    while ((err = acpi_snapshot(ctx, ACPI_ALL_CLASSES, t->buf, t->size, &t->snap)) == ACPI_ENOSPC) {
+	free(t->buf);
+	t->size *= 2;
+	t->buf = malloc(t->size);
+	if (!t->buf)
+	    return ACPI_ENOMEM;
+    }
+    return err;
+}
+
+static void bench_snapshot(void *arg)
+{
+    struct tree *t = arg;
+
+    snapshot(t->ctx, t);
+}
+
+static void bench_snapshot_uring(void *arg)
+{
+    struct tree *t = arg;
+
+    snapshot(t->uring_ctx, t);
+}
+
+/* the output of the acpi binary with -V, stdout goes to /dev/null */
+static void bench_print(void *arg)
+{
+    struct tree *t = arg;
+
+    print_battery_information(stdout, t->snap, TRUE, TRUE, NULL);
+    print_ac_adapter_information(stdout, t->snap, TRUE);
+    print_thermal_information(stdout, t->snap, TRUE, TEMP_CELSIUS, TRUE, NULL);
+    print_cooling_information(stdout, t->snap, TRUE, FALSE);
+    print_hwmon_information(stdout, t->snap, TRUE, TEMP_CELSIUS, TRUE);
+    print_powercap_information(stdout, t->snap, TRUE, TRUE);
+    print_throttle_information(stdout, t->snap, TRUE, TRUE);
+    fflush(stdout);
+}
+
+static int usage(void)
+{
+    fprintf(stderr,
+"Usage: acpibench [-p] [-i <iterations>] DIR\n"
+"Times scanning, parsing and printing the tree in DIR (see mktree) and writes\n"
+"name, devices, iterations and nanoseconds per iteration as tab separated lines.\n"
+"\n"
+"  -p            DIR is a /proc/acpi style tree\n"
+"  -i <count>    run every benchmark at least count times (default 1)\n"
+"  -H            print a header line\n");
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    struct tree t;
+    struct arena *arena;
+    int ch, err, type, header = FALSE;
+
+    memset(&t, 0, sizeof(t));
+    while ((ch = getopt(argc, argv, "pi:H")) != -1) {
+	switch (ch) {
+	    case 'p':
+		t.proc_interface = TRUE;
+		break;
+	    case 'i':
+		min_iterations = atoi(optarg);
+		break;
+	    case 'H':
+		header = TRUE;
+		break;
+	    default:
+		return usage();
+	}
+    }
+    if (optind != argc - 1)
+	return usage();
+
+    /* keep the results on the real stdout and throw away what we print */
+    results = fdopen(dup(STDOUT_FILENO), "w");
+    if (!results || !freopen("/dev/null", "w", stdout)) {
+	perror("acpibench");
+	return 1;
+    }
+
+    t.rootfd = open(argv[optind], O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    err = acpi_open(argv[optind], t.proc_interface ? ACPI_PROC : 0, &t.ctx);
+    if (t.rootfd < 0 || err != ACPI_OK) {
+	fprintf(stderr, "acpibench: cannot open %s\n", argv[optind]);
+	return 1;
+    }
+    acpi_open(argv[optind], ACPI_URING | (t.proc_interface ? ACPI_PROC : 0), &t.uring_ctx);
+    t.size = BUF_SIZE * 16;
+    t.buf = malloc(t.size);
+    arena = arena_new();
+    if (!t.buf || !arena) {
+	fprintf(stderr, "acpibench: out of memory\n");
+	return 1;
+    }
+
+    if (snapshot(t.ctx, &t) != ACPI_OK) {
+	fprintf(stderr, "acpibench: cannot read %s\n", argv[optind]);
+	return 1;
+    }
+    for (type = 0; type < ACPI_CLASSES; type++)
+	if (acpi_count(t.snap, type) > 0)
+	    num_devices += acpi_count(t.snap, type);
+
+    if (header)
+	fprintf(results, "benchmark\tdevices\titerations\tns_per_op\n");
+    run("enumerate", bench_enumerate, &t);
+    run("read", bench_read, &t);
+    run("parse", bench_parse, arena);
+    run("snapshot", bench_snapshot, &t);
+    run("snapshot_uring", bench_snapshot_uring, &t);
+    snapshot(t.ctx, &t);
+    run("print", bench_print, &t);
+
+    arena_free(arena);
+    free(t.buf);
+    acpi_close(t.uring_ctx);
+    acpi_close(t.ctx);
+    close(t.rootfd);
+    fclose(results);
+    return 0;
+}
@@ -0,0 +1,435 @@
+/* writes a fake /sys/class or /proc/acpi tree for benchmarking
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <getopt.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define MIX_CHARGE	0
+#define MIX_ENERGY	1
+#define MIX_MIXED	2
+
+/* room for a class directory plus a device and an attribute name */
+#define CLASS_SIZE	4096
+#define DIR_SIZE	(CLASS_SIZE + 64)
+#define PATH_SIZE	(DIR_SIZE + 64)
+
+static char path[PATH_SIZE];
+
+static void mkdir_or_die(const char *dir)
+{
+	if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+		fprintf(stderr, "mktree: cannot create %s: %s\n", dir, strerror(errno));
+		exit(1);
+	}
+}
+
+static void write_file(const char *dir, const char *name, const char *fmt, ...)
+	__attribute__((format(printf, 3, 4)));
+
+static void write_file(const char *dir, const char *name, const char *fmt, ...)
+{
+	va_list ap;
+	FILE *f;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	f = fopen(path, "w");
+	if (!f) {
+		fprintf(stderr, "mktree: cannot write %s: %s\n", path, strerror(errno));
+		exit(1);
+	}
+	va_start(ap, fmt);
+	vfprintf(f, fmt, ap);
+	va_end(ap);
+	fclose(f);
+}
+
+static void sys_battery(const char *class, int n, int mix)
+{
+	char dir[DIR_SIZE];
+	int energy = mix == MIX_ENERGY || (mix == MIX_MIXED && n % 2);
+
+	snprintf(dir, sizeof(dir), "%s/BAT%d", class, n);
+	mkdir_or_die(dir);
+	write_file(dir, "type", "Battery\n");
+	write_file(dir, "status", "%s\n", n % 3 ? "Discharging" : "Charging");
+	write_file(dir, "voltage_now", "%d\n", 11000000 + n % 1000 * 1000);
+	write_file(dir, "voltage_min_design", "10800000\n");
+	if (energy) {
+		write_file(dir, "energy_now", "%d\n", 20000000 + n % 100 * 100000);
+		write_file(dir, "energy_full", "50000000\n");
+		write_file(dir, "energy_full_design", "57000000\n");
+		write_file(dir, "power_now", "%d\n", 8000000 + n % 50 * 100000);
+	} else {
+		write_file(dir, "charge_now", "%d\n", 2000000 + n % 100 * 10000);
+		write_file(dir, "charge_full", "4000000\n");
+		write_file(dir, "charge_full_design", "4400000\n");
+		write_file(dir, "current_now", "%d\n", 1000000 + n % 50 * 10000);
+	}
+}
+
+static void sys_adapter(const char *class, int n)
+{
+	char dir[DIR_SIZE];
+
+	snprintf(dir, sizeof(dir), "%s/AC%d", class, n);
+	mkdir_or_die(dir);
+	write_file(dir, "type", "Mains\n");
+	write_file(dir, "online", "%d\n", n % 2);
+}
+
+static void sys_thermal(const char *class, int n, int trip_points)
+{
+	char dir[DIR_SIZE], name[64];
+	int i;
+
+	snprintf(dir, sizeof(dir), "%s/thermal_zone%d", class, n);
+	mkdir_or_die(dir);
+	write_file(dir, "type", "acpitz\n");
+	write_file(dir, "temp", "%d\n", 30000 + n % 60 * 1000);
+	for (i = 0; i < trip_points; i++) {
+		snprintf(name, sizeof(name), "trip_point_%d_type", i);
+		write_file(dir, name, "%s\n", i ? "passive" : "critical");
+		snprintf(name, sizeof(name), "trip_point_%d_temp", i);
+		write_file(dir, name, "%d\n", i ? 90000 - i * 5000 : 105000);
+		snprintf(name, sizeof(name), "trip_point_%d_hyst", i);
+		write_file(dir, name, "%d\n", i ? 2000 : 0);
+	}
+}
+
+/* stats/ in the layout of the kernel, a processor has the larger tables */
+static void sys_cooling_stats(const char *dir, int n, int states)
+{
+	char stats[PATH_SIZE], table[4096];
+	int i, j, len, total = 0;
+
+	snprintf(stats, sizeof(stats), "%s/stats", dir);
+	mkdir_or_die(stats);
+	for (i = 0, len = 0; i < states; i++)
+		len += snprintf(table + len, sizeof(table) - len, "state%d\t%d\n", i, (n + 1) * 1000 / (i + 1));
+	write_file(stats, "time_in_state_ms", "%s", table);
+	len = snprintf(table, sizeof(table), " From  :    To\n       : ");
+	for (i = 0; i < states; i++)
+		len += snprintf(table + len, sizeof(table) - len, "state%2d  ", i);
+	len += snprintf(table + len, sizeof(table) - len, "\n");
+	for (i = 0; i < states; i++) {
+		len += snprintf(table + len, sizeof(table) - len, "state%2d:", i);
+		for (j = 0; j < states; j++) {
+			len += snprintf(table + len, sizeof(table) - len, "%8d ", i == j + 1 || j == i + 1 ? n + 1 : 0);
+			total += i == j + 1 || j == i + 1 ? n + 1 : 0;
+		}
+		len += snprintf(table + len, sizeof(table) - len, "\n");
+	}
+	write_file(stats, "trans_table", "%s", table);
+	write_file(stats, "total_trans", "%d\n", total);
+}
+
+static void sys_cooling(const char *class, int n)
+{
+	char dir[DIR_SIZE];
+
+	snprintf(dir, sizeof(dir), "%s/cooling_device%d", class, n);
+	mkdir_or_die(dir);
+	write_file(dir, "type", "%s\n", n % 2 ? "Fan" : "Processor");
+	write_file(dir, "cur_state", "%d\n", n % 4);
+	write_file(dir, "max_state", "%d\n", n % 2 ? 1 : 10);
+	sys_cooling_stats(dir, n, n % 2 ? 2 : 11);
+}
+
+static void sys_hwmon(const char *class, int n, int sensors)
+{
+	char dir[DIR_SIZE], name[64];
+	int i;
+
+	snprintf(dir, sizeof(dir), "%s/hwmon%d", class, n);
+	mkdir_or_die(dir);
+	write_file(dir, "name", "%s\n", n % 2 ? "nct6775" : "coretemp");
+	for (i = 1; i <= sensors; i++) {
+		snprintf(name, sizeof(name), "temp%d_input", i);
+		write_file(dir, name, "%d\n", 30000 + (n + i) % 60 * 1000);
+		snprintf(name, sizeof(name), "temp%d_label", i);
+		write_file(dir, name, "Core %d\n", i - 1);
+		snprintf(name, sizeof(name), "temp%d_max", i);
+		write_file(dir, name, "%d\n", 80000);
+		snprintf(name, sizeof(name), "temp%d_crit", i);
+		write_file(dir, name, "%d\n", 100000);
+		snprintf(name, sizeof(name), "fan%d_input", i);
+		write_file(dir, name, "%d\n", 800 + i * 100);
+		snprintf(name, sizeof(name), "power%d_input", i);
+		write_file(dir, name, "%d\n", 5000000 + i * 250000);
+	}
+}
+
+/* a package zone with a core and a dram subzone for every third one */
+static void sys_powercap(const char *class, int n)
+{
+	char dir[DIR_SIZE];
+
+	if (n % 3 == 0)
+		snprintf(dir, sizeof(dir), "%s/intel-rapl:%d", class, n / 3);
+	else
+		snprintf(dir, sizeof(dir), "%s/intel-rapl:%d:%d", class, n / 3, n % 3 - 1);
+	mkdir_or_die(dir);
+	write_file(dir, "name", "%s\n", n % 3 == 0 ? "package" : n % 3 == 1 ? "core" : "dram");
+	write_file(dir, "energy_uj", "%lld\n", 1000000LL * (n + 1) * 1234);
+	write_file(dir, "max_energy_range_uj", "%lld\n", 262143328850LL);
+}
+
+/* two packages of cores with two threads each, the second thread of a
+ * core is in the upper half like on most machines; every fifth core was
+ * throttled */
+static void sys_cpu(const char *cpus_dir, int n, int cpus)
+{
+	char dir[DIR_SIZE], sub[DIR_SIZE + 32];
+	int cores = (cpus + 1) / 2, packages = cores >= 2 ? 2 : 1;
+	int per_package = (cores + packages - 1) / packages, core = n % cores;
+	int package = core / per_package, throttled = core % 5 == 0;
+
+	snprintf(dir, sizeof(dir), "%s/cpu%d", cpus_dir, n);
+	mkdir_or_die(dir);
+	write_file(dir, "online", "1\n");
+	snprintf(sub, sizeof(sub), "%s/topology", dir);
+	mkdir_or_die(sub);
+	write_file(sub, "physical_package_id", "%d\n", package);
+	write_file(sub, "core_id", "%d\n", core % per_package);
+	snprintf(sub, sizeof(sub), "%s/thermal_throttle", dir);
+	mkdir_or_die(sub);
+	write_file(sub, "core_throttle_count", "%d\n", throttled ? 10 + core : 0);
+	write_file(sub, "core_throttle_total_time_ms", "%d\n", throttled ? 100 * (10 + core) : 0);
+	write_file(sub, "core_throttle_max_time_ms", "%d\n", throttled ? 250 : 0);
+	write_file(sub, "package_throttle_count", "%d\n", 1000 + package);
+	write_file(sub, "package_throttle_total_time_ms", "%d\n", 40000 + package * 1000);
+	write_file(sub, "package_throttle_max_time_ms", "%d\n", 500);
+}
+
+static void proc_battery(const char *class, int n, int mix)
+{
+	char dir[DIR_SIZE];
+	const char *unit = mix == MIX_ENERGY || (mix == MIX_MIXED && n % 2) ? "mWh" : "mAh";
+
+	snprintf(dir, sizeof(dir), "%s/BAT%d", class, n);
+	mkdir_or_die(dir);
+	write_file(dir, "info",
+		   "present:                 yes\n"
+		   "design capacity:         4400 %s\n"
+		   "last full capacity:      4000 %s\n"
+		   "battery technology:      rechargeable\n"
+		   "design voltage:          10800 mV\n"
+		   "design capacity warning: 200 %s\n"
+		   "design capacity low:     100 %s\n"
+		   "model number:            BAT%d\n"
+		   "battery type:            LION\n", unit, unit, unit, unit, n);
+	write_file(dir, "state",
+		   "present:                 yes\n"
+		   "capacity state:          ok\n"
+		   "charging state:          %s\n"
+		   "present rate:            %d %c\n"
+		   "remaining capacity:      %d %s\n"
+		   "present voltage:         12000 mV\n",
+		   n % 3 ? "discharging" : "charging", 1500 + n % 50 * 10, unit[1] == 'W' ? 'W' : 'A',
+		   2000 + n % 100 * 10, unit);
+}
+
+static void proc_adapter(const char *class, int n)
+{
+	char dir[DIR_SIZE];
+
+	snprintf(dir, sizeof(dir), "%s/AC%d", class, n);
+	mkdir_or_die(dir);
+	write_file(dir, "state", "state:                   %s\n", n % 2 ? "on-line" : "off-line");
+}
+
+static void proc_thermal(const char *class, int n, int decikelvin)
+{
+	char dir[DIR_SIZE];
+
+	snprintf(dir, sizeof(dir), "%s/THM%d", class, n);
+	mkdir_or_die(dir);
+	if (decikelvin)
+		write_file(dir, "temperature", "temperature:             %d dK\n", 3031 + n % 60 * 10);
+	else
+		write_file(dir, "temperature", "temperature:             %d C\n", 30 + n % 60);
+	write_file(dir, "state", "state:                   ok\n");
+	write_file(dir, "cooling_mode", "cooling mode:            passive\n");
+}
+
+static void proc_fan(const char *class, int n)
+{
+	char dir[DIR_SIZE];
+
+	snprintf(dir, sizeof(dir), "%s/FAN%d", class, n);
+	mkdir_or_die(dir);
+	write_file(dir, "state", "status:                  %s\n", n % 2 ? "on" : "off");
+}
+
+static int usage(void)
+{
+	fprintf(stderr,
+"Usage: mktree [OPTION]... DIR\n"
+"Writes a fake /sys/class (or with -p /proc/acpi) tree to DIR.\n"
+"\n"
+"  -n <count>    devices of every class, 1 to 10000 (default 1)\n"
+"  -b <count>    batteries\n"
+"  -a <count>    ac adapters\n"
+"  -t <count>    thermal zones\n"
+"  -c <count>    cooling devices\n"
+"  -r <count>    trip points per thermal zone (default 2)\n"
+"  -H <count>    hwmon chips\n"
+"  -s <count>    temperature, fan and power sensors of each per hwmon chip (default 3)\n"
+"  -z <count>    powercap zones\n"
+"  -x <count>    cpus with thermal throttle counters, in DIR/../devices/system/cpu\n"
+"  -m <mix>      battery attributes: charge, energy or mixed (default mixed)\n"
+"  -k            /proc temperatures in decikelvin instead of celsius\n"
+"  -p            write a /proc/acpi style tree\n");
+	return 1;
+}
+
+static int count_arg(const char *arg)
+{
+	int n = atoi(arg);
+
+	if (n < 0 || n > 10000) {
+		fprintf(stderr, "mktree: device count %s out of range\n", arg);
+		exit(1);
+	}
+	return n;
+}
+
+int main(int argc, char *argv[])
+{
+	int batteries = 1, adapters = 1, thermal = 1, cooling = 1, trip_points = 2;
+	int hwmon = 1, sensors = 3, zones = 1, cpus = 0;
+	int mix = MIX_MIXED, decikelvin = 0, proc_interface = 0;
+	char class[CLASS_SIZE];
+	int ch, i;
+
+	while ((ch = getopt(argc, argv, "n:b:a:t:c:r:H:s:z:x:m:kp")) != -1) {
+		switch (ch) {
+			case 'n':
+				batteries = adapters = thermal = cooling = hwmon = zones = count_arg(optarg);
+				break;
+			case 'b':
+				batteries = count_arg(optarg);
+				break;
+			case 'a':
+				adapters = count_arg(optarg);
+				break;
+			case 't':
+				thermal = count_arg(optarg);
+				break;
+			case 'c':
+				cooling = count_arg(optarg);
+				break;
+			case 'r':
+				trip_points = atoi(optarg);
+				break;
+			case 'H':
+				hwmon = count_arg(optarg);
+				break;
+			case 's':
+				sensors = atoi(optarg);
+				break;
+			case 'z':
+				zones = count_arg(optarg);
+				break;
+			case 'x':
+				cpus = count_arg(optarg);
+				break;
+			case 'm':
+				if (!strcmp(optarg, "charge"))
+					mix = MIX_CHARGE;
+				else if (!strcmp(optarg, "energy"))
+					mix = MIX_ENERGY;
+				else if (!strcmp(optarg, "mixed"))
+					mix = MIX_MIXED;
+				else
+					return usage();
+				break;
+			case 'k':
+				decikelvin = 1;
+				break;
+			case 'p':
+				proc_interface = 1;
+				break;
+			default:
+				return usage();
+		}
+	}
+	if (optind != argc - 1)
+		return usage();
+
+	mkdir_or_die(argv[optind]);
+	if (proc_interface) {
+		snprintf(class, sizeof(class), "%s/battery", argv[optind]);
+		mkdir_or_die(class);
+		for (i = 0; i < batteries; i++)
+			proc_battery(class, i, mix);
+		snprintf(class, sizeof(class), "%s/ac_adapter", argv[optind]);
+		mkdir_or_die(class);
+		for (i = 0; i < adapters; i++)
+			proc_adapter(class, i);
+		snprintf(class, sizeof(class), "%s/thermal_zone", argv[optind]);
+		mkdir_or_die(class);
+		for (i = 0; i < thermal; i++)
+			proc_thermal(class, i, decikelvin);
+		snprintf(class, sizeof(class), "%s/fan", argv[optind]);
+		mkdir_or_die(class);
+		for (i = 0; i < cooling; i++)
+			proc_fan(class, i);
+	} else {
+		snprintf(class, sizeof(class), "%s/power_supply", argv[optind]);
+		mkdir_or_die(class);
+		for (i = 0; i < batteries; i++)
+			sys_battery(class, i, mix);
+		for (i = 0; i < adapters; i++)
+			sys_adapter(class, i);
+		snprintf(class, sizeof(class), "%s/thermal", argv[optind]);
+		mkdir_or_die(class);
+		for (i = 0; i < thermal; i++)
+			sys_thermal(class, i, trip_points);
+		for (i = 0; i < cooling; i++)
+			sys_cooling(class, i);
+		snprintf(class, sizeof(class), "%s/hwmon", argv[optind]);
+		mkdir_or_die(class);
+		for (i = 0; i < hwmon; i++)
+			sys_hwmon(class, i, sensors);
+		snprintf(class, sizeof(class), "%s/powercap", argv[optind]);
+		mkdir_or_die(class);
+		for (i = 0; i < zones; i++)
+			sys_powercap(class, i);
+		if (cpus) {
+			snprintf(class, sizeof(class), "%s/../devices", argv[optind]);
+			mkdir_or_die(class);
+			snprintf(class, sizeof(class), "%s/../devices/system", argv[optind]);
+			mkdir_or_die(class);
+			snprintf(class, sizeof(class), "%s/../devices/system/cpu", argv[optind]);
+			mkdir_or_die(class);
+			for (i = 0; i < cpus; i++)
+				sys_cpu(class, i, cpus);
+		}
+	}
+	return 0;
+}
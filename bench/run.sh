@@ -0,0 +1,21 @@
+#!/bin/sh
+# generates trees of growing size and runs acpibench on each of them,
+# the tab separated results go to stdout
+#
+# usage: run.sh MKTREE ACPIBENCH [SIZES]
+
+MKTREE=$1
+ACPIBENCH=$2
+SIZES=${3:-"1 10 100 1000 2500"}
+
+TMP=`mktemp -d ${TMPDIR:-/tmp}/acpibench.XXXXXX` || exit 1
+trap 'rm -rf "$TMP"' 0 1 2 15
+
+printf 'tree\tbenchmark\tdevices\titerations\tns_per_op\n'
+for n in $SIZES; do
+	"$MKTREE" -n $n "$TMP/sys-$n" || exit 1
+	"$ACPIBENCH" "$TMP/sys-$n" | sed 's/^/sys\t/' || exit 1
+	"$MKTREE" -p -n $n "$TMP/proc-$n" || exit 1
+	"$ACPIBENCH" -p "$TMP/proc-$n" | sed 's/^/proc\t/' || exit 1
+	rm -rf "$TMP/sys-$n" "$TMP/proc-$n"
+done
@@ -0,0 +1,406 @@
+/* serves cached snapshots over a unix socket so that several clients
+ * cost only one scan
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "acpi.h"
+#include "report.h"
+
+/* the protocol is one line each way followed by the output:
+ *
+ *   client: acpi <format> <classes> <empty> <details> <units> <proc> <path>\n
+ *   daemon: OK <classes without support>\n<output>  or  ERR <reason>\n
+ *
+ * the daemon closes the connection after answering; it waits for the
+ * requests of all clients at once, so one that connects and sends
+ * nothing holds up nobody */
+
+#define IO_TIMEOUT	1	/* seconds a client may take to talk to us */
+#define MAX_CLIENTS	64	/* connections whose request is not complete yet, the
+				   oldest one is dropped for a new one */
+
+/* a connection that has not sent all of its request yet */
+struct client {
+    int fd;
+    size_t len;
+    double deadline;
+    char line[REQUEST_SIZE];
+};
+
+/* what the daemon serves and the snapshot it has */
+struct server {
+    struct acpi_context *ctx;
+    const char *path;
+    int proc_interface;
+    double ttl;
+    struct acpi_snapshot *snap;
+    void *buf;
+    size_t size;
+    double taken;
+    struct report r;
+};
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int socket_address(const char *socket_path, struct sockaddr_un *addr)
+{
+    memset(addr, 0, sizeof(struct sockaddr_un));
+    addr->sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr->sun_path))
+	return -1;
+    strcpy(addr->sun_path, socket_path);
+    return 0;
+}
+
+static void set_timeout(int fd)
+{
+    struct timeval tv = { IO_TIMEOUT, 0 };
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+/* read what the client sent so far without waiting for more, returns 1
+ * once the line is complete, without its newline, 0 if it is not yet or
+ * -1 if the client went away or sent too much */
+static int read_request(struct client *c)
+{
+    ssize_t n;
+    char *nl;
+
+    n = recv(c->fd, c->line + c->len, sizeof(c->line) - 1 - c->len, MSG_DONTWAIT);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+	return 0;
+    if (n <= 0)
+	return -1;
+    c->len += n;
+    nl = memchr(c->line, '\n', c->len);
+    if (!nl)
+	return c->len < sizeof(c->line) - 1 ? 0 : -1;
+    *nl = '\0';
+    return 1;
+}
+
+static int write_all(int fd, const char *buf, size_t len)
+{
+    ssize_t n;
+
+    while (len > 0) {
+	n = write(fd, buf, len);
+	if (n < 0 && errno == EINTR)
+	    continue;
+	if (n <= 0)
+	    return -1;
+	buf += n;
+	len -= n;
+    }
+    return 0;
+}
+
+static void answer(int fd, struct report *r, const struct acpi_snapshot *snap, const char *line,
+		   const char *path, int proc_interface)
+{
+    struct request q;
+    int n = 0, type, unsupported = 0;
+
+    if (sscanf(line, "acpi %d %d %d %d %d %d %n", &q.format, &q.classes, &q.show_empty_slots,
+	       &q.show_details, &q.temp_units, &q.proc_interface, &n) != 6 || !n) {
+	report_puts(r, "ERR invalid request\n");
+	return;
+    }
+    q.path = line + n;
+    q.tag_root = FALSE;
+    q.trends = NULL;
+    if (strcmp(q.path, path) != 0 || q.proc_interface != proc_interface) {
+	report_puts(r, "ERR different path\n");
+	return;
+    }
+    if (!snap) {
+	report_puts(r, "ERR no snapshot\n");
+	return;
+    }
+
+    for (type = 0; type < ACPI_CLASSES; type++)
+	if ((q.classes & ACPI_CLASS(type)) && acpi_count(snap, type) == ACPI_ENODEV)
+	    unsupported |= ACPI_CLASS(type);
+    report_printf(r, "OK %d\n", unsupported);
+    render_snapshot(r, snap, &q);
+    if (r->failed) {
+	report_reset(r);
+	report_puts(r, "ERR out of memory\n");
+    }
+}
+
+static int socket_in_use(struct sockaddr_un *addr)
+{
+    int fd, rval;
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+	return FALSE;
+    rval = connect(fd, (struct sockaddr *) addr, sizeof(struct sockaddr_un)) == 0;
+    close(fd);
+    return rval;
+}
+
+/* bind the socket, replacing it if it was left behind by a daemon that is
+ * gone but not if another one still answers on it */
+static int listen_socket(const char *socket_path)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    if (socket_address(socket_path, &addr) < 0) {
+	fprintf(stderr, "Socket path too long: %s\n", socket_path);
+	return -1;
+    }
+    /* non-blocking, a client that is gone before it is accepted must not
+     * hold up the others */
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+	perror("socket");
+	return -1;
+    }
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+	if (errno == EADDRINUSE && socket_in_use(&addr)) {
+	    fprintf(stderr, "Another daemon is listening on %s\n", socket_path);
+	    close(fd);
+	    return -1;
+	}
+	unlink(socket_path);
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+	    fprintf(stderr, "Cannot bind %s: %s\n", socket_path, strerror(errno));
+	    close(fd);
+	    return -1;
+	}
+    }
+    /* everybody may read what we serve */
+    chmod(socket_path, 0666);
+    if (listen(fd, SOMAXCONN) < 0) {
+	fprintf(stderr, "Cannot listen on %s: %s\n", socket_path, strerror(errno));
+	close(fd);
+	unlink(socket_path);
+	return -1;
+    }
+    return fd;
+}
+
+/* answer a complete request, one scan per ttl however many clients ask */
+static void serve(struct server *d, int fd, const char *line)
+{
+    if (!d->snap || now() - d->taken >= d->ttl) {
+	if (take_snapshot(d->ctx, ACPI_ALL_CLASSES, &d->buf, &d->size, &d->snap) != ACPI_OK)
+	    d->snap = NULL;
+	d->taken = now();
+    }
+    /* the request was read without blocking, the answer is written with
+     * the timeout of set_timeout() */
+    answer(fd, &d->r, d->snap, line, d->path, d->proc_interface);
+    report_write(&d->r, fd);
+}
+
+static void drop_client(struct client *clients, int *num, int i)
+{
+    close(clients[i].fd);
+    clients[i] = clients[--*num];
+}
+
+/* take a new connection and answer it right away if its request is there */
+static void add_client(struct server *d, struct client *clients, int *num, int fd)
+{
+    struct client *c;
+    int i, oldest = 0;
+
+    if (*num == MAX_CLIENTS) {
+	for (i = 1; i < *num; i++)
+	    if (clients[i].deadline < clients[oldest].deadline)
+		oldest = i;
+	drop_client(clients, num, oldest);
+    }
+    set_timeout(fd);
+    c = &clients[(*num)++];
+    c->fd = fd;
+    c->len = 0;
+    c->deadline = now() + IO_TIMEOUT;
+    switch (read_request(c)) {
+    case 1:
+	serve(d, fd, c->line);
+	/* fall through */
+    case -1:
+	drop_client(clients, num, *num - 1);
+	break;
+    }
+}
+
+int daemon_serve(struct acpi_context *ctx, const char *socket_path, const char *path, int proc_interface, double ttl)
+{
+    struct server d;
+    struct client *clients;
+    struct pollfd pfd[MAX_CLIENTS + 1];
+    struct sigaction sa;
+    double t, first;
+    int lfd, fd, i, n, num = 0, timeout;
+
+    lfd = listen_socket(socket_path);
+    if (lfd < 0)
+	return 1;
+    memset(&d, 0, sizeof(d));
+    d.ctx = ctx;
+    d.path = path;
+    d.proc_interface = proc_interface;
+    d.ttl = ttl;
+    clients = malloc(MAX_CLIENTS * sizeof(struct client));
+    if (!clients || report_init(&d.r, BUF_SIZE * 16) < 0) {
+	fprintf(stderr, "Out of memory in daemon_serve()\n");
+	free(clients);
+	close(lfd);
+	unlink(socket_path);
+	return 1;
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &sa, NULL);
+    /* poll() has to return so that we can clean up */
+    catch_stop();
+
+    while (!stop_requested()) {
+	pfd[0].fd = lfd;
+	pfd[0].events = POLLIN;
+	for (i = 0, first = 0; i < num; i++) {
+	    pfd[i + 1].fd = clients[i].fd;
+	    pfd[i + 1].events = POLLIN;
+	    if (!i || clients[i].deadline < first)
+		first = clients[i].deadline;
+	}
+	t = now();
+	timeout = !num ? -1 : first <= t ? 0 : (int) ((first - t) * 1000) + 1;
+	n = poll(pfd, num + 1, timeout);
+	if (n < 0)
+	    continue;
+
+	/* backwards, a dropped client is replaced by the last one, which
+	 * was looked at already */
+	t = now();
+	for (i = num - 1; i >= 0; i--) {
+	    if (pfd[i + 1].revents) {
+		n = read_request(&clients[i]);
+		if (n > 0)
+		    serve(&d, clients[i].fd, clients[i].line);
+		if (n != 0) {
+		    drop_client(clients, &num, i);
+		    continue;
+		}
+	    }
+	    if (t >= clients[i].deadline)
+		drop_client(clients, &num, i);
+	}
+
+	if (pfd[0].revents & POLLIN) {
+	    fd = accept(lfd, NULL, NULL);
+	    if (fd >= 0)
+		add_client(&d, clients, &num, fd);
+	}
+    }
+
+    while (num > 0)
+	drop_client(clients, &num, num - 1);
+    free(clients);
+    close(lfd);
+    unlink(socket_path);
+    report_free(&d.r);
+    free(d.buf);
+    return 0;
+}
+
+int daemon_query(const char *socket_path, const struct request *q, struct report *r, int *unsupported)
+{
+    struct sockaddr_un addr;
+    char line[REQUEST_SIZE], *nl;
+    ssize_t n;
+    int fd, len;
+
+    if (socket_address(socket_path, &addr) < 0)
+	return -1;
+    len = snprintf(line, sizeof(line), "acpi %d %d %d %d %d %d %s\n", q->format, q->classes,
+		   q->show_empty_slots, q->show_details, q->temp_units, q->proc_interface, q->path);
+    if (len >= sizeof(line) || strchr(q->path, '\n'))
+	return -1;
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+	return -1;
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+	close(fd);
+	return -1;
+    }
+    set_timeout(fd);
+    if (write_all(fd, line, len) < 0) {
+	close(fd);
+	return -1;
+    }
+
+    report_reset(r);
+    for (;;) {
+	if (report_reserve(r, BUF_SIZE) < 0) {
+	    close(fd);
+	    return -1;
+	}
+	n = read(fd, r->buf + r->len, r->size - r->len - 1);
+	if (n < 0 && errno == EINTR)
+	    continue;
+	if (n < 0) {
+	    close(fd);
+	    return -1;
+	}
+	if (n == 0)
+	    break;
+	r->len += n;
+    }
+    close(fd);
+
+    /* the status line comes first, the output follows it */
+    r->buf[r->len] = '\0';
+    nl = memchr(r->buf, '\n', r->len);
+    if (!nl || sscanf(r->buf, "OK %d", unsupported) != 1)
+	return -1;
+    r->len -= nl + 1 - r->buf;
+    memmove(r->buf, nl + 1, r->len);
+    return 0;
+}
@@ -0,0 +1,194 @@
+/* change notifications from kernel uevents or inotify
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include "events.h"
+
+#define UEVENT_GROUP_KERNEL	1
+#define EVENT_BUF_SIZE		8192
+
+#define DIR_EVENTS	(IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR)
+#define DEVICE_EVENTS	(IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_ONLYDIR)
+
+struct events {
+    int fd;
+    int uevent;		/* fd is a netlink socket instead of an inotify instance */
+};
+
+static int is_real_sys(const char *path, int proc_interface)/*{{{*/
+{
+    char *real;
+    int rval;
+
+    if (proc_interface)
+	return 0;
+    real = realpath(path, NULL);
+    rval = real && !strcmp(real, "/sys/class");
+    free(real);
+    return rval;
+}
+
+static int uevent_socket(void)/*{{{*/
+{
+    struct sockaddr_nl addr;
+    int fd;
+
+    fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (fd < 0)
+	return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = UEVENT_GROUP_KERNEL;
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+	close(fd);
+	return -1;
+    }
+    return fd;
+}
+
+struct events *events_new(const char *path, int proc_interface)/*{{{*/
+{
+    struct events *e;
+
+    e = malloc(sizeof(struct events));
+    if (!e)
+	return NULL;
+    e->uevent = 0;
+    e->fd = -1;
+    /* sysfs does not support inotify, and uevents only describe sysfs */
+    if (is_real_sys(path, proc_interface)) {
+	e->fd = uevent_socket();
+	e->uevent = e->fd >= 0;
+    }
+    if (e->fd < 0)
+	e->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (e->fd < 0) {
+	free(e);
+	return NULL;
+    }
+    return e;
+}
+
+int events_fd(struct events *e)/*{{{*/
+{
+    return e->fd;
+}
+
+int events_add_dir(struct events *e, const char *path, int class_dir)/*{{{*/
+{
+    if (e->uevent)
+	return -1;
+    return inotify_add_watch(e->fd, path, class_dir ? DIR_EVENTS : DEVICE_EVENTS);
+}
+
+/* a uevent is "action@devpath" followed by KEY=value strings */
+static void uevent_parse(char *buf, size_t len, event_fn fn, void *arg)/*{{{*/
+{
+    struct event ev;
+    char *p, *action = NULL, *devpath = NULL;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.wd = -1;
+    for (p = buf; p < buf + len; p += strlen(p) + 1) {
+	if (!strncmp(p, "ACTION=", 7))
+	    action = p + 7;
+	else if (!strncmp(p, "DEVPATH=", 8))
+	    devpath = p + 8;
+	else if (!strncmp(p, "SUBSYSTEM=", 10))
+	    ev.subsystem = p + 10;
+    }
+    if (!action || !devpath || !ev.subsystem)
+	return;
+    ev.name = strrchr(devpath, '/');
+    ev.name = ev.name ? ev.name + 1 : devpath;
+    ev.structural = strcmp(action, "change") != 0;
+    fn(arg, &ev);
+}
+
+static int uevent_read(struct events *e, event_fn fn, void *arg)/*{{{*/
+{
+    char buf[EVENT_BUF_SIZE];
+    struct event ev;
+    ssize_t n;
+
+    for (;;) {
+	n = recv(e->fd, buf, sizeof(buf) - 1, 0);
+	if (n < 0 && errno == EINTR)
+	    continue;
+	if (n < 0 && errno == ENOBUFS) {
+	    /* the socket overran, we cannot know what we missed */
+	    memset(&ev, 0, sizeof(ev));
+	    ev.wd = -1;
+	    ev.overflow = 1;
+	    fn(arg, &ev);
+	    continue;
+	}
+	if (n < 0)
+	    return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+	buf[n] = '\0';
+	uevent_parse(buf, n, fn, arg);
+    }
+}
+
+static int inotify_read(struct events *e, event_fn fn, void *arg)/*{{{*/
+{
+    char buf[EVENT_BUF_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *in;
+    struct event ev;
+    ssize_t n;
+    char *p;
+
+    for (;;) {
+	n = read(e->fd, buf, sizeof(buf));
+	if (n < 0 && errno == EINTR)
+	    continue;
+	if (n < 0)
+	    return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+	for (p = buf; p < buf + n; p += sizeof(struct inotify_event) + in->len) {
+	    in = (const struct inotify_event *) p;
+	    if (in->mask & IN_IGNORED)
+		continue;
+	    memset(&ev, 0, sizeof(ev));
+	    ev.wd = in->wd;
+	    ev.overflow = (in->mask & IN_Q_OVERFLOW) != 0;
+	    ev.structural = (in->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)) != 0;
+	    fn(arg, &ev);
+	}
+    }
+}
+
+int events_read(struct events *e, event_fn fn, void *arg)/*{{{*/
+{
+    return e->uevent ? uevent_read(e, fn, arg) : inotify_read(e, fn, arg);
+}
+
+void events_free(struct events *e)/*{{{*/
+{
+    close(e->fd);
+    free(e);
+}
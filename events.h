@@ -0,0 +1,75 @@
+/* change notifications from kernel uevents or inotify
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#ifndef _EVENTS_H
+#define _EVENTS_H
+
+/* what changed, handed to the callback of events_read() */
+struct event {
+    int wd;			/* inotify watch, -1 for uevents */
+    const char *subsystem;	/* class directory of a uevent, NULL for inotify */
+    const char *name;		/* device of a uevent, NULL for inotify */
+    int structural;		/* devices came or went */
+    int overflow;		/* events were lost, everything may have changed */
+};
+
+typedef void (*event_fn)(void *arg, const struct event *ev);
+
+struct events;
+
+/* listen for changes below path, using kobject uevents if path is the
+ * real /sys/class and inotify otherwise
+ *
+ * Pre: path != NULL
+ * Post: returns the listener or NULL if neither is available
+ */
+struct events *events_new(const char *path, int proc_interface);
+
+/* the descriptor to poll for pending events
+ *
+ * Pre: e != NULL
+ * Post: returns a non-blocking descriptor
+ */
+int events_fd(struct events *e);
+
+/* start watching a class directory or a device directory, uevents need
+ * no watches
+ *
+ * Pre: e != NULL, path != NULL
+ * Post: returns the watch, -1 if there is none
+ */
+int events_add_dir(struct events *e, const char *path, int class_dir);
+
+/* read everything pending and call fn for each event
+ *
+ * Pre: e != NULL
+ * Post: returns 0, or -1 if reading failed
+ */
+int events_read(struct events *e, event_fn fn, void *arg);
+
+/* stop listening
+ *
+ * Pre: e != NULL
+ * Post: e is invalid
+ */
+void events_free(struct events *e);
+
+#endif
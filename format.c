@@ -0,0 +1,956 @@
+/* prints the information read by libacpi as json, csv or prometheus text,
+ * or collects the text output in memory
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "acpi.h"
+#include "stats.h"
+#include "report.h"
+
+#define VALUE_NONE	0
+#define VALUE_INT	1
+#define VALUE_FLOAT	2
+#define VALUE_STRING	3
+#define VALUE_LLONG	4	/* a counter that may not fit an int */
+
+#define MAX_VALUES	24
+
+struct value {
+    char *key;
+    int string;		/* a label in prometheus output, even if unknown */
+    int counter;	/* only grows but for a reset or wrap, a counter in prometheus output */
+    int type;
+    int i;
+    long long ll;
+    double f;
+    const char *s;
+};
+
+/* the computed values of one device, every device of a class gets the
+ * same keys in the same order */
+struct values {
+    int n;
+    struct value v[MAX_VALUES];
+    struct battery_status battery;
+};
+
+static char *class_name[ACPI_CLASSES] = { "battery", "ac_adapter", "thermal_zone", "cooling_device", "hwmon", "powercap", "cpu" };
+
+static char *sensor_type_name[SENSOR_TYPES] = { "temp", "fan", "power" };
+
+static void add_int(struct values *vals, char *key, int i, int known)
+{
+    struct value *v = &vals->v[vals->n++];
+
+    v->key = key;
+    v->string = FALSE;
+    v->counter = FALSE;
+    v->type = known ? VALUE_INT : VALUE_NONE;
+    v->i = i;
+}
+
+static void add_llong(struct values *vals, char *key, long long ll, int known)
+{
+    struct value *v = &vals->v[vals->n++];
+
+    v->key = key;
+    v->string = FALSE;
+    v->counter = FALSE;
+    v->type = known ? VALUE_LLONG : VALUE_NONE;
+    v->ll = ll;
+}
+
+static void add_float(struct values *vals, char *key, double f, int known)
+{
+    struct value *v = &vals->v[vals->n++];
+
+    v->key = key;
+    v->string = FALSE;
+    v->counter = FALSE;
+    v->type = known ? VALUE_FLOAT : VALUE_NONE;
+    v->f = f;
+}
+
+static void add_string(struct values *vals, char *key, const char *s)
+{
+    struct value *v = &vals->v[vals->n++];
+
+    v->key = key;
+    v->string = TRUE;
+    v->counter = FALSE;
+    v->type = s ? VALUE_STRING : VALUE_NONE;
+    v->s = s;
+}
+
+/* the value added last is a counter of the kernel */
+static void as_counter(struct values *vals)
+{
+    vals->v[vals->n - 1].counter = TRUE;
+}
+
+static char *temperature_key(int temp_units)
+{
+    switch (temp_units) {
+    case TEMP_CELSIUS:
+	return "temperature_celsius";
+    case TEMP_FAHRENHEIT:
+	return "temperature_fahrenheit";
+    }
+    return "temperature_kelvin";
+}
+
+/* the key of the values of a sensor type */
+static char *sensor_key(int type, int temp_units)
+{
+    switch (type) {
+    case SENSOR_TEMP:
+	return temperature_key(temp_units);
+    case SENSOR_FAN:
+	return "fan_rpm";
+    }
+    return "power_watts";
+}
+
+/* the input and the limits of a sensor in the order they are written,
+ * the limits get their prefix in front of the key; returns FALSE if the
+ * value is unknown */
+#define SENSOR_VALUES	3
+
+static int sensor_value(const struct sensor *s, int k, int temp_units, char **prefix, double *value)
+{
+    static char *prefixes[SENSOR_VALUES] = { "", "max_", "crit_" };
+    static int known[SENSOR_VALUES] = { SENSOR_INPUT, SENSOR_MAX, SENSOR_CRIT };
+    char *unit;
+
+    *prefix = prefixes[k];
+    *value = get_sensor_value(s, k == 0 ? s->input : k == 1 ? s->max : s->crit, &unit, temp_units);
+    return (s->known & known[k]) != 0;
+}
+
+/* the same devices are left out as in the text output */
+static int is_empty(const struct device_info *dev)
+{
+    switch (dev->type) {
+    case BATTERY:
+	return !dev->info.battery.state;
+    case AC_ADAPTER:
+	return !dev->info.ac_adapter.state;
+    case THERMAL_ZONE:
+	return !dev->info.thermal.state;
+    case COOLING_DEV:
+	return !dev->info.cooling.state && !dev->info.cooling.type;
+    case HWMON:
+    case POWERCAP:
+    case CPU:
+	return !dev->present;
+    }
+    return TRUE;
+}
+
+/* the window statistics of a device, unknown if it has none yet; temp_units
+ * is -1 if the values are no temperatures */
+static void add_window(struct values *vals, const struct window *w, char **keys, int temp_units)
+{
+    double x[6] = { 0, 0, 0, 0, 0, 0 };
+    char *scale;
+    int i;
+
+    if (w) {
+	x[0] = window_ewma(w);
+	x[1] = window_mean(w);
+	x[2] = window_min(w);
+	x[3] = window_max(w);
+	x[4] = window_quantile(w, WINDOW_MEDIAN);
+	x[5] = window_quantile(w, WINDOW_P90);
+    }
+    for (i = 0; i < 6; i++) {
+	if (w && temp_units >= 0)
+	    x[i] = get_real_temp(x[i], &scale, temp_units);
+	add_float(vals, keys[i], x[i], w != NULL);
+    }
+}
+
+static void get_values(const struct device_info *dev, int temp_units, const struct trends *trends, struct values *vals)
+{
+    static char *throttle_keys[THROTTLE_SCOPES][5] = {
+	{ "core_throttle_count", "core_throttle_total_ms", "core_throttle_max_ms",
+	  "core_throttle_count_delta", "core_throttle_total_delta_ms" },
+	{ "package_throttle_count", "package_throttle_total_ms", "package_throttle_max_ms",
+	  "package_throttle_count_delta", "package_throttle_total_delta_ms" }
+    };
+    static char *rate_keys[] = { "rate_smoothed", "rate_mean", "rate_min", "rate_max", "rate_median", "rate_p90" };
+    static char *temp_keys[] = { "temperature_smoothed", "temperature_mean", "temperature_min", "temperature_max",
+				 "temperature_median", "temperature_p90" };
+    const struct battery_info *b = &dev->info.battery;
+    const struct thermal_info *t = &dev->info.thermal;
+    const struct cooling_info *c = &dev->info.cooling;
+    const struct hwmon_info *h = &dev->info.hwmon;
+    const struct powercap_info *p = &dev->info.powercap;
+    const struct cpu_info *cpu = &dev->info.cpu;
+    const struct throttle *th;
+    const struct window *w = trends_find(trends, dev);
+    struct battery_status *s = &vals->battery, smoothed;
+    char *scale;
+    int i, sensors, known = !is_empty(dev);
+
+    vals->n = 0;
+    switch (dev->type) {
+    case BATTERY:
+	memset(s, 0, sizeof(struct battery_status));
+	memset(&smoothed, 0, sizeof(struct battery_status));
+	if (known) {
+	    get_battery_status(b, s);
+	    /* the times from the smoothed rate, the rate as it was read */
+	    get_smoothed_status(b, w, &smoothed);
+	}
+	add_string(vals, "state", b->state);
+	add_string(vals, "charging", !known ? NULL : b->charging == BATTERY_CHARGING ? "charging" :
+		   b->charging == BATTERY_DISCHARGING ? "discharging" : "unknown");
+	add_int(vals, "percentage", s->percentage, known);
+	add_int(vals, "seconds_remaining", smoothed.seconds,
+		known && b->charging == BATTERY_DISCHARGING && smoothed.seconds >= 0);
+	add_int(vals, "seconds_until_charged", smoothed.seconds,
+		known && b->charging == BATTERY_CHARGING && smoothed.seconds >= 0);
+	add_string(vals, "capacity_unit", known ? s->capacity_unit : NULL);
+	add_int(vals, "remaining_capacity", s->remaining_capacity, known && s->remaining_capacity >= 0);
+	add_int(vals, "present_rate", s->present_rate, known && s->present_rate >= 0);
+	add_int(vals, "last_capacity", s->last_capacity, known && s->last_capacity >= 0);
+	add_int(vals, "design_capacity", s->design_capacity, known && s->design_capacity >= 0);
+	add_int(vals, "health", s->health, known && s->health >= 0);
+	if (trends) {
+	    add_window(vals, w, rate_keys, -1);
+	    add_float(vals, "rate_stddev", w ? window_stddev(w) : 0, w != NULL);
+	}
+	break;
+    case AC_ADAPTER:
+	add_string(vals, "state", dev->info.ac_adapter.state);
+	add_int(vals, "online", known && !strcmp(dev->info.ac_adapter.state, "on-line"), known);
+	break;
+    case THERMAL_ZONE:
+	add_string(vals, "state", t->state);
+	add_float(vals, temperature_key(temp_units), get_real_temp(t->temperature, &scale, temp_units), known);
+	if (trends) {
+	    add_window(vals, w, temp_keys, temp_units);
+	    /* per minute, a difference needs no offset */
+	    add_float(vals, "temperature_trend_per_minute", w ? get_temp_delta(window_slope(w) * 60, temp_units) : 0,
+		      w && w->count > 1);
+	}
+	break;
+    case COOLING_DEV:
+	add_string(vals, "state", c->state);
+	add_string(vals, "type", c->type);
+	add_int(vals, "cur_state", c->cur_state, c->cur_state >= 0);
+	add_int(vals, "max_state", c->max_state, c->max_state >= 0);
+	add_llong(vals, "total_trans", c->stats.total_trans, c->stats.total_trans >= 0);
+	as_counter(vals);
+	add_llong(vals, "total_trans_delta", c->stats.total_trans_delta, c->stats.total_trans_delta >= 0);
+	add_int(vals, "interval_ms", (int) (c->stats.interval * 1000 + 0.5), c->stats.interval > 0);
+	break;
+    case HWMON:
+	for (i = 0, sensors = 0; i < h->sensors; i++)
+	    if (h->sensor[i].known & SENSOR_INPUT)
+		sensors++;
+	add_string(vals, "chip", h->name);
+	add_int(vals, "sensor_count", sensors, TRUE);
+	break;
+    case POWERCAP:
+	add_string(vals, "zone", p->name);
+	add_float(vals, "power_watts", p->power, known && p->power >= 0);
+	add_int(vals, "power_interval_ms", (int) (p->interval * 1000 + 0.5), known && p->power >= 0);
+	add_float(vals, "energy_joules", p->energy, known);
+	as_counter(vals);
+	add_float(vals, "max_energy_range_joules", p->max_range, known && p->max_range >= 0);
+	break;
+    case CPU:
+	add_int(vals, "package", cpu->package, cpu->package >= 0);
+	add_int(vals, "core", cpu->core, cpu->core >= 0);
+	for (i = 0; i < THROTTLE_SCOPES; i++) {
+	    th = &cpu->scope[i];
+	    add_llong(vals, throttle_keys[i][0], th->count, th->count >= 0);
+	    as_counter(vals);
+	    add_llong(vals, throttle_keys[i][1], th->total_ms, th->total_ms >= 0);
+	    as_counter(vals);
+	    add_llong(vals, throttle_keys[i][2], th->max_ms, th->max_ms >= 0);
+	    add_llong(vals, throttle_keys[i][3], th->count_delta, th->count_delta >= 0);
+	    add_llong(vals, throttle_keys[i][4], th->total_delta_ms, th->total_delta_ms >= 0);
+	}
+	add_int(vals, "interval_ms", (int) (cpu->interval * 1000 + 0.5), cpu->interval > 0);
+	break;
+    }
+}
+
+/* the trip points that the text output shows */
+static int show_trip_point(const struct thermal_info *t, int i)
+{
+    return t->trip[i].type && t->trip[i].temp >= MIN_TEMP;
+}
+
+static void json_string(struct report *r, const char *s)
+{
+    const char *p;
+
+    report_append(r, "\"", 1);
+    for (p = s; *p; p++) {
+	if (*p == '"' || *p == '\\')
+	    report_printf(r, "\\%c", *p);
+	else if ((unsigned char) *p < 0x20)
+	    report_printf(r, "\\u%04x", *p);
+	else
+	    report_append(r, p, 1);
+    }
+    report_append(r, "\"", 1);
+}
+
+static void json_value(struct report *r, const struct value *v)
+{
+    switch (v->type) {
+    case VALUE_INT:
+	report_printf(r, "%d", v->i);
+	break;
+    case VALUE_LLONG:
+	report_printf(r, "%lld", v->ll);
+	break;
+    case VALUE_FLOAT:
+	report_printf(r, "%.1f", v->f);
+	break;
+    case VALUE_STRING:
+	json_string(r, v->s);
+	break;
+    default:
+	report_puts(r, "null");
+	break;
+    }
+}
+
+static void json_device(struct report *r, const struct device_info *dev, int index, int temp_units,
+			const struct trends *trends)
+{
+    const struct thermal_info *t = &dev->info.thermal;
+    const struct cooling_stats *st = &dev->info.cooling.stats;
+    const struct hwmon_info *h = &dev->info.hwmon;
+    const struct sensor *s;
+    struct values vals;
+    char *scale, *prefix;
+    double value;
+    int i, k, first;
+
+    report_printf(r, "{\"index\":%d,\"name\":", index);
+    json_string(r, dev->name);
+    get_values(dev, temp_units, trends, &vals);
+    for (i = 0; i < vals.n; i++) {
+	report_printf(r, ",\"%s\":", vals.v[i].key);
+	json_value(r, &vals.v[i]);
+    }
+    if (dev->type == THERMAL_ZONE) {
+	report_puts(r, ",\"trip_points\":[");
+	for (i = 0, first = TRUE; i < t->trip_points; i++) {
+	    if (!show_trip_point(t, i))
+		continue;
+	    report_printf(r, "%s{\"index\":%d,\"type\":", first ? "" : ",", i);
+	    json_string(r, t->trip[i].type);
+	    report_printf(r, ",\"%s\":%.1f", temperature_key(temp_units),
+			  get_real_temp(t->trip[i].temp, &scale, temp_units));
+	    if (t->trip[i].hyst >= 0)
+		report_printf(r, ",\"hysteresis_%s\":%.1f", temperature_key(temp_units),
+			      get_temp_delta(t->trip[i].hyst, temp_units));
+	    report_puts(r, "}");
+	    first = FALSE;
+	}
+	report_puts(r, "]");
+    }
+    if (dev->type == COOLING_DEV && st->states) {
+	report_puts(r, ",\"states\":[");
+	for (i = 0, first = TRUE; st->time_in_state_ms && i < st->states; i++) {
+	    if (st->time_in_state_ms[i] < 0)
+		continue;
+	    report_printf(r, "%s{\"index\":%d,\"time_in_state_ms\":%lld", first ? "" : ",", i,
+			  st->time_in_state_ms[i]);
+	    if (st->time_in_state_delta_ms)
+		report_printf(r, ",\"time_in_state_delta_ms\":%lld", st->time_in_state_delta_ms[i]);
+	    report_puts(r, "}");
+	    first = FALSE;
+	}
+	/* the table of a device with many states is mostly zeros */
+	report_puts(r, "],\"transitions\":[");
+	for (i = 0, first = TRUE; st->trans_table && i < st->states * st->states; i++) {
+	    if (st->trans_table[i] <= 0)
+		continue;
+	    report_printf(r, "%s{\"from\":%d,\"to\":%d,\"count\":%lld", first ? "" : ",", i / st->states,
+			  i % st->states, st->trans_table[i]);
+	    if (st->trans_delta)
+		report_printf(r, ",\"delta\":%lld", st->trans_delta[i]);
+	    report_puts(r, "}");
+	    first = FALSE;
+	}
+	report_puts(r, "]");
+    }
+    if (dev->type == HWMON) {
+	report_puts(r, ",\"sensors\":[");
+	for (i = 0, first = TRUE; i < h->sensors; i++) {
+	    s = &h->sensor[i];
+	    if (!(s->known & SENSOR_INPUT))
+		continue;
+	    report_printf(r, "%s{\"type\":\"%s\",\"index\":%d,\"label\":", first ? "" : ",",
+			  sensor_type_name[s->type], s->index);
+	    if (s->label)
+		json_string(r, s->label);
+	    else
+		report_puts(r, "null");
+	    for (k = 0; k < SENSOR_VALUES; k++)
+		if (sensor_value(s, k, temp_units, &prefix, &value))
+		    report_printf(r, ",\"%s%s\":%.1f", prefix, sensor_key(s->type, temp_units), value);
+	    report_puts(r, "}");
+	    first = FALSE;
+	}
+	report_puts(r, "]");
+    }
+    /* raw attributes as pairs, the /proc files may repeat a name */
+    report_puts(r, ",\"attributes\":[");
+    for (i = 0; i < dev->num_fields; i++) {
+	report_puts(r, i ? ",[" : "[");
+	json_string(r, dev->fields[i].attr);
+	report_puts(r, ",");
+	json_string(r, dev->fields[i].value);
+	report_puts(r, "]");
+    }
+    report_puts(r, "]}");
+}
+
+static void format_json(struct report *r, const struct acpi_snapshot *snap, int classes,
+			int show_empty_slots, int temp_units, const struct trends *trends,
+			const char *root)
+{
+    const struct device_info *dev;
+    int type, i, first_class = TRUE, first;
+
+    report_puts(r, "{");
+    if (root) {
+	report_puts(r, "\"root\":");
+	json_string(r, root);
+	first_class = FALSE;
+    }
+    for (type = 0; type < ACPI_CLASSES; type++) {
+	if (!(classes & ACPI_CLASS(type)) || acpi_count(snap, type) < 0)
+	    continue;
+	report_printf(r, "%s\"%s\":[", first_class ? "" : ",", class_name[type]);
+	for (i = 0, first = TRUE; i < acpi_count(snap, type); i++) {
+	    dev = acpi_device(snap, type, i);
+	    if (is_empty(dev) && !show_empty_slots)
+		continue;
+	    if (!first)
+		report_puts(r, ",");
+	    json_device(r, dev, i, temp_units, trends);
+	    first = FALSE;
+	}
+	report_puts(r, "]");
+	first_class = FALSE;
+    }
+    report_puts(r, "}\n");
+}
+
+static void csv_string(struct report *r, const char *s)
+{
+    const char *p;
+
+    if (!strpbrk(s, ",\"\r\n")) {
+	report_puts(r, s);
+	return;
+    }
+    report_append(r, "\"", 1);
+    for (p = s; *p; p++) {
+	if (*p == '"')
+	    report_append(r, "\"", 1);
+	report_append(r, p, 1);
+    }
+    report_append(r, "\"", 1);
+}
+
+static void csv_row(struct report *r, int type, int index, const struct device_info *dev, char *kind, const char *key,
+		    const char *root)
+{
+    if (root) {
+	csv_string(r, root);
+	report_puts(r, ",");
+    }
+    report_printf(r, "%s,%d,", class_name[type], index);
+    csv_string(r, dev->name);
+    report_printf(r, ",%s,", kind);
+    csv_string(r, key);
+    report_puts(r, ",");
+}
+
+static void csv_device(struct report *r, const struct device_info *dev, int index, int temp_units,
+		       const struct trends *trends, const char *root)
+{
+    const struct thermal_info *t = &dev->info.thermal;
+    const struct cooling_stats *st = &dev->info.cooling.stats;
+    const struct hwmon_info *h = &dev->info.hwmon;
+    const struct sensor *s;
+    struct values vals;
+    char key[64], *scale, *prefix;
+    double value;
+    int i, k;
+
+    get_values(dev, temp_units, trends, &vals);
+    for (i = 0; i < vals.n; i++) {
+	csv_row(r, dev->type, index, dev, "value", vals.v[i].key, root);
+	switch (vals.v[i].type) {
+	case VALUE_INT:
+	    report_printf(r, "%d", vals.v[i].i);
+	    break;
+	case VALUE_LLONG:
+	    report_printf(r, "%lld", vals.v[i].ll);
+	    break;
+	case VALUE_FLOAT:
+	    report_printf(r, "%.1f", vals.v[i].f);
+	    break;
+	case VALUE_STRING:
+	    csv_string(r, vals.v[i].s);
+	    break;
+	}
+	report_puts(r, "\n");
+    }
+    if (dev->type == THERMAL_ZONE) {
+	for (i = 0; i < t->trip_points; i++) {
+	    if (!show_trip_point(t, i))
+		continue;
+	    snprintf(key, sizeof(key), "trip_point_%d_type", i);
+	    csv_row(r, dev->type, index, dev, "value", key, root);
+	    csv_string(r, t->trip[i].type);
+	    report_puts(r, "\n");
+	    snprintf(key, sizeof(key), "trip_point_%d_%s", i, temperature_key(temp_units));
+	    csv_row(r, dev->type, index, dev, "value", key, root);
+	    report_printf(r, "%.1f\n", get_real_temp(t->trip[i].temp, &scale, temp_units));
+	    if (t->trip[i].hyst >= 0) {
+		snprintf(key, sizeof(key), "trip_point_%d_hysteresis_%s", i, temperature_key(temp_units));
+		csv_row(r, dev->type, index, dev, "value", key, root);
+		report_printf(r, "%.1f\n", get_temp_delta(t->trip[i].hyst, temp_units));
+	    }
+	}
+    }
+    if (dev->type == COOLING_DEV) {
+	for (i = 0; st->time_in_state_ms && i < st->states; i++) {
+	    if (st->time_in_state_ms[i] < 0)
+		continue;
+	    snprintf(key, sizeof(key), "state_%d_time_in_state_ms", i);
+	    csv_row(r, dev->type, index, dev, "value", key, root);
+	    report_printf(r, "%lld\n", st->time_in_state_ms[i]);
+	    if (st->time_in_state_delta_ms) {
+		snprintf(key, sizeof(key), "state_%d_time_in_state_delta_ms", i);
+		csv_row(r, dev->type, index, dev, "value", key, root);
+		report_printf(r, "%lld\n", st->time_in_state_delta_ms[i]);
+	    }
+	}
+	for (i = 0; st->trans_table && i < st->states * st->states; i++) {
+	    if (st->trans_table[i] <= 0)
+		continue;
+	    snprintf(key, sizeof(key), "trans_%d_%d", i / st->states, i % st->states);
+	    csv_row(r, dev->type, index, dev, "value", key, root);
+	    report_printf(r, "%lld\n", st->trans_table[i]);
+	    if (st->trans_delta) {
+		snprintf(key, sizeof(key), "trans_%d_%d_delta", i / st->states, i % st->states);
+		csv_row(r, dev->type, index, dev, "value", key, root);
+		report_printf(r, "%lld\n", st->trans_delta[i]);
+	    }
+	}
+    }
+    if (dev->type == HWMON) {
+	for (i = 0; i < h->sensors; i++) {
+	    s = &h->sensor[i];
+	    if (!(s->known & SENSOR_INPUT))
+		continue;
+	    if (s->label) {
+		snprintf(key, sizeof(key), "%s%d_label", sensor_type_name[s->type], s->index);
+		csv_row(r, dev->type, index, dev, "value", key, root);
+		csv_string(r, s->label);
+		report_puts(r, "\n");
+	    }
+	    for (k = 0; k < SENSOR_VALUES; k++) {
+		if (!sensor_value(s, k, temp_units, &prefix, &value))
+		    continue;
+		snprintf(key, sizeof(key), "%s%d_%s%s", sensor_type_name[s->type], s->index, prefix,
+			 sensor_key(s->type, temp_units));
+		csv_row(r, dev->type, index, dev, "value", key, root);
+		report_printf(r, "%.1f\n", value);
+	    }
+	}
+    }
+    for (i = 0; i < dev->num_fields; i++) {
+	csv_row(r, dev->type, index, dev, "attribute", dev->fields[i].attr, root);
+	csv_string(r, dev->fields[i].value);
+	report_puts(r, "\n");
+    }
+}
+
+/* one row per value: class,index,name,kind,key,value where kind is
+ * "value" for what we computed and "attribute" for what was read, rows
+ * tagged with their root get that as first column and the caller writes
+ * the header once for all roots */
+static void format_csv(struct report *r, const struct acpi_snapshot *snap, int classes,
+		       int show_empty_slots, int temp_units, const struct trends *trends,
+		       const char *root)
+{
+    const struct device_info *dev;
+    int type, i;
+
+    if (!root)
+	report_puts(r, "class,index,name,kind,key,value\n");
+    for (type = 0; type < ACPI_CLASSES; type++) {
+	if (!(classes & ACPI_CLASS(type)))
+	    continue;
+	for (i = 0; i < acpi_count(snap, type); i++) {
+	    dev = acpi_device(snap, type, i);
+	    if (is_empty(dev) && !show_empty_slots)
+		continue;
+	    csv_device(r, dev, i, temp_units, trends, root);
+	}
+    }
+}
+
+static void prom_label(struct report *r, char *name, const char *value, int first)
+{
+    const char *p;
+
+    report_printf(r, "%s%s=\"", first ? "" : ",", name);
+    for (p = value; *p; p++) {
+	if (*p == '"' || *p == '\\')
+	    report_printf(r, "\\%c", *p);
+	else if (*p == '\n')
+	    report_puts(r, "\\n");
+	else
+	    report_append(r, p, 1);
+    }
+    report_puts(r, "\"");
+}
+
+static void prom_device_labels(struct report *r, const struct device_info *dev, int index, const char *root)
+{
+    if (root) {
+	prom_label(r, "root", root, TRUE);
+	report_puts(r, ",");
+    }
+    report_printf(r, "index=\"%d\"", index);
+    prom_label(r, "name", dev->name, FALSE);
+}
+
+/* the snapshots one exposition is made of, one per root; every metric
+ * has its samples of all of them below a single TYPE line */
+struct prom_source {
+    const struct acpi_snapshot *snap;
+    const char *root;		/* NULL if the samples get no root label */
+};
+
+/* the next device of a class to show, over the snapshots of all roots;
+ * *si and *i start at 0 and -1 and tell the root and index of the device */
+static const struct device_info *prom_next(const struct prom_source *src, int n, int type, int show_empty_slots,
+					   int *si, int *i)
+{
+    const struct device_info *dev;
+
+    while (*si < n) {
+	if (++*i >= acpi_count(src[*si].snap, type)) {
+	    ++*si;
+	    *i = -1;
+	    continue;
+	}
+	dev = acpi_device(src[*si].snap, type, *i);
+	if (!is_empty(dev) || show_empty_slots)
+	    return dev;
+    }
+    return NULL;
+}
+
+/* one value of the sensors of a type as acpi_hwmon_<prefix><key>, the
+ * gauge is only there if a chip has such a sensor */
+static void prom_sensors(struct report *r, const struct prom_source *src, int n, int type, int k,
+			 int show_empty_slots, int temp_units)
+{
+    const struct device_info *dev;
+    const struct sensor *s;
+    char *prefix;
+    double value;
+    int si, i, j, first = TRUE;
+
+    for (si = 0, i = -1; (dev = prom_next(src, n, HWMON, show_empty_slots, &si, &i)); ) {
+	for (j = 0; j < dev->info.hwmon.sensors; j++) {
+	    s = &dev->info.hwmon.sensor[j];
+	    if (s->type != type || !(s->known & SENSOR_INPUT) || !sensor_value(s, k, temp_units, &prefix, &value))
+		continue;
+	    if (first)
+		report_printf(r, "# TYPE acpi_hwmon_%s%s gauge\n", prefix, sensor_key(type, temp_units));
+	    first = FALSE;
+	    report_printf(r, "acpi_hwmon_%s%s{", prefix, sensor_key(type, temp_units));
+	    prom_device_labels(r, dev, i, src[si].root);
+	    report_printf(r, ",sensor=\"%s%d\"", sensor_type_name[type], s->index);
+	    if (s->label)
+		prom_label(r, "label", s->label, FALSE);
+	    report_printf(r, "} %.1f\n", value);
+	}
+    }
+}
+
+/* the time a cooling device spent in each state resp. how often it went
+ * from one to another, the transitions that never happened are left out;
+ * like with the sensors the counter is only there if a device has stats/ */
+static void prom_cooling_stats(struct report *r, const struct prom_source *src, int n, int trans,
+			       int show_empty_slots)
+{
+    static char *names[] = { "acpi_cooling_device_time_in_state_ms_total", "acpi_cooling_device_transitions_total" };
+    const struct device_info *dev;
+    const struct cooling_stats *st;
+    const long long *table;
+    int si, i, j, first = TRUE;
+
+    for (si = 0, i = -1; (dev = prom_next(src, n, COOLING_DEV, show_empty_slots, &si, &i)); ) {
+	st = &dev->info.cooling.stats;
+	table = trans ? st->trans_table : st->time_in_state_ms;
+	for (j = 0; table && j < (trans ? st->states * st->states : st->states); j++) {
+	    if (table[j] < 0 || (trans && !table[j]))
+		continue;
+	    if (first)
+		report_printf(r, "# TYPE %s counter\n", names[trans]);
+	    first = FALSE;
+	    report_printf(r, "%s{", names[trans]);
+	    prom_device_labels(r, dev, i, src[si].root);
+	    if (trans)
+		report_printf(r, ",from=\"%d\",to=\"%d\"", j / st->states, j % st->states);
+	    else
+		report_printf(r, ",state=\"%d\"", j);
+	    report_printf(r, "} %lld\n", table[j]);
+	}
+    }
+}
+
+/* every value becomes a gauge named acpi_<class>_<key>, or a counter
+ * named acpi_<class>_<key>_total if it is one, the strings are
+ * labels of acpi_<class>_info and the raw attributes labels of
+ * acpi_attribute_info; samples of one metric have to stay together, so
+ * several roots make one exposition */
+static void format_prom(struct report *r, const struct prom_source *src, int n, int classes,
+			int show_empty_slots, int temp_units, const struct trends *trends)
+{
+    const struct device_info *dev;
+    const struct thermal_info *t;
+    struct values vals, layout;
+    char *scale, *total;
+    int type, si, i, j, k, first;
+
+    for (type = 0; type < ACPI_CLASSES; type++) {
+	if (!(classes & ACPI_CLASS(type)))
+	    continue;
+	layout.n = 0;
+	for (si = 0, i = -1; (dev = prom_next(src, n, type, show_empty_slots, &si, &i)); ) {
+	    if (!layout.n) {
+		get_values(dev, temp_units, trends, &layout);
+		report_printf(r, "# TYPE acpi_%s_info gauge\n", class_name[type]);
+	    }
+	    get_values(dev, temp_units, trends, &vals);
+	    report_printf(r, "acpi_%s_info{", class_name[type]);
+	    prom_device_labels(r, dev, i, src[si].root);
+	    for (k = 0; k < vals.n; k++)
+		if (vals.v[k].type == VALUE_STRING)
+		    prom_label(r, vals.v[k].key, vals.v[k].s, FALSE);
+	    report_puts(r, "} 1\n");
+	}
+
+	for (k = 0; k < layout.n; k++) {
+	    if (layout.v[k].string)
+		continue;
+	    total = layout.v[k].counter ? "_total" : "";
+	    report_printf(r, "# TYPE acpi_%s_%s%s %s\n", class_name[type], layout.v[k].key, total,
+			  layout.v[k].counter ? "counter" : "gauge");
+	    for (si = 0, i = -1; (dev = prom_next(src, n, type, show_empty_slots, &si, &i)); ) {
+		get_values(dev, temp_units, trends, &vals);
+		if (vals.v[k].type == VALUE_INT) {
+		    report_printf(r, "acpi_%s_%s%s{", class_name[type], vals.v[k].key, total);
+		    prom_device_labels(r, dev, i, src[si].root);
+		    report_printf(r, "} %d\n", vals.v[k].i);
+		} else if (vals.v[k].type == VALUE_LLONG) {
+		    report_printf(r, "acpi_%s_%s%s{", class_name[type], vals.v[k].key, total);
+		    prom_device_labels(r, dev, i, src[si].root);
+		    report_printf(r, "} %lld\n", vals.v[k].ll);
+		} else if (vals.v[k].type == VALUE_FLOAT) {
+		    report_printf(r, "acpi_%s_%s%s{", class_name[type], vals.v[k].key, total);
+		    prom_device_labels(r, dev, i, src[si].root);
+		    report_printf(r, "} %.1f\n", vals.v[k].f);
+		}
+	    }
+	}
+
+	if (type == THERMAL_ZONE && layout.n) {
+	    report_printf(r, "# TYPE acpi_thermal_zone_trip_point_%s gauge\n", temperature_key(temp_units));
+	    for (si = 0, i = -1; (dev = prom_next(src, n, type, show_empty_slots, &si, &i)); ) {
+		t = &dev->info.thermal;
+		for (j = 0; j < t->trip_points; j++) {
+		    if (!show_trip_point(t, j))
+			continue;
+		    report_printf(r, "acpi_thermal_zone_trip_point_%s{", temperature_key(temp_units));
+		    prom_device_labels(r, dev, i, src[si].root);
+		    report_printf(r, ",trip=\"%d\"", j);
+		    prom_label(r, "type", t->trip[j].type, FALSE);
+		    report_printf(r, "} %.1f\n", get_real_temp(t->trip[j].temp, &scale, temp_units));
+		}
+	    }
+	    /* most zones have no hysteresis, then there is no metric either */
+	    for (si = 0, i = -1, first = TRUE; (dev = prom_next(src, n, type, show_empty_slots, &si, &i)); ) {
+		t = &dev->info.thermal;
+		for (j = 0; j < t->trip_points; j++) {
+		    if (!show_trip_point(t, j) || t->trip[j].hyst < 0)
+			continue;
+		    if (first)
+			report_printf(r, "# TYPE acpi_thermal_zone_trip_point_hysteresis_%s gauge\n",
+				      temperature_key(temp_units));
+		    first = FALSE;
+		    report_printf(r, "acpi_thermal_zone_trip_point_hysteresis_%s{", temperature_key(temp_units));
+		    prom_device_labels(r, dev, i, src[si].root);
+		    report_printf(r, ",trip=\"%d\"", j);
+		    prom_label(r, "type", t->trip[j].type, FALSE);
+		    report_printf(r, "} %.1f\n", get_temp_delta(t->trip[j].hyst, temp_units));
+		}
+	    }
+	}
+
+	if (type == COOLING_DEV && layout.n)
+	    for (k = 0; k < 2; k++)
+		prom_cooling_stats(r, src, n, k, show_empty_slots);
+
+	if (type == HWMON && layout.n)
+	    for (j = 0; j < SENSOR_TYPES; j++)
+		for (k = 0; k < SENSOR_VALUES; k++)
+		    prom_sensors(r, src, n, j, k, show_empty_slots, temp_units);
+    }
+
+    report_puts(r, "# TYPE acpi_attribute_info gauge\n");
+    for (type = 0; type < ACPI_CLASSES; type++) {
+	if (!(classes & ACPI_CLASS(type)))
+	    continue;
+	for (si = 0, i = -1; (dev = prom_next(src, n, type, show_empty_slots, &si, &i)); ) {
+	    for (k = 0; k < dev->num_fields; k++) {
+		report_puts(r, "acpi_attribute_info{");
+		prom_label(r, "class", class_name[type], TRUE);
+		report_puts(r, ",");
+		prom_device_labels(r, dev, i, src[si].root);
+		prom_label(r, "attribute", dev->fields[k].attr, FALSE);
+		prom_label(r, "value", dev->fields[k].value, FALSE);
+		report_puts(r, "} 1\n");
+	    }
+	}
+    }
+}
+
+void format_snapshot(struct report *r, const struct acpi_snapshot *snap, const struct request *q)
+{
+    const char *root = q->tag_root ? q->path : NULL;
+
+    switch (q->format) {
+    case FORMAT_JSON:
+	format_json(r, snap, q->classes, q->show_empty_slots, q->temp_units, q->trends, root);
+	break;
+    case FORMAT_CSV:
+	format_csv(r, snap, q->classes, q->show_empty_slots, q->temp_units, q->trends, root);
+	break;
+    case FORMAT_PROM:
+	format_prom_roots(r, &snap, &root, 1, q);
+	break;
+    }
+}
+
+void format_prom_roots(struct report *r, const struct acpi_snapshot **snaps, const char **roots, int n,
+		       const struct request *q)
+{
+    struct prom_source *src;
+    int i;
+
+    src = malloc(n * sizeof(struct prom_source));
+    if (!src) {
+	r->failed = TRUE;
+	return;
+    }
+    for (i = 0; i < n; i++) {
+	src[i].snap = snaps[i];
+	src[i].root = roots[i];
+    }
+    format_prom(r, src, n, q->classes, q->show_empty_slots, q->temp_units, q->trends);
+    free(src);
+}
+
+void format_header(struct report *r, const struct request *q)
+{
+    if (q->format == FORMAT_CSV && q->tag_root)
+	report_puts(r, "root,class,index,name,kind,key,value\n");
+}
+
+/* the text output is written by stdio, collect it in memory and put the
+ * root in front of every line if asked to */
+static void render_text(struct report *r, const struct acpi_snapshot *snap, const struct request *q)
+{
+    char *text, *line, *eol;
+    size_t start = r->len, len;
+    FILE *out;
+
+    out = report_stream(r);
+    if (!out)
+	return;
+    if ((q->classes & ACPI_CLASS(BATTERY)) && acpi_count(snap, BATTERY) >= 0)
+	print_battery_information(out, snap, q->show_empty_slots, q->show_details, q->trends);
+    if ((q->classes & ACPI_CLASS(AC_ADAPTER)) && acpi_count(snap, AC_ADAPTER) >= 0)
+	print_ac_adapter_information(out, snap, q->show_empty_slots);
+    if ((q->classes & ACPI_CLASS(THERMAL_ZONE)) && acpi_count(snap, THERMAL_ZONE) >= 0)
+	print_thermal_information(out, snap, q->show_empty_slots, q->temp_units, q->show_details, q->trends);
+    if ((q->classes & ACPI_CLASS(COOLING_DEV)) && acpi_count(snap, COOLING_DEV) >= 0)
+	print_cooling_information(out, snap, q->show_empty_slots, q->show_details);
+    if ((q->classes & ACPI_CLASS(HWMON)) && acpi_count(snap, HWMON) >= 0)
+	print_hwmon_information(out, snap, q->show_empty_slots, q->temp_units, q->show_details);
+    if ((q->classes & ACPI_CLASS(POWERCAP)) && acpi_count(snap, POWERCAP) >= 0)
+	print_powercap_information(out, snap, q->show_empty_slots, q->show_details);
+    if ((q->classes & ACPI_CLASS(CPU)) && acpi_count(snap, CPU) >= 0)
+	print_throttle_information(out, snap, q->show_empty_slots, q->show_details);
+    if (!q->tag_root || r->failed)
+	return;
+
+    /* put the path in front of every line that was just printed */
+    len = r->len - start;
+    text = malloc(len);
+    if (!text) {
+	r->failed = TRUE;
+	return;
+    }
+    memcpy(text, r->buf + start, len);
+    r->len = start;
+    for (line = text; line < text + len; line = eol) {
+	eol = memchr(line, '\n', text + len - line);
+	eol = eol ? eol + 1 : text + len;
+	report_printf(r, "%s: ", q->path);
+	report_append(r, line, eol - line);
+    }
+    free(text);
+}
+
+void render_snapshot(struct report *r, const struct acpi_snapshot *snap, const struct request *q)
+{
+    if (q->format == FORMAT_TEXT)
+	render_text(r, snap, q);
+    else
+	format_snapshot(r, snap, q);
+}
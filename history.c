@@ -0,0 +1,785 @@
+/* records battery, thermal and cooling samples into a compact file and
+ * answers range queries on it
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#define _GNU_SOURCE	/* for strverscmp() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "acpi.h"
+#include "report.h"
+
+/* the file is a header followed by the blocks and an index of them:
+ *
+ *   header   "ACPIHIST" version
+ *   block    magic length samples series first last, then the payload
+ *   ...
+ *   index    first last offset samples length, for every block
+ *   footer   offset of the index, number of blocks, magic
+ *
+ * all numbers are little endian, times are milliseconds since the epoch.
+ * The payload describes every series (class, column, unit and the name
+ * of the device, as its length and bytes) and then holds the column of timestamps and one column per series. A
+ * value is stored as the zigzag varint of its difference to the value
+ * before, shifted up by one, since zero marks a missing value.
+ *
+ * the index and footer are written again behind every new block; if the
+ * recorder died in between, the blocks are found by walking them */
+
+#define HISTORY_MAGIC		"ACPIHIST"
+#define HISTORY_VERSION		2	/* 1 told the devices apart by their position */
+#define HEADER_SIZE		16
+#define BLOCK_MAGIC		0x6b6c6241	/* "Ablk" */
+#define BLOCK_HEADER_SIZE	32
+#define INDEX_MAGIC		0x78646941	/* "Aidx" */
+#define INDEX_ENTRY_SIZE	32
+#define FOOTER_SIZE		16
+#define BLOCK_SAMPLES		64	/* an hour per block at one sample a minute */
+#define SERIES_NAME_SIZE	32	/* longer device names are cut */
+
+enum column {
+    COLUMN_CHARGE,
+    COLUMN_RATE,
+    COLUMN_VOLTAGE,
+    COLUMN_TEMPERATURE,	/* millidegrees celsius */
+    COLUMN_STATE,
+    COLUMN_POWER
+};
+
+enum unit {
+    UNIT_NONE,
+    UNIT_MAH,
+    UNIT_MWH,
+    UNIT_MA,
+    UNIT_MW,
+    UNIT_MV,
+    UNIT_CELSIUS
+};
+
+static const char *class_names[] = { "Battery", "Adapter", "Thermal", "Cooling", "Hwmon", "Powercap", "Cpu" };
+static const char *column_names[] = { "charge", "rate", "voltage", "temperature", "state", "power" };
+static const char *unit_names[] = { "", " mAh", " mWh", " mA", " mW", " mV", "" };
+
+/* compared with memcmp(), so the unused part of name has to be zero */
+struct series {
+    int type;
+    int column;
+    int unit;
+    char name[SERIES_NAME_SIZE];	/* of the device, e.g. BAT0, whatever position it had */
+};
+
+struct block_ref {
+    int64_t first;
+    int64_t last;
+    uint64_t offset;
+    uint32_t samples;
+    uint32_t length;	/* of the payload */
+};
+
+struct recorder {
+    int fd;
+    uint64_t end;		/* where the next block goes, the index follows */
+    struct block_ref *blocks;
+    int num_blocks, max_blocks;
+    struct series *series;	/* of the block being filled */
+    int num_series;
+    int64_t times[BLOCK_SAMPLES];
+    int64_t *values;		/* BLOCK_SAMPLES per series */
+    int samples;
+    struct series *next;	/* what the last snapshot had */
+    int64_t *next_values;
+    int num_next, max_next;
+    struct report out;
+};
+
+static void store_u32(unsigned char *p, uint32_t v)
+{
+    int i;
+
+    for (i = 0; i < 4; i++)
+	p[i] = v >> (8 * i);
+}
+
+static void store_u64(unsigned char *p, uint64_t v)
+{
+    int i;
+
+    for (i = 0; i < 8; i++)
+	p[i] = v >> (8 * i);
+}
+
+static uint32_t load_u32(const unsigned char *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static uint64_t load_u64(const unsigned char *p)
+{
+    return load_u32(p) | (uint64_t) load_u32(p + 4) << 32;
+}
+
+static void put_u32(struct report *r, uint32_t v)
+{
+    unsigned char b[4];
+
+    store_u32(b, v);
+    report_append(r, (char *) b, sizeof(b));
+}
+
+static void put_u64(struct report *r, uint64_t v)
+{
+    unsigned char b[8];
+
+    store_u64(b, v);
+    report_append(r, (char *) b, sizeof(b));
+}
+
+static void put_varint(struct report *r, uint64_t v)
+{
+    unsigned char b[10];
+    int n = 0;
+
+    while (v >= 0x80) {
+	b[n++] = v | 0x80;
+	v >>= 7;
+    }
+    b[n++] = v;
+    report_append(r, (char *) b, n);
+}
+
+/* returns -1 if the varint runs past end or is too long */
+static int get_varint(const unsigned char **p, const unsigned char *end, uint64_t *v)
+{
+    int shift;
+
+    *v = 0;
+    for (shift = 0; *p < end && shift < 64; shift += 7) {
+	*v |= (uint64_t) (**p & 0x7f) << shift;
+	if (!(*(*p)++ & 0x80))
+	    return 0;
+    }
+    return -1;
+}
+
+static uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v)
+{
+    return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+}
+
+/* find the blocks of a mapped file, returns -1 if it is no history file */
+static int load_index(const unsigned char *map, size_t size, struct block_ref **blocks, int *num_blocks,
+		      uint64_t *end)
+{
+    const unsigned char *p;
+    uint64_t offset, index;
+    uint32_t count, i;
+    struct block_ref *b;
+
+    *blocks = NULL;
+    *num_blocks = 0;
+    if (size < HEADER_SIZE || memcmp(map, HISTORY_MAGIC, 8) || load_u32(map + 8) != HISTORY_VERSION)
+	return -1;
+
+    if (size >= HEADER_SIZE + FOOTER_SIZE && load_u32(map + size - 4) == INDEX_MAGIC) {
+	index = load_u64(map + size - FOOTER_SIZE);
+	count = load_u32(map + size - 8);
+	if (index >= HEADER_SIZE && index <= size - FOOTER_SIZE &&
+	    (size - FOOTER_SIZE - index) / INDEX_ENTRY_SIZE == count &&
+	    (size - FOOTER_SIZE - index) % INDEX_ENTRY_SIZE == 0) {
+	    *blocks = malloc((count ? count : 1) * sizeof(struct block_ref));
+	    if (!*blocks)
+		return -1;
+	    for (i = 0, p = map + index; i < count; i++, p += INDEX_ENTRY_SIZE) {
+		b = &(*blocks)[i];
+		b->first = load_u64(p);
+		b->last = load_u64(p + 8);
+		b->offset = load_u64(p + 16);
+		b->samples = load_u32(p + 24);
+		b->length = load_u32(p + 28);
+		if (b->offset < HEADER_SIZE || b->offset + BLOCK_HEADER_SIZE + b->length > index)
+		    break;
+	    }
+	    if (i == count) {
+		*num_blocks = count;
+		*end = index;
+		return 0;
+	    }
+	    free(*blocks);
+	    *blocks = NULL;
+	}
+    }
+
+    /* no usable index, walk the blocks up to the first broken one */
+    for (offset = HEADER_SIZE; offset + BLOCK_HEADER_SIZE <= size; offset += BLOCK_HEADER_SIZE + load_u32(p + 4)) {
+	p = map + offset;
+	if (load_u32(p) != BLOCK_MAGIC || offset + BLOCK_HEADER_SIZE + load_u32(p + 4) > size)
+	    break;
+	if (!(*num_blocks & (*num_blocks - 1))) {
+	    b = realloc(*blocks, (*num_blocks ? *num_blocks * 2 : 1) * sizeof(struct block_ref));
+	    if (!b) {
+		free(*blocks);
+		*blocks = NULL;
+		return -1;
+	    }
+	    *blocks = b;
+	}
+	b = &(*blocks)[(*num_blocks)++];
+	b->length = load_u32(p + 4);
+	b->samples = load_u32(p + 8);
+	b->first = load_u64(p + 16);
+	b->last = load_u64(p + 24);
+	b->offset = offset;
+    }
+    *end = offset;
+    return 0;
+}
+
+static int64_t now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void recorder_free(struct recorder *rec)
+{
+    if (rec->fd >= 0)
+	close(rec->fd);
+    free(rec->blocks);
+    free(rec->series);
+    free(rec->values);
+    free(rec->next);
+    free(rec->next_values);
+    report_free(&rec->out);
+}
+
+static int recorder_open(struct recorder *rec, const char *file)
+{
+    struct stat st;
+    void *map;
+
+    memset(rec, 0, sizeof(struct recorder));
+    if (report_init(&rec->out, BUF_SIZE * 16) < 0) {
+	fprintf(stderr, "Out of memory in recorder_open()\n");
+	return -1;
+    }
+    rec->fd = open(file, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (rec->fd < 0 || fstat(rec->fd, &st) < 0) {
+	fprintf(stderr, "Cannot open %s: %s\n", file, strerror(errno));
+	return -1;
+    }
+    if (st.st_size == 0) {
+	report_append(&rec->out, HISTORY_MAGIC, 8);
+	put_u32(&rec->out, HISTORY_VERSION);
+	put_u32(&rec->out, 0);
+	if (report_write(&rec->out, rec->fd) < 0) {
+	    fprintf(stderr, "Cannot write %s: %s\n", file, strerror(errno));
+	    return -1;
+	}
+	rec->end = HEADER_SIZE;
+	return 0;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, rec->fd, 0);
+    if (map == MAP_FAILED) {
+	fprintf(stderr, "Cannot map %s: %s\n", file, strerror(errno));
+	return -1;
+    }
+    if (load_index(map, st.st_size, &rec->blocks, &rec->num_blocks, &rec->end) < 0) {
+	fprintf(stderr, "%s is not an acpi history file\n", file);
+	munmap(map, st.st_size);
+	return -1;
+    }
+    munmap(map, st.st_size);
+    rec->max_blocks = rec->num_blocks;
+    return 0;
+}
+
+static int add_value(struct recorder *rec, int type, int column, int unit, const char *name, int64_t value,
+		     int known)
+{
+    struct series *s;
+    int64_t *v;
+
+    if (rec->num_next == rec->max_next) {
+	rec->max_next = rec->max_next ? rec->max_next * 2 : 16;
+	s = realloc(rec->next, rec->max_next * sizeof(struct series));
+	if (s)
+	    rec->next = s;
+	v = realloc(rec->next_values, rec->max_next * sizeof(int64_t));
+	if (v)
+	    rec->next_values = v;
+	if (!s || !v)
+	    return -1;
+    }
+    s = &rec->next[rec->num_next];
+    memset(s, 0, sizeof(struct series));
+    s->type = type;
+    s->column = column;
+    s->unit = unit;
+    snprintf(s->name, sizeof(s->name), "%s", name);
+    /* zero is what a missing value is stored as */
+    rec->next_values[rec->num_next++] = known ? value : INT64_MIN;
+    return 0;
+}
+
+/* turn a snapshot into series and values */
+static int collect(struct recorder *rec, const struct acpi_snapshot *snap, int classes)
+{
+    const struct device_info *dev;
+    struct battery_status s;
+    int i, n, mwh, err = 0;
+
+    rec->num_next = 0;
+    n = (classes & ACPI_CLASS(BATTERY)) ? acpi_count(snap, BATTERY) : 0;
+    for (i = 0; i < n && !err; i++) {
+	dev = acpi_device(snap, BATTERY, i);
+	get_battery_status(&dev->info.battery, &s);
+	mwh = !strcmp(s.capacity_unit, "mWh");
+	err = add_value(rec, BATTERY, COLUMN_CHARGE, mwh ? UNIT_MWH : UNIT_MAH, dev->name,
+			s.remaining_capacity, dev->present && s.remaining_capacity >= 0) ||
+	      add_value(rec, BATTERY, COLUMN_RATE, mwh ? UNIT_MW : UNIT_MA, dev->name,
+			s.present_rate, dev->present && s.present_rate >= 0) ||
+	      add_value(rec, BATTERY, COLUMN_VOLTAGE, UNIT_MV, dev->name,
+			dev->info.battery.voltage, dev->present && dev->info.battery.voltage >= 0);
+    }
+    n = (classes & ACPI_CLASS(THERMAL_ZONE)) ? acpi_count(snap, THERMAL_ZONE) : 0;
+    for (i = 0; i < n && !err; i++) {
+	dev = acpi_device(snap, THERMAL_ZONE, i);
+	err = add_value(rec, THERMAL_ZONE, COLUMN_TEMPERATURE, UNIT_CELSIUS, dev->name,
+			(int64_t) (dev->info.thermal.temperature * 1000 + 0.5), dev->present);
+    }
+    n = (classes & ACPI_CLASS(COOLING_DEV)) ? acpi_count(snap, COOLING_DEV) : 0;
+    for (i = 0; i < n && !err; i++) {
+	dev = acpi_device(snap, COOLING_DEV, i);
+	err = add_value(rec, COOLING_DEV, COLUMN_STATE, UNIT_NONE, dev->name,
+			dev->info.cooling.cur_state, dev->info.cooling.cur_state >= 0);
+    }
+    n = (classes & ACPI_CLASS(POWERCAP)) ? acpi_count(snap, POWERCAP) : 0;
+    for (i = 0; i < n && !err; i++) {
+	dev = acpi_device(snap, POWERCAP, i);
+	err = add_value(rec, POWERCAP, COLUMN_POWER, UNIT_MW, dev->name,
+			(int64_t) (dev->info.powercap.power * 1000 + 0.5), dev->info.powercap.power >= 0);
+    }
+    return err;
+}
+
+static void put_column(struct report *r, const int64_t *values, int samples)
+{
+    int64_t last = 0;
+    int i;
+
+    for (i = 0; i < samples; i++) {
+	if (values[i] == INT64_MIN) {
+	    put_varint(r, 0);
+	    continue;
+	}
+	put_varint(r, zigzag(values[i] - last) + 1);
+	last = values[i];
+    }
+}
+
+/* append the block, the index and the footer with one write */
+static int recorder_flush(struct recorder *rec)
+{
+    struct block_ref *b;
+    unsigned char *h;
+    size_t len;
+    ssize_t n;
+    int i;
+
+    if (!rec->samples)
+	return 0;
+    if (rec->num_blocks == rec->max_blocks) {
+	b = realloc(rec->blocks, (rec->max_blocks ? rec->max_blocks * 2 : 16) * sizeof(struct block_ref));
+	if (!b)
+	    return -1;
+	rec->blocks = b;
+	rec->max_blocks = rec->max_blocks ? rec->max_blocks * 2 : 16;
+    }
+
+    report_reset(&rec->out);
+    if (report_reserve(&rec->out, BLOCK_HEADER_SIZE) < 0)
+	return -1;
+    rec->out.len = BLOCK_HEADER_SIZE;
+    for (i = 0; i < rec->num_series; i++) {
+	put_varint(&rec->out, rec->series[i].type);
+	put_varint(&rec->out, rec->series[i].column);
+	put_varint(&rec->out, rec->series[i].unit);
+	put_varint(&rec->out, strlen(rec->series[i].name));
+	report_append(&rec->out, rec->series[i].name, strlen(rec->series[i].name));
+    }
+    put_column(&rec->out, rec->times, rec->samples);
+    for (i = 0; i < rec->num_series; i++)
+	put_column(&rec->out, rec->values + i * BLOCK_SAMPLES, rec->samples);
+    if (rec->out.failed)
+	return -1;
+
+    b = &rec->blocks[rec->num_blocks];
+    b->first = rec->times[0];
+    b->last = rec->times[rec->samples - 1];
+    b->offset = rec->end;
+    b->samples = rec->samples;
+    b->length = rec->out.len - BLOCK_HEADER_SIZE;
+    h = (unsigned char *) rec->out.buf;
+    store_u32(h, BLOCK_MAGIC);
+    store_u32(h + 4, b->length);
+    store_u32(h + 8, b->samples);
+    store_u32(h + 12, rec->num_series);
+    store_u64(h + 16, b->first);
+    store_u64(h + 24, b->last);
+
+    for (i = 0; i <= rec->num_blocks; i++) {
+	put_u64(&rec->out, rec->blocks[i].first);
+	put_u64(&rec->out, rec->blocks[i].last);
+	put_u64(&rec->out, rec->blocks[i].offset);
+	put_u32(&rec->out, rec->blocks[i].samples);
+	put_u32(&rec->out, rec->blocks[i].length);
+    }
+    put_u64(&rec->out, rec->end + BLOCK_HEADER_SIZE + b->length);
+    put_u32(&rec->out, rec->num_blocks + 1);
+    put_u32(&rec->out, INDEX_MAGIC);
+    if (rec->out.failed)
+	return -1;
+
+    for (len = 0; len < rec->out.len; len += n) {
+	n = pwrite(rec->fd, rec->out.buf + len, rec->out.len - len, rec->end + len);
+	if (n < 0 && errno == EINTR) {
+	    n = 0;
+	    continue;
+	}
+	if (n <= 0)
+	    return -1;
+    }
+    if (ftruncate(rec->fd, rec->end + len) < 0)
+	return -1;
+
+    rec->end += BLOCK_HEADER_SIZE + b->length;
+    rec->num_blocks++;
+    rec->samples = 0;
+    return 0;
+}
+
+/* start a new block if the devices are not the same as in the current one */
+static int recorder_add(struct recorder *rec, int64_t time)
+{
+    int i;
+
+    if (rec->num_next != rec->num_series ||
+	memcmp(rec->next, rec->series, rec->num_next * sizeof(struct series))) {
+	if (recorder_flush(rec) < 0)
+	    return -1;
+	free(rec->series);
+	free(rec->values);
+	rec->series = malloc((rec->num_next ? rec->num_next : 1) * sizeof(struct series));
+	rec->values = malloc((rec->num_next ? rec->num_next : 1) * BLOCK_SAMPLES * sizeof(int64_t));
+	if (!rec->series || !rec->values)
+	    return -1;
+	memcpy(rec->series, rec->next, rec->num_next * sizeof(struct series));
+	rec->num_series = rec->num_next;
+    }
+    rec->times[rec->samples] = time;
+    for (i = 0; i < rec->num_series; i++)
+	rec->values[i * BLOCK_SAMPLES + rec->samples] = rec->next_values[i];
+    if (++rec->samples == BLOCK_SAMPLES)
+	return recorder_flush(rec);
+    return 0;
+}
+
+int history_record(struct acpi_context *ctx, const char *file, int classes, double interval)
+{
+    struct acpi_snapshot *snap;
+    struct recorder rec;
+    void *buf = NULL;
+    size_t size = 0;
+    int err, rval = 0;
+
+    if (recorder_open(&rec, file) < 0) {
+	recorder_free(&rec);
+	return 1;
+    }
+
+    /* the sleep has to end so that the last block is written */
+    catch_stop();
+    while (!stop_requested()) {
+	err = take_snapshot(ctx, classes, &buf, &size, &snap);
+	if (err != ACPI_OK) {
+	    fprintf(stderr, "%s.\n", acpi_strerror(err));
+	    rval = 1;
+	    break;
+	}
+	if (collect(&rec, snap, classes) < 0 || recorder_add(&rec, now_ms()) < 0) {
+	    fprintf(stderr, "Cannot write %s: %s\n", file, errno ? strerror(errno) : "Out of memory");
+	    rval = 1;
+	    break;
+	}
+	sleep_interval(interval);
+    }
+
+    if (recorder_flush(&rec) < 0) {
+	fprintf(stderr, "Cannot write %s: %s\n", file, strerror(errno));
+	rval = 1;
+    }
+    recorder_free(&rec);
+    free(buf);
+    return rval;
+}
+
+struct summary {
+    struct series s;
+    int64_t min;
+    int64_t max;
+    double sum;
+    long count;
+};
+
+static int compare_summaries(const void *a, const void *b)
+{
+    const struct series *x = &((const struct summary *) a)->s;
+    const struct series *y = &((const struct summary *) b)->s;
+    int cmp;
+
+    if (x->type != y->type)
+	return x->type - y->type;
+    if ((cmp = strverscmp(x->name, y->name)))
+	return cmp;
+    if (x->column != y->column)
+	return x->column - y->column;
+    return x->unit - y->unit;
+}
+
+static struct summary *find_summary(struct summary **sums, int *num, const struct series *s)
+{
+    struct summary *p;
+    int i;
+
+    for (i = 0; i < *num; i++)
+	if (!memcmp(&(*sums)[i].s, s, sizeof(struct series)))
+	    return &(*sums)[i];
+    if (!(*num & (*num - 1))) {
+	p = realloc(*sums, (*num ? *num * 2 : 1) * sizeof(struct summary));
+	if (!p)
+	    return NULL;
+	*sums = p;
+    }
+    p = &(*sums)[(*num)++];
+    memset(p, 0, sizeof(struct summary));
+    p->s = *s;
+    return p;
+}
+
+/* add the samples of a block that lie in [from, until] to the summaries,
+ * returns -1 if the block is damaged or out of memory */
+static int summarize_block(const unsigned char *block, const struct block_ref *b, int classes,
+			   int64_t from, int64_t until, struct summary **sums, int *num)
+{
+    const unsigned char *p = block + BLOCK_HEADER_SIZE, *end = p + b->length;
+    uint32_t num_series = load_u32(block + 12), i, j;
+    struct series *series;
+    struct summary *sum;
+    int64_t *times = NULL, value;
+    uint64_t v[4];
+    int rval = -1;
+
+    series = malloc((num_series ? num_series : 1) * sizeof(struct series));
+    times = malloc((b->samples ? b->samples : 1) * sizeof(int64_t));
+    if (!series || !times)
+	goto out;
+    for (i = 0; i < num_series; i++) {
+	for (j = 0; j < 4; j++)
+	    if (get_varint(&p, end, &v[j]) < 0)
+		goto out;
+	if (v[0] >= ACPI_CLASSES || v[1] > COLUMN_POWER || v[2] > UNIT_CELSIUS ||
+	    v[3] >= SERIES_NAME_SIZE || v[3] > (uint64_t) (end - p))
+	    goto out;
+	memset(&series[i], 0, sizeof(struct series));
+	series[i].type = v[0];
+	series[i].column = v[1];
+	series[i].unit = v[2];
+	memcpy(series[i].name, p, v[3]);
+	p += v[3];
+    }
+    for (j = 0, value = 0; j < b->samples; j++) {
+	if (get_varint(&p, end, &v[0]) < 0 || !v[0])
+	    goto out;
+	value += unzigzag(v[0] - 1);
+	times[j] = value;
+    }
+    for (i = 0; i < num_series; i++) {
+	sum = (classes & ACPI_CLASS(series[i].type)) ? find_summary(sums, num, &series[i]) : NULL;
+	if ((classes & ACPI_CLASS(series[i].type)) && !sum)
+	    goto out;
+	for (j = 0, value = 0; j < b->samples; j++) {
+	    if (get_varint(&p, end, &v[0]) < 0)
+		goto out;
+	    if (!v[0])
+		continue;
+	    value += unzigzag(v[0] - 1);
+	    if (!sum || times[j] < from || times[j] > until)
+		continue;
+	    if (!sum->count || value < sum->min)
+		sum->min = value;
+	    if (!sum->count || value > sum->max)
+		sum->max = value;
+	    sum->sum += value;
+	    sum->count++;
+	}
+    }
+    rval = 0;
+out:
+    free(series);
+    free(times);
+    return rval;
+}
+
+static void print_summary(const struct summary *sum, int temp_units)
+{
+    const struct series *s = &sum->s;
+    char *scale;
+    double min, max, avg;
+
+    printf("%s %s: %s ", class_names[s->type], s->name, column_names[s->column]);
+    if (s->unit == UNIT_CELSIUS) {
+	min = get_real_temp(sum->min / 1000.0, &scale, temp_units);
+	max = get_real_temp(sum->max / 1000.0, &scale, temp_units);
+	avg = get_real_temp(sum->sum / sum->count / 1000.0, &scale, temp_units);
+	printf("min %.1f max %.1f average %.1f %s", min, max, avg, scale);
+    } else if (s->unit == UNIT_NONE) {
+	printf("min %lld max %lld average %.1f", (long long) sum->min, (long long) sum->max, sum->sum / sum->count);
+    } else {
+	printf("min %lld max %lld average %.0f%s", (long long) sum->min, (long long) sum->max, sum->sum / sum->count,
+	       unit_names[s->unit]);
+    }
+    printf(", %ld samples\n", sum->count);
+}
+
+int history_query(const char *file, int classes, time_t from, time_t until, int temp_units)
+{
+    struct block_ref *blocks;
+    struct summary *sums = NULL;
+    unsigned char *map;
+    struct stat st;
+    uint64_t end;
+    int64_t from_ms = (int64_t) from * 1000, until_ms = (int64_t) until * 1000 + 999;
+    int fd, num_blocks, num = 0, lo, hi, mid, i, rval = 0;
+
+    fd = open(file, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+	fprintf(stderr, "Cannot open %s: %s\n", file, strerror(errno));
+	if (fd >= 0)
+	    close(fd);
+	return 1;
+    }
+    map = st.st_size ? mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED || load_index(map, st.st_size, &blocks, &num_blocks, &end) < 0) {
+	fprintf(stderr, "%s is not an acpi history file\n", file);
+	if (map != MAP_FAILED)
+	    munmap(map, st.st_size);
+	return 1;
+    }
+
+    /* the blocks are in time order, skip to the first one that can
+     * hold samples of the range and stop after the last one */
+    for (lo = 0, hi = num_blocks; lo < hi; ) {
+	mid = lo + (hi - lo) / 2;
+	if (blocks[mid].last < from_ms)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    for (i = lo; i < num_blocks && blocks[i].first <= until_ms; i++) {
+	if (summarize_block(map + blocks[i].offset, &blocks[i], classes, from_ms, until_ms, &sums, &num) < 0) {
+	    fprintf(stderr, "%s: block %d is damaged\n", file, i);
+	    rval = 1;
+	    break;
+	}
+    }
+
+    qsort(sums, num, sizeof(struct summary), compare_summaries);
+    for (i = 0; i < num; i++)
+	if (sums[i].count)
+	    print_summary(&sums[i], temp_units);
+    for (i = 0; i < num && !sums[i].count; i++)
+	;
+    if (i == num && !rval) {
+	fprintf(stderr, "No samples in that time range\n");
+	rval = 1;
+    }
+
+    free(sums);
+    free(blocks);
+    munmap(map, st.st_size);
+    return rval;
+}
+
+/* now, -<n>[smhdw] before now, @<seconds since the epoch> or a local
+ * YYYY-MM-DD [HH:MM[:SS]] */
+int history_parse_time(const char *s, time_t *t)
+{
+    static const char units[] = "smhdw";
+    static const long seconds[] = { 1, 60, 3600, 86400, 604800 };
+    struct tm tm;
+    char *end, *u = NULL;
+    long n;
+
+    if (!strcmp(s, "now")) {
+	*t = time(NULL);
+	return 0;
+    }
+    if (*s == '-' || *s == '@') {
+	n = strtol(s + 1, &end, 10);
+	if (end == s + 1 || n < 0)
+	    return -1;
+	if (*s == '@' && !*end) {
+	    *t = n;
+	    return 0;
+	}
+	if (*s == '@' || (*end && (end[1] || !(u = strchr(units, *end)))))
+	    return -1;
+	*t = time(NULL) - n * (*end ? seconds[u - units] : 1);
+	return 0;
+    }
+    memset(&tm, 0, sizeof(tm));
+    n = sscanf(s, "%d-%d-%d%*[ T]%d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+	       &tm.tm_hour, &tm.tm_min, &tm.tm_sec);
+    if (n != 3 && n != 5 && n != 6)
+	return -1;
+    tm.tm_year -= 1900;
+    tm.tm_mon--;
+    tm.tm_isdst = -1;
+    *t = mktime(&tm);
+    return *t == (time_t) -1 ? -1 : 0;
+}
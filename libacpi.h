@@ -0,0 +1,341 @@
+/* libacpi - read battery, ac adapter, thermal and cooling information
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#ifndef _LIBACPI_H
+#define _LIBACPI_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ACPI_PATH_PROC   "/proc/acpi"
+#define ACPI_PATH_SYS   "/sys/class"
+
+/* device classes */
+#define BATTERY 0
+#define AC_ADAPTER 1
+#define THERMAL_ZONE 2
+#define COOLING_DEV 3
+#define HWMON 4			/* hardware monitoring chips, only in /sys/class */
+#define POWERCAP 5		/* RAPL and other energy counters, only in /sys/class */
+#define CPU 6			/* thermal throttling of the processors, in /sys/devices/system/cpu */
+#define ACPI_CLASSES 7
+
+#define ACPI_CLASS(type)	(1 << (type))
+#define ACPI_ALL_CLASSES	((1 << ACPI_CLASSES) - 1)
+
+/* flags for acpi_open() */
+#define ACPI_PROC	1	/* path is a /proc/acpi style tree */
+#define ACPI_KEEP_OPEN	2	/* keep the attribute files open between snapshots */
+#define ACPI_URING	4	/* read all attributes of a class in one io_uring batch if possible */
+#define ACPI_EVENTS	8	/* re-read only the devices that uevents resp. inotify report as changed,
+				   implies ACPI_KEEP_OPEN */
+#define ACPI_DETAILS	16	/* also read the design values and other files only the
+				   details show, see struct battery_info */
+#define ACPI_SHM	32	/* path is a file acpi_publish() writes, snapshots copy
+				   what was published last without any system call */
+
+/* return codes, everything below zero is an error */
+#define ACPI_OK		0
+#define ACPI_ENOMEM	-1	/* out of memory */
+#define ACPI_ENOSPC	-2	/* the snapshot buffer is too small */
+#define ACPI_ENOACPI	-3	/* the path does not exist or cannot be read */
+#define ACPI_ENODEV	-4	/* no support for the device class */
+#define ACPI_EINVAL	-5	/* invalid argument */
+#define ACPI_EBUSY	-6	/* the publisher did not finish writing in time */
+
+#define BATTERY_CHARGING    1
+#define BATTERY_DISCHARGING 2
+
+/* an attribute as it was read */
+struct field {
+	char *attr;
+	char *value;
+};
+
+/* capacities are in mAh, energies in mWh, rates in mA or mW, voltage in mV,
+ * -1 if unknown */
+struct battery_info
+{
+	char *state;
+	int charging;
+	int remaining_capacity;
+	int remaining_energy;
+	int present_rate;
+	int voltage;
+	int design_capacity;
+	int design_capacity_unit;
+	int last_capacity;
+	int last_capacity_unit;
+};
+
+struct ac_adapter_info
+{
+	char *state;
+};
+
+/* a trip point without a type was not there or could not be read */
+struct trip_point
+{
+	float temp;
+	float hyst;		/* -1 if unknown, only read with ACPI_DETAILS */
+	char *type;
+};
+
+/* temperatures are in degrees celsius; a zone has as many trip points as
+ * its directory has trip_point_<n>_* files, trip[n] is trip point n */
+struct thermal_info
+{
+	char *state;
+	float temperature;
+	int trip_points;
+	struct trip_point *trip;
+};
+
+/* what stats/ of a cooling device says, only read with ACPI_DETAILS; the
+ * tables are not among the raw attributes of the device, an entry that
+ * could not be read is -1; the deltas are since the previous snapshot of
+ * the same context like those of struct throttle */
+struct cooling_stats
+{
+	int states;		/* of the tables, 0 if there are none */
+	long long total_trans;	/* -1 if unknown */
+	long long *time_in_state_ms;	/* [states], NULL if unknown */
+	long long *trans_table;	/* [from * states + to], NULL if unknown */
+	long long total_trans_delta;	/* -1 if unknown */
+	long long *time_in_state_delta_ms;	/* NULL if unknown */
+	long long *trans_delta;
+	double interval;	/* seconds the deltas span */
+};
+
+struct cooling_info
+{
+	char *state;
+	char *type;
+	int cur_state;
+	int max_state;
+	struct cooling_stats stats;
+};
+
+#define SENSOR_TEMP	0	/* degrees celsius */
+#define SENSOR_FAN	1	/* RPM */
+#define SENSOR_POWER	2	/* watts */
+#define SENSOR_TYPES	3
+
+/* what was read of a sensor */
+#define SENSOR_INPUT	1
+#define SENSOR_CRIT	2	/* only read with ACPI_DETAILS, like max */
+#define SENSOR_MAX	4
+
+/* one input of a hwmon chip, temp<index>_input etc. */
+struct sensor
+{
+	int type;		/* SENSOR_TEMP, SENSOR_FAN or SENSOR_POWER */
+	int index;
+	int known;		/* mask of SENSOR_INPUT, SENSOR_CRIT and SENSOR_MAX */
+	char *label;		/* NULL if the chip has none */
+	double input;
+	double crit;
+	double max;
+};
+
+/* sensor[] has a slot for every type and index up to the highest one the
+ * chip has files for, the slots of inputs that are not there are unknown */
+struct hwmon_info
+{
+	char *name;		/* of the chip, e.g. coretemp */
+	int sensors;
+	struct sensor *sensor;
+};
+
+/* an energy counter; the power is averaged since the previous snapshot
+ * of the same context, so it is only known with ACPI_KEEP_OPEN from the
+ * second snapshot on */
+struct powercap_info
+{
+	char *name;		/* of the zone, e.g. package-0 or dram */
+	double energy;		/* joules, -1 if unknown */
+	double max_range;	/* joules after which the counter wraps, -1 if unknown */
+	double power;		/* watts, -1 if unknown */
+	double interval;	/* seconds the power was averaged over */
+};
+
+#define THROTTLE_CORE		0
+#define THROTTLE_PACKAGE	1
+#define THROTTLE_SCOPES		2
+
+/* what thermal_throttle/<scope>_throttle_* of a cpu say; the deltas are
+ * since the previous snapshot of the same context, so they are only known
+ * from the second snapshot on */
+struct throttle
+{
+	long long count;	/* times the cpu was throttled since boot, -1 if unknown */
+	long long total_ms;	/* time it was throttled, -1 if unknown */
+	long long max_ms;	/* the longest it was, only read with ACPI_DETAILS; -1 if unknown */
+	long long count_delta;	/* -1 if unknown */
+	long long total_delta_ms;
+};
+
+struct cpu_info
+{
+	int package;		/* topology/physical_package_id, -1 if unknown */
+	int core;		/* topology/core_id, -1 if unknown */
+	struct throttle scope[THROTTLE_SCOPES];
+	double interval;	/* seconds the deltas span */
+};
+
+/* one entry of a device directory, parsed according to its class */
+struct device_info
+{
+	int type;		/* BATTERY, AC_ADAPTER, THERMAL_ZONE, COOLING_DEV, HWMON, POWERCAP or CPU */
+	char *name;
+	int present;		/* an attribute showed up that requires the device to be there */
+	int num_fields;
+	struct field *fields;	/* the raw attributes in the order they were read */
+	union {
+		struct battery_info battery;
+		struct ac_adapter_info ac_adapter;
+		struct thermal_info thermal;
+		struct cooling_info cooling;
+		struct hwmon_info hwmon;
+		struct powercap_info powercap;
+		struct cpu_info cpu;
+	} info;
+};
+
+struct acpi_context;
+struct acpi_snapshot;
+struct acpi_publisher;
+
+/* open a context on path, which is /sys/class resp. /proc/acpi or a copy of
+ * them; a context must not be used by more than one thread at a time
+ *
+ * Pre: path != NULL, ctx != NULL
+ * Post: returns ACPI_OK and sets *ctx, or an error code
+ */
+int acpi_open(const char *path, int flags, struct acpi_context **ctx);
+
+/* read the devices of the classes given as ACPI_CLASS() mask into buf, the
+ * snapshot and everything it points to lives in buf and stays valid as long
+ * as buf does; nothing has to be freed
+ *
+ * Pre: ctx was returned by acpi_open()
+ * Post: returns ACPI_OK and sets *snap, ACPI_ENOSPC if size was too small
+ */
+int acpi_snapshot(struct acpi_context *ctx, int classes, void *buf, size_t size, struct acpi_snapshot **snap);
+
+/* the number of devices of a class in a snapshot
+ *
+ * Pre: snap != NULL
+ * Post: returns the count or ACPI_ENODEV if the class is not supported
+ *       or was not requested
+ */
+int acpi_count(const struct acpi_snapshot *snap, int type);
+
+/* a device of a snapshot
+ *
+ * Pre: snap != NULL
+ * Post: returns the device or NULL if index is out of range
+ */
+const struct device_info *acpi_device(const struct acpi_snapshot *snap, int type, int index);
+
+/* a description of a return code
+ *
+ * Pre:
+ * Post: returns a static string
+ */
+const char *acpi_strerror(int err);
+
+/* a descriptor that becomes readable when devices change, for poll()
+ *
+ * Pre: ctx was returned by acpi_open()
+ * Post: returns the descriptor or ACPI_EINVAL if ctx was not opened with
+ *       ACPI_EVENTS
+ */
+int acpi_event_fd(struct acpi_context *ctx);
+
+/* read the pending events and mark the devices they are about, the next
+ * snapshot re-reads just those; only classes that were in a snapshot
+ * before are tracked
+ *
+ * Pre: ctx was opened with ACPI_EVENTS
+ * Post: returns the ACPI_CLASS() mask of the classes that changed, 0 if
+ *       none, or an error code
+ */
+int acpi_process_events(struct acpi_context *ctx);
+
+/* have the next snapshot read every device of the given classes again,
+ * for values like temperatures that change without an event
+ *
+ * Pre: ctx was returned by acpi_open()
+ * Post: the classes are marked
+ */
+void acpi_invalidate(struct acpi_context *ctx, int classes);
+
+/* the same for a single device, called name in its struct device_info;
+ * without ACPI_EVENTS every snapshot reads every device anyway
+ *
+ * Pre: ctx was returned by acpi_open(), name != NULL
+ * Post: returns ACPI_OK, ACPI_ENODEV if the class was not in a snapshot
+ *       before or has no such device, or ACPI_EINVAL
+ */
+int acpi_invalidate_device(struct acpi_context *ctx, int type, const char *name);
+
+/* release a context and everything it holds open
+ *
+ * Pre: ctx was returned by acpi_open()
+ * Post: ctx is invalid
+ */
+void acpi_close(struct acpi_context *ctx);
+
+/* set up file for acpi_publish(); it replaces one that is there with the
+ * first snapshot, readers of the old file move on to the new one
+ *
+ * Pre: file != NULL, pub != NULL
+ * Post: returns ACPI_OK and sets *pub, ACPI_ENOACPI if the file cannot be
+ *       created, errno tells why, or ACPI_ENOMEM
+ */
+int acpi_publisher_open(const char *file, struct acpi_publisher **pub);
+
+/* write the batteries, ac adapters, thermal zones and cooling devices of
+ * a snapshot to the file, without their raw attributes; readers that opened
+ * it with ACPI_SHM never block the writer and always get a whole snapshot
+ *
+ * Pre: pub was returned by acpi_publisher_open(), snap != NULL
+ * Post: returns ACPI_OK, or ACPI_ENOACPI if the first snapshot could not
+ *       be put in place of the file, errno tells why
+ */
+int acpi_publish(struct acpi_publisher *pub, const struct acpi_snapshot *snap);
+
+/* tell the readers that nobody publishes any more and remove the file
+ *
+ * Pre: pub was returned by acpi_publisher_open()
+ * Post: pub is invalid
+ */
+void acpi_publisher_close(struct acpi_publisher *pub);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -19,7 +19,6 @@
  *  USA
  */
 
-#include <stdio.h>
 #include <stdlib.h>
 #include "list.h"
 
@@ -28,10 +27,8 @@ struct list *list_new(void *data)/*{{{*/
 	struct list *r;
 
 	r = malloc(sizeof(struct list));
-	if (!r) {
-		fprintf(stderr, "Out of memory. Could not allocate memory in list_new_node.\n");
-		exit(1);
-	}
+	if (!r)
+		return NULL;
 	r->data = data;
 	r->next = NULL;
 	return r;
@@ -42,6 +39,8 @@ struct list *list_append(struct list *node, void *data)/*{{{*/
 	struct list *r;
 	/* we actually do appends as prepends for efficiency */
 	r = list_new(data);
+	if (!r)
+		return NULL;
 	r->next = node;
 	return r;
 }
@@ -27,22 +27,18 @@ struct list {
     struct list *next;
 };
 
-struct field {
-    char *attr;
-    char *value;
-};
-
 /* create a new list
  * 
  * Pre: 
- * Post: returns a pointer to a valid linked-list
+ * Post: returns a pointer to a valid linked-list or NULL if out of memory
  */
 struct list *list_new(void *data);
 
 /* append to a list
  * 
  * Pre: none. if node == NULL this is equivalent to list_new
- * Post: returns a pointer to a valid linked-list
+ * Post: returns a pointer to a valid linked-list or NULL if out of memory,
+ *       node is left untouched then
  */
 struct list *list_append(struct list *node, void *data);
 
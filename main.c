@@ -24,47 +24,408 @@
 #include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
+#include <errno.h>
+#include <time.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdint.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
 #include "acpi.h"
+#include "report.h"
+#include "stats.h"
+#include "schedule.h"
 
-struct device device[4] = {
-			{ BATTERY, "battery", "power_supply", "BAT" },
-			{ AC_ADAPTER, "ac_adapter", "power_supply", "AC" },
-			{ THERMAL_ZONE, "thermal_zone", "thermal", "thermal_zone" },
-			{ COOLING_DEV, "fan", "thermal", "cooling_device" }
-			  };
+struct options {
+	int show_batteries;
+	int show_ac_adapter;
+	int show_thermal;
+	int show_cooling;
+	int show_hwmon;
+	int show_powercap;
+	int show_throttle;
+	int show_empty_slots;
+	int show_details;
+	int proc_interface;
+	int temperature_units;
+	int io_uring;
+	int format;
+	int daemon;
+	int no_daemon;
+	double ttl;
+	char *socket_path;
+	int publish;
+	char *shm_path;
+	int from_shm;
+	int events;
+	int adaptive;
+	char *record;
+	char *rules;
+	char *query;
+	time_t from;
+	time_t until;
+	int window;
+	double sample_interval;
+	struct trends *trends;
+};
+
+/* long options without a short one */
+#define OPT_FROM	256
+#define OPT_UNTIL	257
+#define OPT_SHM		258
+#define OPT_FROM_SHM	259
 
-static void do_show_batteries(char *acpi_path, int show_empty_slots, int show_details, int proc_interface)
+static int classes(struct options *o)
 {
-	struct list *batteries;
+	return (o->show_batteries ? ACPI_CLASS(BATTERY) : 0) |
+		(o->show_ac_adapter ? ACPI_CLASS(AC_ADAPTER) : 0) |
+		(o->show_thermal ? ACPI_CLASS(THERMAL_ZONE) : 0) |
+		(o->show_cooling ? ACPI_CLASS(COOLING_DEV) : 0) |
+		(o->show_hwmon ? ACPI_CLASS(HWMON) : 0) |
+		(o->show_powercap ? ACPI_CLASS(POWERCAP) : 0) |
+		(o->show_throttle ? ACPI_CLASS(CPU) : 0);
+}
 
-	batteries = find_devices(acpi_path, BATTERY, proc_interface);
-	print_battery_information(batteries, show_empty_slots, show_details);
-	free_devices(batteries);
+/* the classes that show what changed since the previous snapshot */
+static int counter_classes(struct options *o)
+{
+	return classes(o) & (ACPI_CLASS(POWERCAP) | ACPI_CLASS(CPU));
 }
 
-static void do_show_ac_adapter(char *acpi_path, int show_empty_slots, int proc_interface)
+/* the design values are only shown with -i, but the structured formats
+ * always carry them and the daemon does not know what it will be asked */
+static int details(struct options *o)
 {
-	struct list *ac_adapter;
+	return o->show_details || o->format != FORMAT_TEXT || o->daemon || o->publish || o->rules ? ACPI_DETAILS : 0;
+}
 
-	ac_adapter = find_devices(acpi_path, AC_ADAPTER, proc_interface);
-	print_ac_adapter_information(ac_adapter, show_empty_slots);
-	free_devices(ac_adapter);
+/* take a snapshot, NULL after telling why there is none */
+static struct acpi_snapshot *read_snapshot(struct acpi_context *ctx, int classes, void **buf, size_t *size)
+{
+	struct acpi_snapshot *snap;
+	int err;
+
+	err = take_snapshot(ctx, classes, buf, size, &snap);
+	if (err != ACPI_OK) {
+		fprintf(stderr, "%s.\n", acpi_strerror(err));
+		return NULL;
+	}
+	return snap;
 }
 
-static void do_show_thermal(char *acpi_path, int show_empty_slots, int temperature_units, int show_details, int proc_interface) {
-	struct list *thermal;
+/* read the energy and throttle counters, the next snapshot of ctx has
+ * the power and the throttling since then */
+static int read_counters(struct acpi_context *ctx, int classes)
+{
+	struct acpi_snapshot *snap;
+	void *buf = NULL;
+	size_t size = 0;
 
-	thermal = find_devices(acpi_path, THERMAL_ZONE, proc_interface);
-	print_thermal_information(thermal, show_empty_slots, temperature_units, show_details);
-	free_devices(thermal);
+	snap = read_snapshot(ctx, classes, &buf, &size);
+	free(buf);
+	return snap ? 0 : -1;
 }
 
-static void do_show_cooling(char *acpi_path, int show_empty_slots, int proc_interface) {
-	struct list *cooling;
+/* wait for the interval after a first reading, so that even a single
+ * reading shows a power and what was throttled */
+static int prime_counters(struct acpi_context *ctx, struct options *o)
+{
+	if (!counter_classes(o) || o->from_shm)
+		return 0;
+	if (read_counters(ctx, counter_classes(o)) < 0)
+		return -1;
+	sleep_interval(o->sample_interval);
+	return 0;
+}
+
+/* add a snapshot to the windows of -W */
+static int update_trends(struct acpi_snapshot *snap, struct options *o)
+{
+	if (o->trends && trends_update(o->trends, snap) < 0) {
+		fprintf(stderr, "Out of memory in update_trends()\n");
+		return -1;
+	}
+	return 0;
+}
 
-	cooling = find_devices(acpi_path, COOLING_DEV, proc_interface);
-	print_cooling_information(cooling, show_empty_slots);
-	free_devices(cooling);
+static void unsupported(int type, struct options *o)
+{
+	fprintf(stderr, "No support for device type: %s\n", get_class_name(type, o->proc_interface));
+}
+
+static int supported(struct acpi_snapshot *snap, int type, struct options *o)
+{
+	if (acpi_count(snap, type) == ACPI_ENODEV) {
+		unsupported(type, o);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static void make_request(struct options *o, const char *path, struct request *q)
+{
+	q->format = o->format;
+	q->classes = classes(o);
+	q->show_empty_slots = o->show_empty_slots;
+	q->show_details = o->show_details;
+	q->temp_units = o->temperature_units;
+	q->proc_interface = o->proc_interface;
+	q->path = path;
+	q->tag_root = FALSE;
+	q->trends = o->trends;
+}
+
+/* every format is built in the report and written at once, so that a
+ * reader of a pipe always sees whole snapshots */
+static void do_show(struct acpi_snapshot *snap, struct options *o, struct report *r)
+{
+	struct request q;
+	int type;
+
+	/* only for the message about the unsupported ones */
+	for (type = 0; type < ACPI_CLASSES; type++)
+		if (classes(o) & ACPI_CLASS(type))
+			supported(snap, type, o);
+	make_request(o, NULL, &q);
+	render_snapshot(r, snap, &q);
+	if (report_write(r, STDOUT_FILENO) < 0)
+		fprintf(stderr, "Cannot write output: %s\n", r->failed ? "Out of memory" : strerror(errno));
+}
+
+/* ask a running daemon, returns -1 if there is none that reads the same path */
+static int show_from_daemon(struct options *o, const char *acpi_path, struct report *r)
+{
+	struct request q;
+	char *path = realpath(acpi_path, NULL);
+	int type, missing, err;
+
+	make_request(o, path ? path : acpi_path, &q);
+	err = daemon_query(o->socket_path, &q, r, &missing);
+	free(path);
+	if (err < 0)
+		return -1;
+
+	for (type = 0; type < ACPI_CLASSES; type++)
+		if (missing & ACPI_CLASS(type))
+			unsupported(type, o);
+	if (report_write(r, STDOUT_FILENO) < 0)
+		fprintf(stderr, "Cannot write output: %s\n", strerror(errno));
+	return 0;
+}
+
+static int do_daemon(struct acpi_context *ctx, struct options *o, const char *acpi_path)
+{
+	char *path = realpath(acpi_path, NULL);
+	int rval;
+
+	/* the first client gets the power and throttling since the start */
+	read_counters(ctx, ACPI_CLASS(POWERCAP) | ACPI_CLASS(CPU));
+	rval = daemon_serve(ctx, o->socket_path, path ? path : acpi_path, o->proc_interface, o->ttl);
+	free(path);
+	acpi_close(ctx);
+	return rval;
+}
+
+static int add_root(char ***roots, int *num_roots, char *root)
+{
+	char **p = realloc(*roots, (*num_roots + 1) * sizeof(char *));
+
+	if (!p)
+		return -1;
+	p[(*num_roots)++] = root;
+	*roots = p;
+	return 0;
+}
+
+/* scan every root given, "-" stands for a list of roots on stdin */
+static int do_roots(struct options *o, char **args, int num_args, int jobs)
+{
+	struct request q;
+	char **roots = NULL, *line = NULL, *root;
+	size_t line_size = 0;
+	ssize_t len;
+	int i, num_roots = 0, rval;
+
+	for (i = 0; i < num_args; i++) {
+		if (strcmp(args[i], "-") != 0) {
+			root = strdup(args[i]);
+			if (!root || add_root(&roots, &num_roots, root) < 0)
+				goto oom;
+			continue;
+		}
+		while ((len = getline(&line, &line_size, stdin)) > 0) {
+			if (line[len - 1] == '\n')
+				line[--len] = '\0';
+			if (!len)
+				continue;
+			if (add_root(&roots, &num_roots, line) < 0)
+				goto oom;
+			/* the root keeps the buffer */
+			line = NULL;
+			line_size = 0;
+		}
+	}
+	free(line);
+
+	make_request(o, NULL, &q);
+	rval = num_roots ? scan_roots(roots, num_roots, jobs, (o->proc_interface ? ACPI_PROC : 0) |
+				      (o->io_uring ? ACPI_URING : 0) | details(o), &q) : 0;
+	for (i = 0; i < num_roots; i++)
+		free(roots[i]);
+	free(roots);
+	return rval;
+
+oom:
+	fprintf(stderr, "Out of memory in do_roots()\n");
+	return -1;
+}
+
+static int do_watch(struct acpi_context *ctx, struct options *o, struct report *r, double interval)
+{
+	struct acpi_snapshot *snap;
+	void *buf = NULL;
+	size_t size = 0;
+
+	for (;;) {
+		snap = read_snapshot(ctx, classes(o), &buf, &size);
+		if (!snap || update_trends(snap, o) < 0)
+			return 1;
+		do_show(snap, o, r);
+		sleep_interval(interval);
+	}
+	return 0;
+}
+
+/* read the events that are pending on pfd and those that follow shortly,
+ * returns the classes that changed or -1 */
+static int settle_events(struct acpi_context *ctx, struct pollfd *pfd)
+{
+	int n = 1, quiet, err, changed = 0;
+
+	/* a file is often written in more than one step, wait until things
+	 * settle before reading */
+	for (quiet = 0; n > 0 && quiet < EVENT_SETTLE_ROUNDS; quiet++) {
+		err = acpi_process_events(ctx);
+		if (err < 0) {
+			fprintf(stderr, "%s.\n", acpi_strerror(err));
+			return -1;
+		}
+		changed |= err;
+		n = poll(pfd, 1, EVENT_SETTLE_MS);
+	}
+	return changed;
+}
+
+/* print whenever an event says that something we show changed, and with
+ * an interval also every <interval> seconds for what changes silently */
+static int do_events(struct acpi_context *ctx, struct options *o, struct report *r, double interval)
+{
+	struct acpi_snapshot *snap;
+	struct pollfd pfd;
+	void *buf = NULL;
+	size_t size = 0;
+	int n, changed;
+
+	pfd.fd = acpi_event_fd(ctx);
+	pfd.events = POLLIN;
+	for (;;) {
+		snap = read_snapshot(ctx, classes(o), &buf, &size);
+		if (!snap || update_trends(snap, o) < 0)
+			return 1;
+		do_show(snap, o, r);
+
+		do {
+			n = poll(&pfd, 1, interval > 0 ? (int) (interval * 1000) : -1);
+			if (n < 0 && errno != EINTR) {
+				perror("poll");
+				return 1;
+			}
+			if (n == 0) {
+				acpi_invalidate(ctx, classes(o));
+				changed = classes(o);
+			} else if (n > 0) {
+				changed = settle_events(ctx, &pfd);
+				if (changed < 0)
+					return 1;
+			} else {
+				changed = 0;
+			}
+		} while (!(changed & classes(o)));
+	}
+	return 0;
+}
+
+/* read each device when the schedule says it is due, one timer wakes us
+ * for all that are due at about the same time; events are handled as in
+ * do_events() */
+static int do_adaptive(struct acpi_context *ctx, struct options *o, struct report *r, double interval)
+{
+	struct acpi_snapshot *snap;
+	struct schedule *s;
+	struct itimerspec its;
+	struct pollfd pfd[2];
+	uint64_t expired;
+	void *buf = NULL;
+	size_t size = 0;
+	double wake;
+	int n, changed, woke;
+
+	s = schedule_new(interval < SCHEDULE_MIN ? interval : SCHEDULE_MIN, interval);
+	if (!s) {
+		fprintf(stderr, "Out of memory in do_adaptive()\n");
+		return 1;
+	}
+	pfd[0].fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (pfd[0].fd < 0) {
+		perror("timerfd_create");
+		return 1;
+	}
+	pfd[0].events = POLLIN;
+	pfd[1].fd = acpi_event_fd(ctx);
+	pfd[1].events = POLLIN;
+	memset(&its, 0, sizeof(its));
+
+	for (;;) {
+		snap = read_snapshot(ctx, classes(o), &buf, &size);
+		if (!snap || update_trends(snap, o) < 0)
+			return 1;
+		if (schedule_update(s, snap) < 0) {
+			fprintf(stderr, "Out of memory in do_adaptive()\n");
+			return 1;
+		}
+		do_show(snap, o, r);
+
+		/* nothing to wait for but events disarms the timer */
+		wake = schedule_wakeup(s);
+		its.it_value.tv_sec = wake > 0 ? (time_t) wake : 0;
+		its.it_value.tv_nsec = wake > 0 ? (long) ((wake - its.it_value.tv_sec) * 1e9) : 0;
+		if (timerfd_settime(pfd[0].fd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+			perror("timerfd_settime");
+			return 1;
+		}
+
+		/* the timer is armed again after every snapshot */
+		do {
+			changed = woke = 0;
+			if (poll(pfd, 2, -1) < 0) {
+				if (errno == EINTR)
+					continue;
+				perror("poll");
+				return 1;
+			}
+			if ((pfd[0].revents & POLLIN) && read(pfd[0].fd, &expired, sizeof(expired)) > 0) {
+				schedule_run(s, ctx);
+				woke = TRUE;
+			}
+			if (pfd[1].revents & POLLIN) {
+				n = settle_events(ctx, &pfd[1]);
+				if (n < 0)
+					return 1;
+				changed |= n;
+			}
+		} while (!woke && !(changed & classes(o)));
+	}
+	return 0;
 }
 
 static int version(void)
@@ -90,15 +451,55 @@ static int usage(char *argv[])
 "  -i, --details            show additional details if available:\n"
 "                             - battery capacity information\n"
 "                             - temperature trip points\n"
+"                             - sensor limits\n"
+"                             - energy counters\n"
+"                             - longest throttling\n"
+"                             - cooling state statistics\n"
 "  -a, --ac-adapter         ac adapter information\n"
 "  -t, --thermal            thermal information\n"
 "  -c, --cooling            cooling information\n"
+"  -m, --hwmon              hardware monitoring sensors (temperatures, fans, power)\n"
+"  -P, --powercap           power of the powercap (RAPL) zones\n"
+"  -x, --throttle           thermal throttling of the packages and cores\n"
+"  -I, --sample-interval <seconds>\n"
+"                           average the power and count the throttling of a\n"
+"                           single reading over <seconds> (default 0.25)\n"
 "  -V, --everything         show every device, overrides above options\n"
-"  -s, --show-empty         show non-operational devices\n"
+"  -s, --show-empty         show non-operational devices and every core\n"
 "  -f, --fahrenheit         use fahrenheit as the temperature unit\n"
 "  -k, --kelvin             use kelvin as the temperature unit\n"
-"  -d, --directory <dir>    path to ACPI info (/sys/class resp. /proc/acpi)\n"
+"  -d, --directory <dir>    path to ACPI info (/sys/class resp. /proc/acpi),\n"
+"                           may be repeated, - reads a list of paths from stdin\n"
 "  -p, --proc               use old proc interface instead of new sys interface\n"
+"  -j, --jobs <n>           read <n> directories at once if more than one is given\n"
+"  -w, --watch <seconds>    keep running and refresh every <seconds>\n"
+"  -e, --events             keep running and refresh when devices report changes,\n"
+"                           with -w also every <seconds>\n"
+"  -A, --adaptive           keep running and read each device as often as it\n"
+"                           changes, but at least every <seconds> of -w\n"
+"                           (default 8, twice that on ac)\n"
+"  -u, --io-uring           read all attributes in one io_uring batch if possible\n"
+"  -F, --format <format>    print text (default), json, csv or prom(etheus)\n"
+"  -D, --daemon             serve the information to other acpi calls\n"
+"  -T, --ttl <seconds>      let the daemon read at most every <seconds>\n"
+"  -S, --socket <path>      socket of the daemon (default " ACPI_SOCKET_PATH ")\n"
+"  -N, --no-daemon          always read the information directly\n"
+"  -M, --publish            keep running and publish the batteries, ac adapters,\n"
+"                           thermal zones and cooling devices in shared memory\n"
+"                           every <seconds> of -w (default 1)\n"
+"      --shm <file>         the shared memory file (default " ACPI_SHM_PATH ")\n"
+"      --from-shm           show what was published last instead of reading\n"
+"                           the devices\n"
+"  -R, --record <file>      append a sample to <file> every <seconds> of -w\n"
+"                           (default 60) instead of printing\n"
+"  -r, --rules <file>       keep running and check the rules in <file> every\n"
+"                           <seconds> of -w (default 1), see acpi(1)\n"
+"  -Q, --query <file>       summarize the samples recorded in <file>\n"
+"      --from <time>        only samples since <time>: now, -<n>[smhdw],\n"
+"                           @<epoch seconds> or YYYY-MM-DD [HH:MM[:SS]]\n"
+"      --until <time>       only samples up to <time> (default now)\n"
+"  -W, --window <n>         with -w or -e, smooth rates and temperatures over\n"
+"                           the last <n> samples and show their trends\n"
 "  -h, --help               display this help and exit\n"
 "  -v, --version            output version information and exit\n"
 "\n"
@@ -119,6 +520,11 @@ static struct option long_options[] = {
 	{ "ac-adapter", 0, 0, 'a' }, 
 	{ "thermal", 0, 0, 't' }, 
 	{ "cooling", 0, 0, 'c' }, 
+	{ "hwmon", 0, 0, 'm' },
+	{ "powercap", 0, 0, 'P' },
+	{ "throttle", 0, 0, 'x' },
+	{ "sample-interval", 1, 0, 'I' },
+	{ "power-interval", 1, 0, 'I' },
 	{ "show-empty", 0, 0, 's' }, 
 	{ "fahrenheit", 0, 0, 'f' }, 
 	{ "kelvin", 0, 0, 'k' }, 
@@ -126,20 +532,41 @@ static struct option long_options[] = {
 	{ "everything", 0, 0, 'V' }, 
 	{ "proc", 0, 0, 'p' }, 
 	{ "details", 0, 0, 'i' }, 
+	{ "watch", 1, 0, 'w' },
+	{ "io-uring", 0, 0, 'u' },
+	{ "events", 0, 0, 'e' },
+	{ "adaptive", 0, 0, 'A' },
+	{ "format", 1, 0, 'F' },
+	{ "daemon", 0, 0, 'D' },
+	{ "ttl", 1, 0, 'T' },
+	{ "socket", 1, 0, 'S' },
+	{ "no-daemon", 0, 0, 'N' },
+	{ "publish", 0, 0, 'M' },
+	{ "shm", 1, 0, OPT_SHM },
+	{ "from-shm", 0, 0, OPT_FROM_SHM },
+	{ "jobs", 1, 0, 'j' },
+	{ "record", 1, 0, 'R' },
+	{ "rules", 1, 0, 'r' },
+	{ "query", 1, 0, 'Q' },
+	{ "from", 1, 0, OPT_FROM },
+	{ "until", 1, 0, OPT_UNTIL },
+	{ "window", 1, 0, 'W' },
 	{ 0, 0, 0, 0 }, 
 };
 
 int main(int argc, char *argv[])
 {
-	int show_batteries = FALSE;
-	int show_ac_adapter = FALSE;
-	int show_thermal = FALSE;
-	int show_cooling = FALSE;
-	int show_empty_slots = FALSE;
-	int show_details = FALSE;
-	int proc_interface = FALSE;
-	int temperature_units = TEMP_CELSIUS;
-	int ch, option_index;
+	struct options o = { FALSE, FALSE, FALSE, FALSE, FALSE, FALSE, FALSE, FALSE, FALSE, FALSE, TEMP_CELSIUS, FALSE, FORMAT_TEXT,
+				FALSE, FALSE, DAEMON_TTL, ACPI_SOCKET_PATH, FALSE, ACPI_SHM_PATH, FALSE, FALSE, FALSE, NULL, NULL, NULL, 0, 0, 0, SAMPLE_INTERVAL, NULL };
+	struct report report;
+	struct acpi_context *ctx;
+	struct acpi_snapshot *snap;
+	void *buf = NULL;
+	size_t size = 0;
+	double watch_interval = 0;
+	char **roots = NULL;
+	int num_roots = 0, jobs = 0, everything = FALSE;
+	int ch, option_index, err;
 	char *acpi_path = strdup(ACPI_PATH_SYS);
 
 	if (!acpi_path) {
@@ -147,40 +574,58 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
-	while ((ch = getopt_long(argc, argv, "ipVbtashvfkcd:", long_options, &option_index)) != -1) {
+	while ((ch = getopt_long(argc, argv, "ipVbtashvfkcmPxI:ueAd:w:F:DT:S:NMj:R:r:Q:W:", long_options, &option_index)) != -1) {
 		switch (ch) {
 			case 'V':
-				show_batteries = show_ac_adapter = show_thermal = show_cooling = show_details = TRUE;
+				o.show_batteries = o.show_ac_adapter = o.show_thermal = o.show_cooling = o.show_details = TRUE;
+				everything = TRUE;
 				break;
 			case 'b':
-				show_batteries = TRUE;
+				o.show_batteries = TRUE;
 				break;
 			case 'a':
-				show_ac_adapter = TRUE;
+				o.show_ac_adapter = TRUE;
 				break;
 			case 't':
-				show_thermal = TRUE;
+				o.show_thermal = TRUE;
 				break;
 			case 'c':
-				show_cooling = TRUE;
+				o.show_cooling = TRUE;
+				break;
+			case 'm':
+				o.show_hwmon = TRUE;
+				break;
+			case 'P':
+				o.show_powercap = TRUE;
+				break;
+			case 'x':
+				o.show_throttle = TRUE;
+				break;
+			case 'I':
+				o.sample_interval = strtod(optarg, NULL);
+				if (o.sample_interval <= 0) {
+					fprintf(stderr, "Invalid sample interval: %s\n", optarg);
+					return -1;
+				}
 				break;
 			case 's':
-				show_empty_slots = TRUE;
+				o.show_empty_slots = TRUE;
 				break;
 			case 'i':
-				show_details = TRUE;
+				o.show_details = TRUE;
 				break;
 			case 'v':
 				return version();
 				break;
 			case 'f':
-				temperature_units = TEMP_FAHRENHEIT;
+				o.temperature_units = TEMP_FAHRENHEIT;
 				break;
 			case 'k':
-				temperature_units = TEMP_KELVIN;
+				o.temperature_units = TEMP_KELVIN;
 				break;
 			case 'p':
-				proc_interface = TRUE;
+				o.proc_interface = TRUE;
+				num_roots = 0;
 				free(acpi_path);
 				acpi_path = strdup(ACPI_PATH_PROC);
 				if (!acpi_path) {
@@ -191,33 +636,240 @@ int main(int argc, char *argv[])
 			case 'd':
 				free(acpi_path);
 				acpi_path = strdup(optarg);
-				if (!acpi_path) {
+				if (!acpi_path || add_root(&roots, &num_roots, optarg) < 0) {
 					fprintf(stderr, "Out of memory in main()\n");
 					return -1;
 				}
 				break;
+			case 'j':
+				jobs = atoi(optarg);
+				if (jobs <= 0) {
+					fprintf(stderr, "Invalid number of jobs: %s\n", optarg);
+					return -1;
+				}
+				break;
+			case 'w':
+				watch_interval = strtod(optarg, NULL);
+				if (watch_interval <= 0) {
+					fprintf(stderr, "Invalid watch interval: %s\n", optarg);
+					return -1;
+				}
+				break;
+			case 'u':
+				o.io_uring = TRUE;
+				break;
+			case 'e':
+				o.events = TRUE;
+				break;
+			case 'A':
+				o.adaptive = TRUE;
+				break;
+			case 'F':
+				if (!strcmp(optarg, "text"))
+					o.format = FORMAT_TEXT;
+				else if (!strcmp(optarg, "json"))
+					o.format = FORMAT_JSON;
+				else if (!strcmp(optarg, "csv"))
+					o.format = FORMAT_CSV;
+				else if (!strcmp(optarg, "prom") || !strcmp(optarg, "prometheus"))
+					o.format = FORMAT_PROM;
+				else {
+					fprintf(stderr, "Invalid output format: %s\n", optarg);
+					return -1;
+				}
+				break;
+			case 'D':
+				o.daemon = TRUE;
+				break;
+			case 'T':
+				o.ttl = strtod(optarg, NULL);
+				if (o.ttl < 0) {
+					fprintf(stderr, "Invalid ttl: %s\n", optarg);
+					return -1;
+				}
+				break;
+			case 'S':
+				o.socket_path = optarg;
+				break;
+			case 'N':
+				o.no_daemon = TRUE;
+				break;
+			case 'M':
+				o.publish = TRUE;
+				break;
+			case OPT_SHM:
+				o.shm_path = optarg;
+				break;
+			case OPT_FROM_SHM:
+				o.from_shm = TRUE;
+				break;
+			case 'R':
+				o.record = optarg;
+				break;
+			case 'r':
+				o.rules = optarg;
+				break;
+			case 'Q':
+				o.query = optarg;
+				break;
+			case OPT_FROM:
+			case OPT_UNTIL:
+				if (history_parse_time(optarg, ch == OPT_FROM ? &o.from : &o.until) < 0) {
+					fprintf(stderr, "Invalid time: %s\n", optarg);
+					return -1;
+				}
+				break;
+			case 'W':
+				o.window = atoi(optarg);
+				if (o.window <= 0) {
+					fprintf(stderr, "Invalid window: %s\n", optarg);
+					return -1;
+				}
+				break;
 			case 'h':
 			default:
 				return usage(argv);
 		}
 	}
 
+	/* /proc/acpi never had the sensors, and they are not published */
+	if (everything && !o.proc_interface && !o.from_shm)
+		o.show_hwmon = TRUE;
+
 	/* if nothing was chosen, we show the battery information */
-	if (!show_batteries && !show_ac_adapter && !show_thermal && !show_cooling)
-		show_batteries = TRUE;
+	if (!o.show_batteries && !o.show_ac_adapter && !o.show_thermal && !o.show_cooling && !o.show_hwmon && !o.show_powercap &&
+	    !o.show_throttle)
+		o.show_batteries = TRUE;
+
+	if (o.query) {
+		if (o.format != FORMAT_TEXT) {
+			fprintf(stderr, "Queries only print text\n");
+			return -1;
+		}
+		free(acpi_path);
+		free(roots);
+		return history_query(o.query, classes(&o), o.from, o.until ? o.until : time(NULL), o.temperature_units);
+	}
+
+	if (o.adaptive && (o.daemon || o.record || o.publish || o.rules || o.from_shm)) {
+		fprintf(stderr, "Adaptive mode only works when showing what is read\n");
+		return -1;
+	}
+	if (o.adaptive && watch_interval <= 0)
+		watch_interval = ADAPTIVE_INTERVAL;
+
+	if (o.window && (o.daemon || o.record || o.publish || (watch_interval <= 0 && !o.events))) {
+		fprintf(stderr, "A window needs watch or events mode\n");
+		return -1;
+	}
+
+	if (o.from_shm && (o.daemon || o.record || o.publish || o.events || num_roots)) {
+		fprintf(stderr, "What was published can only be shown, once or in watch mode, or checked against rules\n");
+		return -1;
+	}
+
+	if (o.rules && (o.daemon || o.record || o.publish || o.events || o.window)) {
+		fprintf(stderr, "Rules cannot be checked in daemon, record, publish, events or window mode\n");
+		return -1;
+	}
+
+	if (num_roots > 1 || (num_roots == 1 && !strcmp(roots[0], "-"))) {
+		if (o.daemon || watch_interval > 0 || o.events || o.record || o.publish || o.rules) {
+			fprintf(stderr, "Watch, daemon, record, publish and rules mode take only one directory\n");
+			return -1;
+		}
+		err = do_roots(&o, roots, num_roots, jobs);
+		free(roots);
+		free(acpi_path);
+		return err;
+	}
+	free(roots);
+
+	if (o.window) {
+		o.trends = trends_new(o.window);
+		if (!o.trends) {
+			fprintf(stderr, "Out of memory in main()\n");
+			return -1;
+		}
+	}
+
+	/* the structured formats and the answers of the daemon are built in
+	 * one buffer and written at once */
+	if (report_init(&report, BUF_SIZE * 16) < 0) {
+		fprintf(stderr, "Out of memory in main()\n");
+		return -1;
+	}
+
+	if (!o.daemon && !o.no_daemon && watch_interval <= 0 && !o.events && !o.record && !o.publish && !o.rules &&
+	    !o.from_shm && show_from_daemon(&o, acpi_path, &report) == 0) {
+		report_free(&report);
+		free(acpi_path);
+		return 0;
+	}
 
-	if (show_batteries) {
-		do_show_batteries(acpi_path, show_empty_slots, show_details, proc_interface);
+	if (o.from_shm) {
+		err = acpi_open(o.shm_path, ACPI_SHM, &ctx);
+		if (err == ACPI_ENOACPI) {
+			fprintf(stderr, "Nothing is published in %s\n", o.shm_path);
+			return 1;
+		}
+	} else {
+		/* the energy counters are read twice even for a single reading */
+		err = acpi_open(acpi_path, (o.proc_interface ? ACPI_PROC : 0) |
+				(watch_interval > 0 || o.daemon || o.record || o.publish || o.rules || o.show_powercap ?
+				 ACPI_KEEP_OPEN : 0) |
+				(o.events || o.adaptive ? ACPI_EVENTS : 0) | details(&o) |
+				(o.io_uring ? ACPI_URING : 0), &ctx);
+	}
+	if (err == ACPI_ENOACPI) {
+		fprintf(stderr, "No ACPI support in kernel, or incorrect acpi_path (\"%s\").\n", acpi_path);
+		return 1;
+	} else if (err != ACPI_OK) {
+		fprintf(stderr, "%s.\n", acpi_strerror(err));
+		return 1;
 	}
-	if (show_ac_adapter) {
-		do_show_ac_adapter(acpi_path, show_empty_slots, proc_interface);
+
+	if (o.daemon)
+		return do_daemon(ctx, &o, acpi_path);
+	if (o.publish) {
+		err = publish_serve(ctx, o.shm_path, watch_interval > 0 ? watch_interval : DAEMON_TTL);
+		acpi_close(ctx);
+		report_free(&report);
+		free(acpi_path);
+		return err;
 	}
-	if (show_thermal) {
-		do_show_thermal(acpi_path, show_empty_slots, temperature_units, show_details, proc_interface);
+	if (o.rules) {
+		err = rules_run(ctx, o.rules, watch_interval > 0 ? watch_interval : RULES_INTERVAL);
+		acpi_close(ctx);
+		report_free(&report);
+		free(acpi_path);
+		return err;
 	}
-	if (show_cooling) {
-		do_show_cooling(acpi_path, show_empty_slots, proc_interface);
+	if (prime_counters(ctx, &o) < 0)
+		return 1;
+	if (o.record) {
+		err = history_record(ctx, o.record, classes(&o), watch_interval > 0 ? watch_interval : HISTORY_INTERVAL);
+		acpi_close(ctx);
+		report_free(&report);
+		free(acpi_path);
+		return err;
 	}
+
+	if (o.adaptive)
+		return do_adaptive(ctx, &o, &report, watch_interval);
+	if (o.events)
+		return do_events(ctx, &o, &report, watch_interval);
+	if (watch_interval > 0)
+		return do_watch(ctx, &o, &report, watch_interval);
+
+	snap = read_snapshot(ctx, classes(&o), &buf, &size);
+	if (!snap)
+		return 1;
+	do_show(snap, &o, &report);
+
+	report_free(&report);
+	free(buf);
+	acpi_close(ctx);
+	free(acpi_path);
 	return 0;
 }
-
@@ -0,0 +1,558 @@
+/* prints the information read by libacpi in the traditional format
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "acpi.h"
+#include "stats.h"
+
+#define BATTERY_DESC	"Battery"
+#define AC_ADAPTER_DESC "Adapter"
+#define THERMAL_DESC	"Thermal"
+#define COOLING_DESC	"Cooling"
+#define HWMON_DESC	"Hwmon"
+#define POWERCAP_DESC	"Powercap"
+#define PACKAGE_DESC	"Package"
+
+/* derive what is shown of a battery from the values that were read */
+void get_battery_status(const struct battery_info *battery, struct battery_status *s)
+{
+    struct battery_info b = *battery;
+
+    strcpy(s->capacity_unit, "mAh");
+    /* convert energy values (in mWh) to charge values (in mAh) if needed and possible */
+    if (b.last_capacity_unit != -1 && b.last_capacity == -1) {
+	if (b.voltage != -1) {
+	    b.last_capacity = b.last_capacity_unit * 1000 / b.voltage;
+	} else {
+	    b.last_capacity = b.last_capacity_unit;
+	    strcpy(s->capacity_unit, "mWh");
+	}
+    }
+    if (b.design_capacity_unit != -1 && b.design_capacity == -1) {
+	if (b.voltage != -1) {
+	    b.design_capacity = b.design_capacity_unit * 1000 / b.voltage;
+	} else {
+	    b.design_capacity = b.design_capacity_unit;
+	    strcpy(s->capacity_unit, "mWh");
+	}
+    }
+    if (b.remaining_energy != -1 && b.remaining_capacity == -1) {
+	if (b.voltage != -1) {
+	    b.remaining_capacity = b.remaining_energy * 1000 / b.voltage;
+	    b.present_rate = b.present_rate * 1000 / b.voltage;
+	} else {
+	    b.remaining_capacity = b.remaining_energy;
+	}
+    }
+    if (b.last_capacity < MIN_CAPACITY)
+	s->percentage = 0;
+    else
+	s->percentage = b.remaining_capacity * 100 / b.last_capacity;
+
+    if (s->percentage > 100)
+	s->percentage = 100;
+
+    if (b.present_rate == -1) {
+	s->poststr = "rate information unavailable";
+	s->seconds = -1;
+    } else if (b.charging == BATTERY_CHARGING) {
+	if (b.present_rate > MIN_PRESENT_RATE) {
+	    s->seconds = 3600 * (b.last_capacity - b.remaining_capacity) / b.present_rate;
+	    s->poststr = " until charged";
+	} else {
+	    s->poststr = "charging at zero rate - will never fully charge.";
+	    s->seconds = -1;
+	}
+    } else if (b.charging == BATTERY_DISCHARGING) {
+	if (b.present_rate > MIN_PRESENT_RATE) {
+	    s->seconds = 3600 * b.remaining_capacity / b.present_rate;
+	    s->poststr = " remaining";
+	} else {
+	    s->poststr = "discharging at zero rate - will never fully discharge.";
+	    s->seconds = -1;
+	}
+    } else {
+	s->poststr = NULL;
+	s->seconds = -1;
+    }
+
+    s->health = -1;
+    if (b.design_capacity > 0) {
+	if (b.last_capacity <= 100) {
+	    /* some broken systems just give a percentage here */
+	    s->health = b.last_capacity;
+	    b.last_capacity = s->health * b.design_capacity / 100;
+	} else {
+	    s->health = b.last_capacity * 100 / b.design_capacity;
+	}
+	if (s->health > 100)
+	    s->health = 100;
+    }
+    s->remaining_capacity = b.remaining_capacity;
+    s->present_rate = b.present_rate;
+    s->last_capacity = b.last_capacity;
+    s->design_capacity = b.design_capacity;
+}
+
+/* the same with the rate smoothed over the window instead of the last
+ * reading, which jumps around too much for a time estimate */
+void get_smoothed_status(const struct battery_info *battery, const struct window *w, struct battery_status *s)
+{
+    struct battery_info b = *battery;
+
+    if (w && b.present_rate != -1)
+	b.present_rate = (int) (window_ewma(w) + 0.5);
+    get_battery_status(&b, s);
+}
+
+/* the directory of a class as "No support for device type" names it; the
+ * cpus are not a class of their own, only their last path component is */
+const char *get_class_name(int type, int proc_interface)
+{
+    const char *name = proc_interface ? device[type].proc : device[type].sys;
+
+    return strrchr(name, '/') ? strrchr(name, '/') + 1 : name;
+}
+
+/* the rates are shown as they were read, in mW if the battery reports energies */
+static const char *rate_unit(const struct battery_info *b)
+{
+    return b->remaining_energy != -1 ? "mW" : "mA";
+}
+
+void print_battery_information(FILE *out, const struct acpi_snapshot *snap, int show_empty_slots, int show_capacity,
+			       const struct trends *trends)
+{
+    const struct device_info *dev;
+    const struct window *w;
+    int i, battery_num = 1;
+
+    for (i = 0; i < acpi_count(snap, BATTERY); i++) {
+	struct battery_status s;
+	int hours, minutes, seconds;
+
+	dev = acpi_device(snap, BATTERY, i);
+	if (!dev->info.battery.state) {
+	    if (show_empty_slots) 
+		fprintf(out, "%s %d: slot empty\n", BATTERY_DESC, battery_num - 1);
+	} else {
+	    w = trends_find(trends, dev);
+	    get_smoothed_status(&dev->info.battery, w, &s);
+
+	    fprintf(out, "%s %d: %s, %d%%", BATTERY_DESC, battery_num - 1, dev->info.battery.state, s.percentage);
+
+	    seconds = s.seconds;
+	    if (seconds > 0) {
+		hours = seconds / 3600;
+		seconds -= 3600 * hours;
+		minutes = seconds / 60;
+		seconds -= 60 * minutes;
+		fprintf(out, ", %02d:%02d:%02d%s", hours, minutes, seconds, s.poststr);
+	    } else if (s.poststr != NULL) {
+		fprintf(out, ", %s", s.poststr);
+	    }
+
+	    fprintf(out, "\n");
+
+	    if (show_capacity && s.health >= 0) {
+		fprintf(out, "%s %d: design capacity %d %s, last full capacity %d %s = %d%%\n",
+		     BATTERY_DESC, battery_num - 1, s.design_capacity, s.capacity_unit, s.last_capacity, s.capacity_unit, s.health);
+	    }
+	    if (show_capacity && w) {
+		fprintf(out, "%s %d: rate %.0f %s smoothed, mean %.0f, deviation %.0f, min %.0f, max %.0f, "
+			"median %.0f, 90%% below %.0f over %d samples\n", BATTERY_DESC, battery_num - 1,
+			window_ewma(w), rate_unit(&dev->info.battery), window_mean(w), window_stddev(w), window_min(w),
+			window_max(w), window_quantile(w, WINDOW_MEDIAN), window_quantile(w, WINDOW_P90), w->count);
+	    }
+	}
+	battery_num++;
+    }
+}
+
+void print_ac_adapter_information(FILE *out, const struct acpi_snapshot *snap, int show_empty_slots)
+{
+    const struct device_info *dev;
+    int i, adapter_num = 1;
+
+    for (i = 0; i < acpi_count(snap, AC_ADAPTER); i++) {
+	dev = acpi_device(snap, AC_ADAPTER, i);
+	if (!dev->info.ac_adapter.state) {
+	    if (show_empty_slots) 
+		fprintf(out, "%s %d: slot empty\n", AC_ADAPTER_DESC, adapter_num - 1);
+	} else  {
+	    fprintf(out, "%s %d: %s\n", AC_ADAPTER_DESC, adapter_num - 1, dev->info.ac_adapter.state);
+	}
+
+	adapter_num++;
+    }
+}
+
+double get_real_temp(float temperature, char **scale, int temp_units)
+{
+	double real_temp = (double) temperature;
+
+	switch (temp_units) {
+	case TEMP_CELSIUS:
+	    *scale = "degrees C";
+	    break;
+	case TEMP_FAHRENHEIT:
+	    real_temp = (real_temp * 1.8) + 32;
+	    *scale = "degrees F";
+	    break;
+	case TEMP_KELVIN:
+	default:
+	    real_temp += ABSOLUTE_ZERO;
+	    *scale = "kelvin";
+	    break;
+	}
+	return (real_temp);
+}
+
+/* a temperature difference in the unit of temp_units */
+double get_temp_delta(double delta, int temp_units)
+{
+    return temp_units == TEMP_FAHRENHEIT ? delta * 1.8 : delta;
+}
+
+void print_thermal_information(FILE *out, const struct acpi_snapshot *snap, int show_empty_slots, int temp_units, int show_trip_points,
+			       const struct trends *trends)
+{
+    const struct device_info *dev;
+    const struct thermal_info *t;
+    const struct window *w;
+    int n, sensor_num = 1;
+
+    for (n = 0; n < acpi_count(snap, THERMAL_ZONE); n++) {
+	char *scale;
+	double real_temp, slope;
+	int i;
+
+	dev = acpi_device(snap, THERMAL_ZONE, n);
+	t = &dev->info.thermal;
+	if (!t->state) {
+	    if (show_empty_slots) 
+		fprintf(out, "%s %d: slot empty\n", THERMAL_DESC, sensor_num - 1);
+	} else {
+	    real_temp = get_real_temp(t->temperature, &scale, temp_units);
+	    fprintf(out, "%s %d: %s, %.1f %s\n", THERMAL_DESC, sensor_num - 1, t->state, real_temp, scale);
+	    w = trends_find(trends, dev);
+	    if (w && w->count > 1) {
+		slope = get_temp_delta(window_slope(w) * 60, temp_units);
+		if (slope >= 0.05 || slope <= -0.05)
+		    fprintf(out, "%s %d: %s at %.1f %s per minute\n", THERMAL_DESC, sensor_num - 1,
+			    slope > 0 ? "rising" : "falling", slope > 0 ? slope : -slope, scale);
+		else
+		    fprintf(out, "%s %d: steady\n", THERMAL_DESC, sensor_num - 1);
+	    }
+	    if (show_trip_points && w) {
+		fprintf(out, "%s %d: min %.1f max %.1f average %.1f median %.1f, 90%% below %.1f %s over %d samples\n",
+			THERMAL_DESC, sensor_num - 1, get_real_temp(window_min(w), &scale, temp_units),
+			get_real_temp(window_max(w), &scale, temp_units), get_real_temp(window_mean(w), &scale, temp_units),
+			get_real_temp(window_quantile(w, WINDOW_MEDIAN), &scale, temp_units),
+			get_real_temp(window_quantile(w, WINDOW_P90), &scale, temp_units), scale, w->count);
+	    }
+	    if (show_trip_points) {
+		for (i = 0; i < t->trip_points; i++)
+		{
+		    if (t->trip[i].type && t->trip[i].temp >= MIN_TEMP) {
+			    real_temp = get_real_temp(t->trip[i].temp, &scale, temp_units);
+			    fprintf(out, "%s %d: trip point %d switches to mode %s at temperature %.1f %s",
+			    THERMAL_DESC, sensor_num - 1, i, t->trip[i].type, real_temp, scale);
+			    if (t->trip[i].hyst >= 0)
+				fprintf(out, ", hysteresis %.1f %s", get_temp_delta(t->trip[i].hyst, temp_units), scale);
+			    fprintf(out, "\n");
+		    }
+		}
+	    }
+	}
+	sensor_num++;
+    }
+}
+
+/* the counters of stats/, the states that were never in use and the
+ * transitions that never happened are left out */
+static void print_cooling_stats(FILE *out, const struct cooling_stats *st, int num)
+{
+    int i, j, k, first;
+
+    if (st->total_trans >= 0) {
+	fprintf(out, "%s %d: %lld transitions", COOLING_DESC, num, st->total_trans);
+	if (st->total_trans_delta >= 0)
+	    fprintf(out, ", %lld in the last %.0f ms", st->total_trans_delta, st->interval * 1000);
+	fprintf(out, "\n");
+    }
+    for (i = 0; st->time_in_state_ms && i < st->states; i++) {
+	if (st->time_in_state_ms[i] <= 0)
+	    continue;
+	fprintf(out, "%s %d: state %d for %lld ms", COOLING_DESC, num, i, st->time_in_state_ms[i]);
+	if (st->time_in_state_delta_ms)
+	    fprintf(out, ", %lld ms in the last %.0f ms", st->time_in_state_delta_ms[i], st->interval * 1000);
+	fprintf(out, "\n");
+    }
+    /* a line per state that was left, the table is mostly zeros */
+    for (i = 0; st->trans_table && i < st->states; i++) {
+	for (j = 0, first = TRUE; j < st->states; j++) {
+	    k = i * st->states + j;
+	    if (st->trans_table[k] <= 0)
+		continue;
+	    if (first)
+		fprintf(out, "%s %d: from state %d", COOLING_DESC, num, i);
+	    fprintf(out, "%s to %d %lld times", first ? "" : ",", j, st->trans_table[k]);
+	    if (st->trans_delta)
+		fprintf(out, " (+%lld)", st->trans_delta[k]);
+	    first = FALSE;
+	}
+	if (!first)
+	    fprintf(out, "\n");
+    }
+}
+
+void print_cooling_information(FILE *out, const struct acpi_snapshot *snap, int show_empty_slots, int show_stats)
+{
+    const struct cooling_info *c;
+    int i, sensor_num = 1;
+
+    for (i = 0; i < acpi_count(snap, COOLING_DEV); i++) {
+	c = &acpi_device(snap, COOLING_DEV, i)->info.cooling;
+	if (!c->state && !c->type) {
+	    if (show_empty_slots)
+		fprintf(out, "%s %d: slot empty\n", COOLING_DESC, sensor_num - 1);
+	} else if (c->state) {
+	    fprintf(out, "%s %d: %s\n", COOLING_DESC, sensor_num - 1, c->state);
+	} else if (c->cur_state < 0 || c->max_state < 0) {
+	    fprintf(out, "%s %d: %s no state information available\n", COOLING_DESC, sensor_num - 1, c->type);
+	} else {
+	    fprintf(out, "%s %d: %s %d of %d\n", COOLING_DESC, sensor_num - 1, c->type, c->cur_state, c->max_state);
+	}
+	if (show_stats)
+	    print_cooling_stats(out, &c->stats, sensor_num - 1);
+
+	sensor_num++;
+    }
+}
+
+static char *sensor_type_name[SENSOR_TYPES] = { "temp", "fan", "power" };
+
+/* the label of a sensor, or its file name if the chip gives none */
+const char *get_sensor_label(const struct sensor *s, char *buf, size_t size)
+{
+    if (s->label)
+	return s->label;
+    snprintf(buf, size, "%s%d", sensor_type_name[s->type], s->index);
+    return buf;
+}
+
+/* a value of a sensor in the unit it is shown in */
+double get_sensor_value(const struct sensor *s, double value, char **unit, int temp_units)
+{
+    switch (s->type) {
+    case SENSOR_TEMP:
+	return get_real_temp(value, unit, temp_units);
+    case SENSOR_FAN:
+	*unit = "RPM";
+	break;
+    default:
+	*unit = "W";
+	break;
+    }
+    return value;
+}
+
+static void print_sensor_value(FILE *out, const struct sensor *s, double value, int temp_units)
+{
+    char *unit;
+
+    value = get_sensor_value(s, value, &unit, temp_units);
+    fprintf(out, s->type == SENSOR_FAN ? "%.0f %s" : "%.1f %s", value, unit);
+}
+
+void print_hwmon_information(FILE *out, const struct acpi_snapshot *snap, int show_empty_slots, int temp_units, int show_limits)
+{
+    const struct device_info *dev;
+    const struct sensor *s;
+    char label[32];
+    int n, i, chip_num = 1;
+
+    for (n = 0; n < acpi_count(snap, HWMON); n++) {
+	dev = acpi_device(snap, HWMON, n);
+	if (!dev->present) {
+	    if (show_empty_slots)
+		fprintf(out, "%s %d: slot empty\n", HWMON_DESC, chip_num - 1);
+	} else {
+	    for (i = 0; i < dev->info.hwmon.sensors; i++) {
+		s = &dev->info.hwmon.sensor[i];
+		if (!(s->known & SENSOR_INPUT))
+		    continue;
+		fprintf(out, "%s %d: %s %s, ", HWMON_DESC, chip_num - 1,
+			dev->info.hwmon.name ? dev->info.hwmon.name : dev->name, get_sensor_label(s, label, sizeof(label)));
+		print_sensor_value(out, s, s->input, temp_units);
+		if (show_limits && (s->known & SENSOR_MAX)) {
+		    fprintf(out, ", max ");
+		    print_sensor_value(out, s, s->max, temp_units);
+		}
+		if (show_limits && (s->known & SENSOR_CRIT)) {
+		    fprintf(out, ", critical ");
+		    print_sensor_value(out, s, s->crit, temp_units);
+		}
+		fprintf(out, "\n");
+	    }
+	}
+	chip_num++;
+    }
+}
+
+/* the zones of a package are called the same in every package, the
+ * directory tells them apart */
+void print_powercap_information(FILE *out, const struct acpi_snapshot *snap, int show_empty_slots, int show_energy)
+{
+    const struct device_info *dev;
+    const struct powercap_info *p;
+    int i, zone_num = 1;
+
+    for (i = 0; i < acpi_count(snap, POWERCAP); i++) {
+	dev = acpi_device(snap, POWERCAP, i);
+	p = &dev->info.powercap;
+	if (!dev->present) {
+	    if (show_empty_slots)
+		fprintf(out, "%s %d: slot empty\n", POWERCAP_DESC, zone_num - 1);
+	} else {
+	    fprintf(out, "%s %d: %s (%s), ", POWERCAP_DESC, zone_num - 1, p->name ? p->name : "unknown", dev->name);
+	    if (p->power >= 0)
+		fprintf(out, "%.1f W", p->power);
+	    else
+		fprintf(out, "power unknown");
+	    if (show_energy) {
+		fprintf(out, ", energy %.1f J", p->energy);
+		if (p->max_range > 0)
+		    fprintf(out, " of %.1f J", p->max_range);
+	    }
+	    fprintf(out, "\n");
+	}
+	zone_num++;
+    }
+}
+
+static int cpu_number(const struct device_info *dev)
+{
+    return atoi(dev->name + 3);
+}
+
+static int compare_cpus(const void *a, const void *b)
+{
+    const struct device_info *x = *(const struct device_info **) a, *y = *(const struct device_info **) b;
+
+    if (x->info.cpu.package != y->info.cpu.package)
+	return x->info.cpu.package - y->info.cpu.package;
+    if (x->info.cpu.core != y->info.cpu.core)
+	return x->info.cpu.core - y->info.cpu.core;
+    return cpu_number(x) - cpu_number(y);
+}
+
+/* every cpu of a package resp. thread of a core counts the same events,
+ * so the group has the highest of their counters */
+static void merge_throttle(struct throttle *sum, const struct throttle *t)
+{
+    if (t->count > sum->count)
+	sum->count = t->count;
+    if (t->total_ms > sum->total_ms)
+	sum->total_ms = t->total_ms;
+    if (t->max_ms > sum->max_ms)
+	sum->max_ms = t->max_ms;
+    if (t->count_delta > sum->count_delta)
+	sum->count_delta = t->count_delta;
+    if (t->total_delta_ms > sum->total_delta_ms)
+	sum->total_delta_ms = t->total_delta_ms;
+}
+
+static void print_throttle(FILE *out, const struct throttle *t, double interval, int show_max)
+{
+    if (t->count >= 0)
+	fprintf(out, "throttled %lld times", t->count);
+    else
+	fprintf(out, "throttle count unknown");
+    if (t->total_ms >= 0)
+	fprintf(out, t->count >= 0 ? " for %lld ms" : ", throttled for %lld ms", t->total_ms);
+    if (show_max && t->max_ms >= 0)
+	fprintf(out, ", at most %lld ms at once", t->max_ms);
+    if (t->count_delta >= 0) {
+	fprintf(out, ", %lld times", t->count_delta);
+	if (t->total_delta_ms >= 0)
+	    fprintf(out, " for %lld ms", t->total_delta_ms);
+	fprintf(out, " in the last %.0f ms", interval * 1000);
+    }
+    fprintf(out, "\n");
+}
+
+/* the cpus grouped by package and core, cores that were never throttled
+ * only with show_all_cores */
+void print_throttle_information(FILE *out, const struct acpi_snapshot *snap, int show_all_cores, int show_max)
+{
+    static const struct throttle none = { -1, -1, -1, -1, -1 };
+    const struct device_info **cpus;
+    const struct cpu_info *c;
+    struct throttle sum;
+    double interval;
+    char list[64];
+    int i, j, k, l, n, len;
+
+    if (acpi_count(snap, CPU) <= 0)
+	return;
+    cpus = malloc(acpi_count(snap, CPU) * sizeof(struct device_info *));
+    if (!cpus) {
+	fprintf(stderr, "Out of memory in print_throttle_information()\n");
+	return;
+    }
+    for (i = 0, n = 0; i < acpi_count(snap, CPU); i++)
+	if (acpi_device(snap, CPU, i)->present)
+	    cpus[n++] = acpi_device(snap, CPU, i);
+    qsort(cpus, n, sizeof(struct device_info *), compare_cpus);
+
+    for (i = 0; i < n; i = j) {
+	sum = none;
+	interval = 0;
+	for (j = i; j < n && cpus[j]->info.cpu.package == cpus[i]->info.cpu.package; j++) {
+	    merge_throttle(&sum, &cpus[j]->info.cpu.scope[THROTTLE_PACKAGE]);
+	    if (cpus[j]->info.cpu.interval > interval)
+		interval = cpus[j]->info.cpu.interval;
+	}
+	fprintf(out, "%s %d: ", PACKAGE_DESC, cpus[i]->info.cpu.package);
+	print_throttle(out, &sum, interval, show_max);
+
+	for (k = i; k < j; k = l) {
+	    c = &cpus[k]->info.cpu;
+	    sum = none;
+	    len = 0;
+	    for (l = k; l < j && cpus[l]->info.cpu.core == c->core; l++) {
+		merge_throttle(&sum, &cpus[l]->info.cpu.scope[THROTTLE_CORE]);
+		if (len < sizeof(list))
+		    len += snprintf(list + len, sizeof(list) - len, l > k ? ",%d" : "%d", cpu_number(cpus[l]));
+	    }
+	    if (sum.count <= 0 && !show_all_cores)
+		continue;
+	    fprintf(out, "%s %d core %d (cpu %s): ", PACKAGE_DESC, c->package, c->core, list);
+	    print_throttle(out, &sum, interval, show_max);
+	}
+    }
+    free(cpus);
+}
@@ -0,0 +1,70 @@
+/* publishes snapshots in a shared memory file for readers that cannot
+ * afford a socket round-trip
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "acpi.h"
+
+#define PUBLISHED_CLASSES	(ACPI_CLASS(BATTERY) | ACPI_CLASS(AC_ADAPTER) | ACPI_CLASS(THERMAL_ZONE) | \
+				 ACPI_CLASS(COOLING_DEV))
+
+int publish_serve(struct acpi_context *ctx, const char *file, double interval)
+{
+    struct acpi_publisher *pub;
+    struct acpi_snapshot *snap;
+    void *buf = NULL;
+    size_t size = 0;
+    int err, rval = 0;
+
+    err = acpi_publisher_open(file, &pub);
+    if (err == ACPI_ENOACPI) {
+	fprintf(stderr, "Cannot publish to %s: %s\n", file, strerror(errno));
+	return 1;
+    } else if (err != ACPI_OK) {
+	fprintf(stderr, "%s.\n", acpi_strerror(err));
+	return 1;
+    }
+
+    /* the sleep has to end so that the file is removed */
+    catch_stop();
+    while (!stop_requested()) {
+	err = take_snapshot(ctx, PUBLISHED_CLASSES, &buf, &size, &snap);
+	if (err != ACPI_OK) {
+	    fprintf(stderr, "%s.\n", acpi_strerror(err));
+	    rval = 1;
+	    break;
+	}
+	if (acpi_publish(pub, snap) != ACPI_OK) {
+	    fprintf(stderr, "Cannot publish to %s: %s\n", file, strerror(errno));
+	    rval = 1;
+	    break;
+	}
+	sleep_interval(interval);
+    }
+
+    acpi_publisher_close(pub);
+    free(buf);
+    return rval;
+}
@@ -0,0 +1,155 @@
+/* output collected in one buffer and written at once
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#define _GNU_SOURCE	/* for fopencookie() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include "report.h"
+
+int report_init(struct report *r, size_t size)/*{{{*/
+{
+    r->buf = malloc(size);
+    r->size = r->buf ? size : 0;
+    r->len = 0;
+    r->failed = 0;
+    r->stream = NULL;
+    return r->buf ? 0 : -1;
+}
+
+void report_reset(struct report *r)/*{{{*/
+{
+    r->len = 0;
+    r->failed = 0;
+    if (r->stream)
+	clearerr(r->stream);
+}
+
+int report_reserve(struct report *r, size_t n)/*{{{*/
+{
+    size_t size = r->size ? r->size : 1024;
+    char *p;
+
+    if (r->len + n < r->size)
+	return 0;
+    while (r->len + n >= size)
+	size *= 2;
+    p = realloc(r->buf, size);
+    if (!p) {
+	r->failed = 1;
+	return -1;
+    }
+    r->buf = p;
+    r->size = size;
+    return 0;
+}
+
+void report_append(struct report *r, const char *s, size_t len)/*{{{*/
+{
+    if (report_reserve(r, len) < 0)
+	return;
+    memcpy(r->buf + r->len, s, len);
+    r->len += len;
+}
+
+void report_puts(struct report *r, const char *s)/*{{{*/
+{
+    report_append(r, s, strlen(s));
+}
+
+void report_printf(struct report *r, const char *fmt, ...)/*{{{*/
+{
+    va_list ap;
+    int n;
+
+    va_start(ap, fmt);
+    n = vsnprintf(r->buf + r->len, r->size - r->len, fmt, ap);
+    va_end(ap);
+    if (n < 0) {
+	r->failed = 1;
+	return;
+    }
+    if (r->len + n < r->size) {
+	r->len += n;
+	return;
+    }
+    /* did not fit, grow and format again */
+    if (report_reserve(r, n) < 0)
+	return;
+    va_start(ap, fmt);
+    vsnprintf(r->buf + r->len, r->size - r->len, fmt, ap);
+    va_end(ap);
+    r->len += n;
+}
+
+static ssize_t stream_write(void *cookie, const char *s, size_t len)
+{
+    struct report *r = cookie;
+
+    report_append(r, s, len);
+    return r->failed ? -1 : (ssize_t) len;
+}
+
+FILE *report_stream(struct report *r)/*{{{*/
+{
+    cookie_io_functions_t io = { NULL, stream_write, NULL, NULL };
+
+    if (r->stream)
+	return r->stream;
+    r->stream = fopencookie(r, "w", io);
+    if (!r->stream) {
+	r->failed = 1;
+	return NULL;
+    }
+    setvbuf(r->stream, NULL, _IONBF, 0);
+    return r->stream;
+}
+
+int report_write(struct report *r, int fd)/*{{{*/
+{
+    size_t done = 0;
+    ssize_t n;
+
+    while (done < r->len) {
+	n = write(fd, r->buf + done, r->len - done);
+	if (n < 0 && errno == EINTR)
+	    continue;
+	if (n <= 0)
+	    break;
+	done += n;
+    }
+    n = (done == r->len && !r->failed) ? 0 : -1;
+    report_reset(r);
+    return n;
+}
+
+void report_free(struct report *r)/*{{{*/
+{
+    if (r->stream)
+	fclose(r->stream);
+    r->stream = NULL;
+    free(r->buf);
+    r->buf = NULL;
+    r->size = r->len = 0;
+}
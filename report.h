@@ -0,0 +1,103 @@
+/* output collected in one buffer and written at once
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#ifndef _REPORT_H
+#define _REPORT_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+struct report {
+    char *buf;
+    size_t size;
+    size_t len;
+    int failed;		/* ran out of memory, the contents are incomplete */
+    FILE *stream;	/* of report_stream(), NULL until it is asked for */
+};
+
+/* set up a report with a preallocated buffer
+ *
+ * Pre: r != NULL
+ * Post: returns 0, or -1 if out of memory
+ */
+int report_init(struct report *r, size_t size);
+
+/* drop the contents but keep the buffer for the next round
+ *
+ * Pre: r was set up by report_init()
+ * Post: the report is empty
+ */
+void report_reset(struct report *r);
+
+/* make room for at least n more bytes and a terminating zero, for callers
+ * that fill r->buf + r->len themselves
+ *
+ * Pre: r was set up by report_init()
+ * Post: returns 0, or -1 and sets r->failed if out of memory
+ */
+int report_reserve(struct report *r, size_t n);
+
+/* append len bytes, the buffer grows if needed
+ *
+ * Pre: r was set up by report_init()
+ * Post: the bytes are appended or r->failed is set
+ */
+void report_append(struct report *r, const char *s, size_t len);
+
+/* append a terminated string
+ *
+ * Pre: r was set up by report_init(), s != NULL
+ * Post: s is appended or r->failed is set
+ */
+void report_puts(struct report *r, const char *s);
+
+/* append formatted output
+ *
+ * Pre: r was set up by report_init()
+ * Post: the output is appended or r->failed is set
+ */
+void report_printf(struct report *r, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/* a stream whose output is appended to the report as it is written, for
+ * the print_*_information() functions; it is unbuffered, so it can be
+ * mixed with the functions above, and stays open with the report
+ *
+ * Pre: r was set up by report_init()
+ * Post: returns the stream, or NULL and sets r->failed if out of memory
+ */
+FILE *report_stream(struct report *r);
+
+/* write the contents to fd with a single write() unless the kernel takes
+ * less, and empty the report
+ *
+ * Pre: r was set up by report_init()
+ * Post: returns 0, or -1 if writing failed or the report was incomplete
+ */
+int report_write(struct report *r, int fd);
+
+/* release the buffer
+ *
+ * Pre: r was set up by report_init()
+ * Post: r must be set up again before it is used
+ */
+void report_free(struct report *r);
+
+#endif
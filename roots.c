@@ -0,0 +1,240 @@
+/* scans many captured trees at once with a fixed pool of threads
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "acpi.h"
+#include "report.h"
+
+struct root_result {
+    struct report out;
+    struct report err;
+    struct acpi_snapshot *snap;	/* with prometheus output, rendered once all roots are read */
+    void *buf;			/* what snap lives in */
+    int failed;			/* the root could not be read at all */
+    int done;
+};
+
+struct pool {
+    char **roots;
+    int num_roots;
+    int next;			/* the next root a worker picks up */
+    int flags;
+    const struct request *q;
+    struct root_result *results;
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+};
+
+/* read and render one root, the output and the messages are kept until
+ * it is this root's turn to be written; a prometheus exposition has every
+ * metric once for all roots, so then the snapshot is kept instead */
+static void scan_root(struct pool *p, int i, void **buf, size_t *size)
+{
+    struct root_result *res = &p->results[i];
+    struct acpi_context *ctx;
+    struct acpi_snapshot *snap;
+    struct request q = *p->q;
+    int err, type;
+
+    q.path = p->roots[i];
+    q.tag_root = TRUE;
+    if (report_init(&res->out, BUF_SIZE * 4) < 0 || report_init(&res->err, BUF_SIZE) < 0) {
+	res->out.failed = TRUE;
+	return;
+    }
+
+    err = acpi_open(q.path, p->flags, &ctx);
+    if (err == ACPI_ENOACPI) {
+	report_printf(&res->err, "%s: No ACPI support in kernel, or incorrect acpi_path.\n", q.path);
+	res->failed = TRUE;
+	return;
+    } else if (err != ACPI_OK) {
+	report_printf(&res->err, "%s: %s.\n", q.path, acpi_strerror(err));
+	res->failed = TRUE;
+	return;
+    }
+
+    err = take_snapshot(ctx, q.classes, buf, size, &snap);
+    if (err != ACPI_OK) {
+	report_printf(&res->err, "%s: %s.\n", q.path, acpi_strerror(err));
+	res->failed = TRUE;
+	acpi_close(ctx);
+	return;
+    }
+
+    for (type = 0; type < ACPI_CLASSES; type++)
+	if ((q.classes & ACPI_CLASS(type)) && acpi_count(snap, type) == ACPI_ENODEV)
+	    report_printf(&res->err, "%s: No support for device type: %s\n", q.path,
+			  get_class_name(type, q.proc_interface));
+    if (q.format == FORMAT_PROM) {
+	/* the next root gets a buffer of its own */
+	res->snap = snap;
+	res->buf = *buf;
+	*buf = NULL;
+	*size = 0;
+    } else {
+	render_snapshot(&res->out, snap, &q);
+    }
+    acpi_close(ctx);
+}
+
+static void *worker(void *arg)
+{
+    struct pool *p = arg;
+    void *buf = NULL;
+    size_t size = 0;
+    int i;
+
+    for (;;) {
+	pthread_mutex_lock(&p->lock);
+	i = p->next++;
+	pthread_mutex_unlock(&p->lock);
+	if (i >= p->num_roots)
+	    break;
+
+	scan_root(p, i, &buf, &size);
+
+	pthread_mutex_lock(&p->lock);
+	p->results[i].done = TRUE;
+	pthread_cond_broadcast(&p->done);
+	pthread_mutex_unlock(&p->lock);
+    }
+    free(buf);
+    return NULL;
+}
+
+/* the exposition of the roots that could be read, their buffers are freed */
+static int write_prom(struct root_result *results, char **roots, int num_roots, const struct request *q)
+{
+    const struct acpi_snapshot **snaps;
+    const char **paths;
+    struct report out;
+    int i, n = 0, rval = 0;
+
+    snaps = malloc(num_roots * sizeof(struct acpi_snapshot *));
+    paths = malloc(num_roots * sizeof(char *));
+    if (!snaps || !paths || report_init(&out, BUF_SIZE * 4) < 0) {
+	fprintf(stderr, "Out of memory in write_prom()\n");
+	rval = -1;
+    } else {
+	for (i = 0; i < num_roots; i++)
+	    if (results[i].snap) {
+		snaps[n] = results[i].snap;
+		paths[n++] = roots[i];
+	    }
+	format_prom_roots(&out, snaps, paths, n, q);
+	if (out.failed) {
+	    fprintf(stderr, "Out of memory in write_prom()\n");
+	    rval = -1;
+	} else if (report_write(&out, STDOUT_FILENO) < 0) {
+	    rval = -1;
+	}
+	report_free(&out);
+    }
+    for (i = 0; i < num_roots; i++)
+	free(results[i].buf);
+    free(snaps);
+    free(paths);
+    return rval;
+}
+
+int scan_roots(char **roots, int num_roots, int jobs, int flags, const struct request *q)
+{
+    struct pool p;
+    pthread_t *threads;
+    struct root_result *res;
+    struct report header;
+    struct request tagged;
+    int i, started, rval = 0;
+
+    if (jobs <= 0)
+	jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    if (jobs > num_roots)
+	jobs = num_roots;
+    if (jobs <= 0)
+	jobs = 1;
+
+    memset(&p, 0, sizeof(p));
+    p.roots = roots;
+    p.num_roots = num_roots;
+    p.flags = flags;
+    p.q = q;
+    p.results = calloc(num_roots, sizeof(struct root_result));
+    threads = calloc(jobs, sizeof(pthread_t));
+    if (!p.results || !threads) {
+	fprintf(stderr, "Out of memory in scan_roots()\n");
+	free(p.results);
+	free(threads);
+	return 1;
+    }
+    pthread_mutex_init(&p.lock, NULL);
+    pthread_cond_init(&p.done, NULL);
+
+    for (started = 0; started < jobs; started++)
+	if (pthread_create(&threads[started], NULL, worker, &p) != 0)
+	    break;
+    if (!started) {
+	/* no threads to be had, do the work ourselves */
+	worker(&p);
+    }
+
+    /* write the results in the order the roots were given */
+    tagged = *q;
+    tagged.tag_root = TRUE;
+    if (report_init(&header, BUF_SIZE) == 0) {
+	format_header(&header, &tagged);
+	report_write(&header, STDOUT_FILENO);
+	report_free(&header);
+    }
+    for (i = 0; i < num_roots; i++) {
+	res = &p.results[i];
+	pthread_mutex_lock(&p.lock);
+	while (!res->done)
+	    pthread_cond_wait(&p.done, &p.lock);
+	pthread_mutex_unlock(&p.lock);
+
+	if (res->failed)
+	    rval = 1;
+	if (res->out.failed) {
+	    fprintf(stderr, "%s: Out of memory.\n", roots[i]);
+	    rval = 1;
+	}
+	if (report_write(&res->err, STDERR_FILENO) < 0 || report_write(&res->out, STDOUT_FILENO) < 0)
+	    rval = 1;
+	report_free(&res->out);
+	report_free(&res->err);
+    }
+    if (q->format == FORMAT_PROM && write_prom(p.results, roots, num_roots, &tagged) < 0)
+	rval = 1;
+
+    for (i = 0; i < started; i++)
+	pthread_join(threads[i], NULL);
+    pthread_cond_destroy(&p.done);
+    pthread_mutex_destroy(&p.lock);
+    free(threads);
+    free(p.results);
+    return rval;
+}
@@ -0,0 +1,766 @@
+/* checks rules about the devices on every sample and runs hooks when they
+ * start or stop to hold
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "acpi.h"
+
+/* a rules file has one rule per line, see acpi(1):
+ *
+ *   [<name>:] <condition> [and <condition>]... [for <time>] [hysteresis <n>]
+ *             [write <fd>] [exec <command>]
+ *
+ *   <condition>  [<class> [<index>|*]] <value> [<op> <number> [<unit>]]
+ *
+ * a condition without a class looks at the same device as the one before
+ * it; the rules are compiled into one table of conditions that each
+ * sample is checked against */
+
+#define TOKEN_END	0
+#define TOKEN_WORD	1	/* a name, a unit or % */
+#define TOKEN_NUMBER	2
+#define TOKEN_OP	3
+#define TOKEN_ANY	4	/* * */
+#define TOKEN_COLON	5
+#define TOKEN_BAD	6
+
+#define OP_LT	0
+#define OP_LE	1
+#define OP_GT	2
+#define OP_GE	3
+#define OP_EQ	4
+#define OP_NE	5
+#define OP_FLAG	6	/* the value itself is true or false */
+
+#define VALUE_PERCENTAGE	0
+#define VALUE_RATE		1
+#define VALUE_SECONDS		2
+#define VALUE_HEALTH		3
+#define VALUE_CHARGING		4
+#define VALUE_DISCHARGING	5
+#define VALUE_ONLINE		6
+#define VALUE_OFFLINE		7
+#define VALUE_TEMPERATURE	8
+#define VALUE_STATE		9
+#define VALUE_MAX_STATE		10
+#define VALUE_AT_MAX		11
+
+struct token {
+    int kind;
+    const char *s;
+    int len;
+    double number;
+    int op;
+    const char *end;		/* where the next token starts */
+};
+
+/* the second word may follow the first */
+static const struct class_name {
+    const char *word;
+    const char *second;
+    int type;
+} class_names[] = {
+    {"battery", NULL, BATTERY},
+    {"ac", "adapter", AC_ADAPTER},
+    {"ac_adapter", NULL, AC_ADAPTER},
+    {"adapter", NULL, AC_ADAPTER},
+    {"thermal", "zone", THERMAL_ZONE},
+    {"thermal_zone", NULL, THERMAL_ZONE},
+    {"cooling", "device", COOLING_DEV},
+    {"cooling_device", NULL, COOLING_DEV},
+    {NULL, NULL, 0}
+};
+
+/* how the classes are called in what is printed, like in the text output */
+static const char *class_shown[] = {"battery", "adapter", "thermal", "cooling"};
+
+/* the second word has to follow the first; flags are values that are
+ * either true or false and take no comparison */
+static const struct value_name {
+    int type;
+    const char *word;
+    const char *second;
+    int value;
+    const char *unit;		/* the unit the number may have, NULL if none */
+    int flag;
+} value_names[] = {
+    {BATTERY, "percentage", NULL, VALUE_PERCENTAGE, "%", FALSE},
+    {BATTERY, "rate", NULL, VALUE_RATE, NULL, FALSE},
+    {BATTERY, "seconds", NULL, VALUE_SECONDS, "s", FALSE},
+    {BATTERY, "health", NULL, VALUE_HEALTH, "%", FALSE},
+    {BATTERY, "charging", NULL, VALUE_CHARGING, NULL, TRUE},
+    {BATTERY, "discharging", NULL, VALUE_DISCHARGING, NULL, TRUE},
+    {AC_ADAPTER, "online", NULL, VALUE_ONLINE, NULL, TRUE},
+    {AC_ADAPTER, "offline", NULL, VALUE_OFFLINE, NULL, TRUE},
+    {THERMAL_ZONE, "temperature", NULL, VALUE_TEMPERATURE, "C", FALSE},
+    {COOLING_DEV, "state", NULL, VALUE_STATE, NULL, FALSE},
+    {COOLING_DEV, "max_state", NULL, VALUE_MAX_STATE, NULL, FALSE},
+    {COOLING_DEV, "at", "max_state", VALUE_AT_MAX, NULL, TRUE},
+    {COOLING_DEV, "at", "max", VALUE_AT_MAX, NULL, TRUE},
+    {COOLING_DEV, "at_max", NULL, VALUE_AT_MAX, NULL, TRUE},
+    {0, NULL, NULL, 0, NULL, FALSE}
+};
+
+/* what a class is compared by if a condition names no value */
+static const char *default_value[] = {"percentage", NULL, "temperature", "state"};
+
+struct condition {
+    int type;
+    int index;			/* -1 for any device of the class */
+    int subject;		/* the condition names the device, the following ones
+				   without a class look at the same */
+    const struct value_name *value;
+    int op;
+    double threshold;
+};
+
+struct rule {
+    char *name;
+    int first;			/* its conditions in the table */
+    int num_conds;
+    double hold;		/* seconds the conditions have to hold before it fires */
+    double hysteresis;		/* how far past the thresholds the values have to go
+				   back before a fired rule clears */
+    int fd;			/* -1 if nothing is written */
+    char *command;		/* NULL if nothing is run */
+    int fired;
+    double since;		/* since when the conditions hold, -1 if they do not */
+};
+
+struct rules {
+    struct rule *rule;
+    int num_rules;
+    struct condition *cond;
+    int num_conds;
+    int classes;		/* the ACPI_CLASS() mask the conditions need */
+};
+
+struct parser {
+    const char *file;
+    int line;
+    const char *p;
+};
+
+static void lex(const char *p, struct token *t)
+{
+    char *end;
+
+    while (isspace((unsigned char) *p))
+	p++;
+    t->s = p;
+    t->end = p + 1;
+    if (!*p) {
+	t->kind = TOKEN_END;
+	t->end = p;
+    } else if (isdigit((unsigned char) *p) ||
+	       ((*p == '-' || *p == '.') && (isdigit((unsigned char) p[1]) || p[1] == '.'))) {
+	t->number = strtod(p, &end);
+	t->kind = end > p ? TOKEN_NUMBER : TOKEN_BAD;
+	if (end > p)
+	    t->end = end;
+    } else if (isalpha((unsigned char) *p) || *p == '_') {
+	for (end = (char *) p; isalnum((unsigned char) *end) || *end == '_'; end++)
+	    ;
+	t->kind = TOKEN_WORD;
+	t->end = end;
+    } else if (*p == '<' || *p == '>') {
+	t->kind = TOKEN_OP;
+	if (p[1] == '=') {
+	    t->op = *p == '<' ? OP_LE : OP_GE;
+	    t->end = p + 2;
+	} else
+	    t->op = *p == '<' ? OP_LT : OP_GT;
+    } else if (*p == '=' || (*p == '!' && p[1] == '=')) {
+	t->kind = TOKEN_OP;
+	t->op = *p == '=' ? OP_EQ : OP_NE;
+	if (p[1] == '=')
+	    t->end = p + 2;
+    } else if (*p == '%')
+	t->kind = TOKEN_WORD;
+    else if (*p == '*')
+	t->kind = TOKEN_ANY;
+    else if (*p == ':')
+	t->kind = TOKEN_COLON;
+    else
+	t->kind = TOKEN_BAD;
+    t->len = t->end - t->s;
+}
+
+static int is_word(const struct token *t, const char *word)
+{
+    return t->kind == TOKEN_WORD && t->len == (int) strlen(word) && !strncasecmp(t->s, word, t->len);
+}
+
+static int syntax(const struct parser *ps, const struct token *t, const char *what)
+{
+    if (t->kind == TOKEN_END)
+	fprintf(stderr, "%s:%d: %s, found end of line\n", ps->file, ps->line, what);
+    else
+	fprintf(stderr, "%s:%d: %s, found '%.*s'\n", ps->file, ps->line, what, t->len, t->s);
+    return -1;
+}
+
+/* what a unit after a number multiplies it with, 0 if the token is no
+ * unit of the kind given */
+static double unit_scale(const struct token *t, const char *unit)
+{
+    if (!unit)
+	return 0;
+    if (!strcmp(unit, "s")) {
+	if (is_word(t, "s") || is_word(t, "sec"))
+	    return 1;
+	if (is_word(t, "m") || is_word(t, "min"))
+	    return 60;
+	if (is_word(t, "h"))
+	    return 3600;
+	return 0;
+    }
+    return is_word(t, unit) ? 1 : 0;
+}
+
+static int parse_number(struct parser *ps, const char *unit, double *v)
+{
+    struct token t;
+    double scale;
+
+    lex(ps->p, &t);
+    if (t.kind != TOKEN_NUMBER)
+	return syntax(ps, &t, "number expected");
+    *v = t.number;
+    ps->p = t.end;
+    lex(ps->p, &t);
+    scale = unit_scale(&t, unit);
+    if (scale) {
+	*v *= scale;
+	ps->p = t.end;
+    }
+    return 0;
+}
+
+static int parse_class(struct parser *ps, int *type)
+{
+    const struct class_name *c;
+    struct token t, n;
+
+    lex(ps->p, &t);
+    for (c = class_names; c->word; c++) {
+	if (!is_word(&t, c->word))
+	    continue;
+	ps->p = t.end;
+	if (c->second) {
+	    lex(ps->p, &n);
+	    if (is_word(&n, c->second))
+		ps->p = n.end;
+	}
+	*type = c->type;
+	return TRUE;
+    }
+    return FALSE;
+}
+
+static const struct value_name *find_value(int type, const char *word)
+{
+    const struct value_name *v;
+
+    for (v = value_names; v->word; v++)
+	if (v->type == type && !strcmp(v->word, word))
+	    return v;
+    return NULL;
+}
+
+static const struct value_name *parse_value(struct parser *ps, int type)
+{
+    const struct value_name *v;
+    struct token t, n;
+
+    lex(ps->p, &t);
+    for (v = value_names; v->word; v++) {
+	if (v->type != type || !is_word(&t, v->word))
+	    continue;
+	if (v->second) {
+	    lex(t.end, &n);
+	    if (!is_word(&n, v->second))
+		continue;
+	    ps->p = n.end;
+	} else
+	    ps->p = t.end;
+	return v;
+    }
+    return NULL;
+}
+
+static int add_condition(struct rules *rs, const struct condition *c)
+{
+    struct condition *p;
+
+    p = realloc(rs->cond, (rs->num_conds + 1) * sizeof(*p));
+    if (!p) {
+	fprintf(stderr, "Out of memory in add_condition()\n");
+	return -1;
+    }
+    rs->cond = p;
+    rs->cond[rs->num_conds++] = *c;
+    rs->classes |= ACPI_CLASS(c->type);
+    return 0;
+}
+
+static int parse_condition(struct parser *ps, struct rules *rs, struct rule *r, const char **unit)
+{
+    struct condition c;
+    struct token t;
+
+    if (parse_class(ps, &c.type)) {
+	c.subject = TRUE;
+	c.index = -1;
+	lex(ps->p, &t);
+	if (t.kind == TOKEN_NUMBER) {
+	    if (t.number < 0 || t.number != (int) t.number)
+		return syntax(ps, &t, "device index expected");
+	    c.index = (int) t.number;
+	    ps->p = t.end;
+	} else if (t.kind == TOKEN_ANY)
+	    ps->p = t.end;
+    } else if (r->num_conds > 0) {
+	c.type = rs->cond[rs->num_conds - 1].type;
+	c.index = rs->cond[rs->num_conds - 1].index;
+	c.subject = FALSE;
+    } else {
+	lex(ps->p, &t);
+	return syntax(ps, &t, "battery, adapter, thermal or cooling expected");
+    }
+
+    c.value = parse_value(ps, c.type);
+    if (!c.value) {
+	lex(ps->p, &t);
+	if (t.kind != TOKEN_OP || !c.subject || !default_value[c.type])
+	    return syntax(ps, &t, c.subject ? "value of the device expected" :
+			  "value of the device or and expected");
+	c.value = find_value(c.type, default_value[c.type]);
+    }
+
+    if (c.value->flag) {
+	c.op = OP_FLAG;
+	c.threshold = 0;
+    } else {
+	lex(ps->p, &t);
+	if (t.kind != TOKEN_OP)
+	    return syntax(ps, &t, "comparison expected");
+	c.op = t.op;
+	ps->p = t.end;
+	if (parse_number(ps, c.value->unit, &c.threshold) < 0)
+	    return -1;
+	*unit = c.value->unit;
+    }
+    return add_condition(rs, &c);
+}
+
+static int parse_rule(struct parser *ps, struct rules *rs)
+{
+    struct rule *r;
+    struct token t, n;
+    const char *unit = NULL;
+    char name[16];
+    double fd;
+    int i;
+
+    r = realloc(rs->rule, (rs->num_rules + 1) * sizeof(*r));
+    if (!r) {
+	fprintf(stderr, "Out of memory in parse_rule()\n");
+	return -1;
+    }
+    rs->rule = r;
+    r = &rs->rule[rs->num_rules++];
+    memset(r, 0, sizeof(*r));
+    r->first = rs->num_conds;
+    r->fd = -1;
+    r->since = -1;
+
+    lex(ps->p, &t);
+    lex(t.end, &n);
+    if (t.kind == TOKEN_WORD && n.kind == TOKEN_COLON) {
+	r->name = strndup(t.s, t.len);
+	ps->p = n.end;
+    } else {
+	snprintf(name, sizeof(name), "rule%d", rs->num_rules);
+	r->name = strdup(name);
+    }
+    if (!r->name) {
+	fprintf(stderr, "Out of memory in parse_rule()\n");
+	return -1;
+    }
+    for (i = 0; i < rs->num_rules - 1; i++)
+	if (!strcmp(rs->rule[i].name, r->name)) {
+	    fprintf(stderr, "%s:%d: there is another rule called %s\n", ps->file, ps->line, r->name);
+	    return -1;
+	}
+
+    for (;;) {
+	if (parse_condition(ps, rs, r, &unit) < 0)
+	    return -1;
+	r->num_conds++;
+	lex(ps->p, &t);
+	if (!is_word(&t, "and"))
+	    break;
+	ps->p = t.end;
+    }
+
+    for (;;) {
+	lex(ps->p, &t);
+	if (t.kind == TOKEN_END)
+	    break;
+	ps->p = t.end;
+	if (is_word(&t, "for")) {
+	    if (parse_number(ps, "s", &r->hold) < 0)
+		return -1;
+	} else if (is_word(&t, "hysteresis")) {
+	    if (!unit) {
+		fprintf(stderr, "%s:%d: only comparisons have a hysteresis\n", ps->file, ps->line);
+		return -1;
+	    }
+	    if (parse_number(ps, unit, &r->hysteresis) < 0)
+		return -1;
+	} else if (is_word(&t, "write")) {
+	    lex(ps->p, &n);
+	    if (parse_number(ps, NULL, &fd) < 0)
+		return -1;
+	    if (fd < 0 || fd != (int) fd || fcntl((int) fd, F_GETFD) < 0)
+		return syntax(ps, &n, "open descriptor expected");
+	    r->fd = (int) fd;
+	} else if (is_word(&t, "exec")) {
+	    while (isspace((unsigned char) *ps->p))
+		ps->p++;
+	    if (!*ps->p) {
+		lex(ps->p, &n);
+		return syntax(ps, &n, "command expected");
+	    }
+	    r->command = strdup(ps->p);
+	    if (!r->command) {
+		fprintf(stderr, "Out of memory in parse_rule()\n");
+		return -1;
+	    }
+	    break;
+	} else
+	    return syntax(ps, &t, "and, for, hysteresis, write or exec expected");
+    }
+    if (r->hold < 0 || r->hysteresis < 0) {
+	fprintf(stderr, "%s:%d: negative time or hysteresis\n", ps->file, ps->line);
+	return -1;
+    }
+    return 0;
+}
+
+static void rules_free(struct rules *rs)
+{
+    int i;
+
+    for (i = 0; i < rs->num_rules; i++) {
+	free(rs->rule[i].name);
+	free(rs->rule[i].command);
+    }
+    free(rs->rule);
+    free(rs->cond);
+}
+
+static int rules_load(struct rules *rs, const char *file)
+{
+    struct parser ps;
+    FILE *f;
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    int rval = 0;
+
+    f = fopen(file, "r");
+    if (!f) {
+	fprintf(stderr, "Cannot open %s: %s\n", file, strerror(errno));
+	return -1;
+    }
+    ps.file = file;
+    ps.line = 0;
+    while ((len = getline(&line, &size, f)) >= 0) {
+	ps.line++;
+	if (len > 0 && line[len - 1] == '\n')
+	    line[len - 1] = '\0';
+	for (ps.p = line; isspace((unsigned char) *ps.p); ps.p++)
+	    ;
+	if (!*ps.p || *ps.p == '#')
+	    continue;
+	if (parse_rule(&ps, rs) < 0) {
+	    rval = -1;
+	    break;
+	}
+    }
+    if (!rval && ferror(f)) {
+	fprintf(stderr, "Cannot read %s: %s\n", file, strerror(errno));
+	rval = -1;
+    }
+    if (!rval && !rs->num_rules) {
+	fprintf(stderr, "%s: no rules\n", file);
+	rval = -1;
+    }
+    free(line);
+    fclose(f);
+    return rval;
+}
+
+/* a value of a device, FALSE if it is not known */
+static int get_value(const struct device_info *dev, int value, double *v)
+{
+    const struct battery_info *b = &dev->info.battery;
+    const struct cooling_info *c = &dev->info.cooling;
+    struct battery_status s;
+
+    switch (value) {
+    case VALUE_PERCENTAGE:
+    case VALUE_SECONDS:
+    case VALUE_HEALTH:
+	if (!b->state)
+	    return FALSE;
+	get_battery_status(b, &s);
+	*v = value == VALUE_PERCENTAGE ? s.percentage : value == VALUE_SECONDS ? s.seconds : s.health;
+	return *v >= 0;
+    case VALUE_RATE:
+	*v = b->present_rate;
+	return b->state && b->present_rate >= 0;
+    case VALUE_CHARGING:
+    case VALUE_DISCHARGING:
+	*v = b->charging == (value == VALUE_CHARGING ? BATTERY_CHARGING : BATTERY_DISCHARGING);
+	return b->state != NULL;
+    case VALUE_ONLINE:
+    case VALUE_OFFLINE:
+	if (!dev->info.ac_adapter.state)
+	    return FALSE;
+	*v = !strcmp(dev->info.ac_adapter.state, "on-line") == (value == VALUE_ONLINE);
+	return TRUE;
+    case VALUE_TEMPERATURE:
+	*v = dev->info.thermal.temperature;
+	return dev->info.thermal.state != NULL;
+    case VALUE_STATE:
+	*v = c->cur_state;
+	return c->cur_state >= 0;
+    case VALUE_MAX_STATE:
+	*v = c->max_state;
+	return c->max_state >= 0;
+    case VALUE_AT_MAX:
+	*v = c->cur_state >= c->max_state;
+	return c->cur_state >= 0 && c->max_state > 0;
+    }
+    return FALSE;
+}
+
+/* a fired rule only clears once the values went back past the thresholds
+ * by the hysteresis */
+static int compare(const struct condition *c, double v, double hysteresis)
+{
+    switch (c->op) {
+    case OP_LT:
+	return v < c->threshold + hysteresis;
+    case OP_LE:
+	return v <= c->threshold + hysteresis;
+    case OP_GT:
+	return v > c->threshold - hysteresis;
+    case OP_GE:
+	return v >= c->threshold - hysteresis;
+    case OP_EQ:
+	return v == c->threshold;
+    case OP_NE:
+	return v != c->threshold;
+    }
+    return v != 0;
+}
+
+/* whether a device the first condition names meets all n of them, it
+ * sets *index to the first that does and *value to what the first
+ * condition looked at */
+static int conditions_hold(const struct acpi_snapshot *snap, const struct condition *c, int n, double hysteresis,
+			   int *index, double *value)
+{
+    const struct device_info *dev;
+    int i, k, count;
+    double v;
+
+    count = acpi_count(snap, c->type);
+    for (i = c->index < 0 ? 0 : c->index; i < count; i++) {
+	dev = acpi_device(snap, c->type, i);
+	for (k = 0; k < n; k++) {
+	    if (!get_value(dev, c[k].value->value, &v) || !compare(&c[k], v, hysteresis))
+		break;
+	    if (k == 0)
+		*value = v;
+	}
+	if (k == n) {
+	    *index = i;
+	    return TRUE;
+	}
+	if (c->index >= 0)
+	    break;
+    }
+    return FALSE;
+}
+
+static void run_command(const struct rule *r, const char *device, double value)
+{
+    char buf[32];
+    pid_t pid;
+
+    pid = fork();
+    if (pid < 0) {
+	fprintf(stderr, "Cannot run the command of rule %s: %s\n", r->name, strerror(errno));
+    } else if (pid == 0) {
+	snprintf(buf, sizeof(buf), "%g", value);
+	setenv("ACPI_RULE", r->name, 1);
+	setenv("ACPI_DEVICE", device, 1);
+	setenv("ACPI_VALUE", buf, 1);
+	execl("/bin/sh", "sh", "-c", r->command, (char *) NULL);
+	_exit(127);
+    }
+}
+
+/* tell about a rule that fired resp. cleared, detail is NULL for the latter */
+static void notify(const struct rule *r, const char *detail)
+{
+    char buf[BUF_SIZE];
+    int len;
+
+    printf("Rule %s: %s%s%s\n", r->name, detail ? "fired" : "cleared", detail ? ", " : "", detail ? detail : "");
+    if (r->fd < 0)
+	return;
+    len = snprintf(buf, sizeof(buf), "%s %s%s%s\n", r->name, detail ? "fired" : "cleared", detail ? " " : "",
+		   detail ? detail : "");
+    if (len >= (int) sizeof(buf)) {
+	len = sizeof(buf);
+	buf[len - 1] = '\n';
+    }
+    if (write(r->fd, buf, len) < 0)
+	fprintf(stderr, "Cannot write to descriptor %d: %s\n", r->fd, strerror(errno));
+}
+
+/* check a rule against a snapshot taken at now, returns TRUE if it fired
+ * or cleared */
+static int rule_update(const struct rules *rs, struct rule *r, const struct acpi_snapshot *snap, double now)
+{
+    const struct condition *c = &rs->cond[r->first], *end = c + r->num_conds, *g, *next;
+    const struct device_info *dev;
+    char detail[BUF_SIZE];
+    int holds = TRUE, index = 0, i;
+    double value = 0, v;
+
+    for (g = c; g < end && holds; g = next) {
+	for (next = g + 1; next < end && !next->subject; next++)
+	    ;
+	holds = conditions_hold(snap, g, next - g, r->fired ? r->hysteresis : 0, g == c ? &index : &i,
+				g == c ? &value : &v);
+    }
+
+    if (!holds) {
+	r->since = -1;
+	if (!r->fired)
+	    return FALSE;
+	r->fired = FALSE;
+	notify(r, NULL);
+	return TRUE;
+    }
+    if (r->fired)
+	return FALSE;
+    if (r->since < 0)
+	r->since = now;
+    if (now - r->since < r->hold)
+	return FALSE;
+
+    r->fired = TRUE;
+    dev = acpi_device(snap, c->type, index);
+    if (c->op == OP_FLAG)
+	snprintf(detail, sizeof(detail), "%s %d %s%s%s", class_shown[c->type], index, c->value->word,
+		 c->value->second ? " " : "", c->value->second ? c->value->second : "");
+    else
+	snprintf(detail, sizeof(detail), "%s %d %s %g", class_shown[c->type], index, c->value->word, value);
+    notify(r, detail);
+    if (r->command)
+	run_command(r, dev->name, value);
+    return TRUE;
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int rules_run(struct acpi_context *ctx, const char *file, double interval)
+{
+    struct rules rs;
+    struct acpi_snapshot *snap;
+    struct sigaction sa;
+    void *buf = NULL;
+    size_t size = 0;
+    int i, changed, err, rval = 0;
+    double now;
+
+    memset(&rs, 0, sizeof(rs));
+    if (rules_load(&rs, file) < 0) {
+	rules_free(&rs);
+	return 1;
+    }
+
+    /* the sleep has to end so that the rules are freed */
+    catch_stop();
+    memset(&sa, 0, sizeof(sa));
+    /* the commands are not waited for, and a reader of a descriptor that
+     * went away must not end the program */
+    sa.sa_handler = SIG_DFL;
+    sa.sa_flags = SA_NOCLDWAIT;
+    sigaction(SIGCHLD, &sa, NULL);
+    sa.sa_handler = SIG_IGN;
+    sa.sa_flags = 0;
+    sigaction(SIGPIPE, &sa, NULL);
+
+    while (!stop_requested()) {
+	err = take_snapshot(ctx, rs.classes, &buf, &size, &snap);
+	if (err != ACPI_OK) {
+	    fprintf(stderr, "%s.\n", acpi_strerror(err));
+	    rval = 1;
+	    break;
+	}
+	now = now_seconds();
+	changed = FALSE;
+	for (i = 0; i < rs.num_rules; i++)
+	    changed |= rule_update(&rs, &rs.rule[i], snap, now);
+	if (changed)
+	    fflush(stdout);
+	sleep_interval(interval);
+    }
+
+    rules_free(&rs);
+    free(buf);
+    return rval;
+}
@@ -0,0 +1,263 @@
+/* decides when each device is read next from how fast it changes
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "acpi.h"
+#include "schedule.h"
+
+#define SCHEDULE_SLACK		0.25	/* a device may be read this part of its interval early,
+					   so that it shares a wakeup with others */
+#define SCHEDULE_POWER_FACTOR	2.0	/* on ac the longest interval is this much longer, for a
+					   discharging battery this much shorter */
+#define SCHEDULE_TRIP_NEAR	5.0	/* degrees from a trip point at which a zone is read */
+#define SCHEDULE_TRIP_FACTOR	4.0	/* this much more often at least */
+
+/* the change of a value worth a reading, 0 for classes without one */
+static const double step[ACPI_CLASSES] = {
+    1.0,			/* percent of a battery */
+    1.0,			/* an adapter going on- or off-line */
+    0.5,			/* degrees of a thermal zone */
+    1.0,			/* a cooling state */
+    0, 0, 0
+};
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* the value the schedule of a device follows, NAN if it is unknown */
+static double device_value(const struct device_info *dev)
+{
+    struct battery_status s;
+
+    switch (dev->type) {
+    case BATTERY:
+	if (!dev->info.battery.state)
+	    return NAN;
+	get_battery_status(&dev->info.battery, &s);
+	if (s.last_capacity <= 0 || s.remaining_capacity < 0)
+	    return NAN;
+	return s.remaining_capacity * 100.0 / s.last_capacity;
+    case AC_ADAPTER:
+	return dev->info.ac_adapter.state ? !strcmp(dev->info.ac_adapter.state, "on-line") : NAN;
+    case THERMAL_ZONE:
+	return dev->info.thermal.state ? dev->info.thermal.temperature : NAN;
+    case COOLING_DEV:
+	return dev->info.cooling.cur_state >= 0 ? dev->info.cooling.cur_state : NAN;
+    }
+    return NAN;
+}
+
+static double longest(const struct schedule *s, const struct device_info *dev)
+{
+    if (s->on_ac)
+	return s->max * SCHEDULE_POWER_FACTOR;
+    if (dev && dev->type == BATTERY && dev->info.battery.charging == BATTERY_DISCHARGING)
+	return s->max / SCHEDULE_POWER_FACTOR;
+    return s->max;
+}
+
+/* as long as it takes the value to change by a step, at most twice as
+ * long as last time; a thermal zone is read at least twice before it
+ * reaches the trip point it heads for, and more often close to one even
+ * if it stays there */
+static double device_interval(const struct schedule *s, const struct due *d, const struct device_info *dev)
+{
+    const struct thermal_info *t = &dev->info.thermal;
+    double interval, max = longest(s, dev), dist;
+    int i;
+
+    interval = d->rate != 0 ? step[dev->type] / fabs(d->rate) : max;
+    if (interval > d->interval * 2)
+	interval = d->interval * 2;
+    if (dev->type == THERMAL_ZONE && !isnan(d->value)) {
+	for (i = 0; i < t->trip_points; i++) {
+	    if (!t->trip[i].type || t->trip[i].temp < MIN_TEMP)
+		continue;
+	    dist = t->trip[i].temp - d->value;
+	    if (fabs(dist) < SCHEDULE_TRIP_NEAR && interval > max / SCHEDULE_TRIP_FACTOR)
+		interval = max / SCHEDULE_TRIP_FACTOR;
+	    if (dist * d->rate > 0 && dist / d->rate / 2 < interval)
+		interval = dist / d->rate / 2;
+	}
+    }
+    if (interval < s->min)
+	interval = s->min;
+    if (interval > max)
+	interval = max;
+    return interval;
+}
+
+struct schedule *schedule_new(double min, double max)
+{
+    struct schedule *s = calloc(1, sizeof(struct schedule));
+
+    if (!s)
+	return NULL;
+    s->min = min;
+    s->max = max;
+    return s;
+}
+
+static struct due *due_get(struct schedule *s, int type, const char *name)
+{
+    struct due *p;
+    int i;
+
+    for (i = 0; i < s->num; i++)
+	if (s->due[i].type == type && (name ? s->due[i].name && !strcmp(s->due[i].name, name) : !s->due[i].name))
+	    return &s->due[i];
+
+    p = realloc(s->due, (s->num + 1) * sizeof(struct due));
+    if (!p)
+	return NULL;
+    s->due = p;
+    p = &s->due[s->num];
+    memset(p, 0, sizeof(struct due));
+    p->type = type;
+    if (name && !(p->name = strdup(name)))
+	return NULL;
+    p->value = NAN;
+    p->time = -1;
+    p->interval = s->min;
+    /* a new device was just read */
+    p->reading = TRUE;
+    s->num++;
+    return p;
+}
+
+int schedule_update(struct schedule *s, const struct acpi_snapshot *snap)
+{
+    const struct device_info *dev;
+    struct due *d;
+    double t = now(), v, rate;
+    int i, type, discharging = FALSE, online = FALSE;
+
+    for (i = 0; i < acpi_count(snap, BATTERY); i++)
+	if (acpi_device(snap, BATTERY, i)->info.battery.charging == BATTERY_DISCHARGING)
+	    discharging = TRUE;
+    for (i = 0; i < acpi_count(snap, AC_ADAPTER); i++)
+	if (device_value(acpi_device(snap, AC_ADAPTER, i)) == 1)
+	    online = TRUE;
+    s->on_ac = acpi_count(snap, BATTERY) > 0 ? !discharging : online;
+
+    for (i = 0; i < s->num; i++)
+	s->due[i].seen = FALSE;
+
+    for (type = 0; type < ACPI_CLASSES; type++) {
+	if (acpi_count(snap, type) < 0)
+	    continue;
+	if (!step[type]) {
+	    d = due_get(s, type, NULL);
+	    if (!d)
+		return -1;
+	    d->seen = TRUE;
+	    if (d->reading) {
+		d->reading = FALSE;
+		d->interval = longest(s, NULL);
+		d->next = t + d->interval;
+	    }
+	    continue;
+	}
+	for (i = 0; i < acpi_count(snap, type); i++) {
+	    dev = acpi_device(snap, type, i);
+	    d = due_get(s, type, dev->name);
+	    if (!d)
+		return -1;
+	    d->seen = TRUE;
+	    v = device_value(dev);
+	    /* the others were not read again, unless an event made them */
+	    if (!d->reading && (v == d->value || (isnan(v) && isnan(d->value))))
+		continue;
+	    if (d->time >= 0 && t > d->time && !isnan(v) && !isnan(d->value)) {
+		rate = (v - d->value) / (t - d->time);
+		/* the weight of a change halves with every reading */
+		d->rate = (d->rate + rate) / 2;
+	    } else
+		d->rate = 0;
+	    d->value = v;
+	    d->time = t;
+	    d->interval = device_interval(s, d, dev);
+	    d->next = t + d->interval;
+	    d->reading = FALSE;
+	}
+    }
+
+    for (i = 0; i < s->num; ) {
+	if (s->due[i].seen) {
+	    i++;
+	    continue;
+	}
+	free(s->due[i].name);
+	s->due[i] = s->due[--s->num];
+    }
+    return 0;
+}
+
+double schedule_wakeup(const struct schedule *s)
+{
+    double wake = -1;
+    int i;
+
+    /* schedule_run() takes along those due shortly after */
+    for (i = 0; i < s->num; i++)
+	if (wake < 0 || s->due[i].next < wake)
+	    wake = s->due[i].next;
+    return wake;
+}
+
+int schedule_run(struct schedule *s, struct acpi_context *ctx)
+{
+    struct due *d;
+    double t = now();
+    int i, classes = 0;
+
+    for (i = 0; i < s->num; i++) {
+	d = &s->due[i];
+	if (d->next - d->interval * SCHEDULE_SLACK > t)
+	    continue;
+	if (d->name)
+	    acpi_invalidate_device(ctx, d->type, d->name);
+	else
+	    acpi_invalidate(ctx, ACPI_CLASS(d->type));
+	d->reading = TRUE;
+	classes |= ACPI_CLASS(d->type);
+    }
+    return classes;
+}
+
+void schedule_free(struct schedule *s)
+{
+    int i;
+
+    for (i = 0; i < s->num; i++)
+	free(s->due[i].name);
+    free(s->due);
+    free(s);
+}
@@ -0,0 +1,84 @@
+/* decides when each device is read next from how fast it changes
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#ifndef _SCHEDULE_H
+#define _SCHEDULE_H
+
+#include "libacpi.h"
+
+/* when a device is read next; classes without a value to follow are
+ * read as a whole and have one entry without a name */
+struct due {
+    int type;
+    char *name;			/* NULL for a whole class */
+    double value;		/* what was read last, NAN if unknown */
+    double time;		/* when, -1 if never */
+    double rate;		/* smoothed change of the value per second */
+    double interval;		/* seconds until the next reading */
+    double next;		/* monotonic time of the next reading */
+    int reading;		/* invalidated for the next snapshot */
+    int seen;
+};
+
+struct schedule {
+    double min;			/* the shortest interval */
+    double max;			/* the longest, on battery */
+    int on_ac;			/* no battery discharges */
+    int num;
+    struct due *due;
+};
+
+/* read every device between min and max seconds apart
+ *
+ * Pre: 0 < min <= max
+ * Post: returns the schedule or NULL if out of memory
+ */
+struct schedule *schedule_new(double min, double max);
+
+/* plan the next reading of every device a snapshot read, either because
+ * it was due or because an event said it changed; devices that are gone
+ * are dropped
+ *
+ * Pre: s was returned by schedule_new()
+ * Post: returns 0, or -1 if out of memory
+ */
+int schedule_update(struct schedule *s, const struct acpi_snapshot *snap);
+
+/* when the devices due next are read together, on CLOCK_MONOTONIC
+ *
+ * Pre: s was returned by schedule_new()
+ * Post: returns the time in seconds, or -1 if there is nothing to read
+ */
+double schedule_wakeup(const struct schedule *s);
+
+/* have the next snapshot of ctx read the devices that are due now
+ *
+ * Pre: s was returned by schedule_new()
+ * Post: returns the ACPI_CLASS() mask of the classes with a device due
+ */
+int schedule_run(struct schedule *s, struct acpi_context *ctx);
+
+/* Pre: s was returned by schedule_new()
+ * Post: s is invalid
+ */
+void schedule_free(struct schedule *s);
+
+#endif
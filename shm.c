@@ -0,0 +1,322 @@
+/* snapshots published in a shared memory file, guarded by a sequence lock
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "acpi.h"
+#include "shm.h"
+
+/* how often a reader tries before it gives up on a busy writer */
+#define SHM_RETRIES	1000
+
+struct shm_reader {
+    char *path;
+    struct shm_region *map;
+    struct shm_region *copy;
+};
+
+struct acpi_publisher {
+    char *path;
+    char *tmp;			/* where the file is until the first snapshot is in */
+    int fd;
+    struct shm_region *map;
+    struct shm_region *stage;	/* the next snapshot, copied in while seq is odd */
+};
+
+/* map a file and check that it is laid out the way we lay it out */
+static struct shm_region *shm_map(const char *path, int writable)
+{
+    struct shm_region *map;
+    struct stat st;
+    int fd;
+
+    fd = open(path, (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+    if (fd < 0)
+	return NULL;
+    if (fstat(fd, &st) < 0 || st.st_size < sizeof(struct shm_region)) {
+	close(fd);
+	return NULL;
+    }
+    map = mmap(NULL, sizeof(struct shm_region), PROT_READ | (writable ? PROT_WRITE : 0), MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+	return NULL;
+    if (map->magic != SHM_MAGIC || map->version != SHM_VERSION ||
+	map->device_size != sizeof(struct shm_device) || map->max_devices != SHM_MAX_DEVICES) {
+	munmap(map, sizeof(struct shm_region));
+	return NULL;
+    }
+    return map;
+}
+
+struct shm_reader *shm_attach(const char *path)
+{
+    struct shm_reader *r;
+
+    r = calloc(1, sizeof(struct shm_reader));
+    if (!r)
+	return NULL;
+    r->path = strdup(path);
+    r->copy = malloc(sizeof(struct shm_region));
+    if (r->path && r->copy && (r->map = shm_map(path, FALSE)))
+	return r;
+    free(r->copy);
+    free(r->path);
+    free(r);
+    return NULL;
+}
+
+/* the writer went away, follow the one that replaced the file if any */
+static int shm_remap(struct shm_reader *r)
+{
+    struct shm_region *map = shm_map(r->path, FALSE);
+
+    if (!map)
+	return -1;
+    munmap(r->map, sizeof(struct shm_region));
+    r->map = map;
+    return 0;
+}
+
+int shm_read(struct shm_reader *r, const struct shm_region **region)
+{
+    const struct shm_region *m;
+    uint32_t seq;
+    int n, tries;
+
+    for (tries = 0; tries < SHM_RETRIES; tries++) {
+	if (__atomic_load_n(&r->map->closed, __ATOMIC_ACQUIRE) && shm_remap(r) < 0)
+	    return ACPI_ENOACPI;
+	m = r->map;
+	seq = __atomic_load_n(&m->seq, __ATOMIC_ACQUIRE);
+	if (seq & 1) {
+	    sched_yield();
+	    continue;
+	}
+	memcpy(r->copy, m, offsetof(struct shm_region, device));
+	n = r->copy->num_devices;
+	if (n < 0 || n > SHM_MAX_DEVICES)
+	    n = 0;
+	memcpy(r->copy->device, m->device, n * sizeof(struct shm_device));
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&m->seq, __ATOMIC_RELAXED) == seq) {
+	    r->copy->num_devices = n;
+	    *region = r->copy;
+	    return ACPI_OK;
+	}
+    }
+    return ACPI_EBUSY;
+}
+
+void shm_detach(struct shm_reader *r)
+{
+    munmap(r->map, sizeof(struct shm_region));
+    free(r->copy);
+    free(r->path);
+    free(r);
+}
+
+/* tell the readers of a file we are about to replace to look again */
+static void shm_retire(const char *path)
+{
+    struct shm_region *map = shm_map(path, TRUE);
+
+    if (!map)
+	return;
+    __atomic_store_n(&map->closed, 1, __ATOMIC_RELEASE);
+    munmap(map, sizeof(struct shm_region));
+}
+
+int acpi_publisher_open(const char *file, struct acpi_publisher **pub)
+{
+    struct acpi_publisher *p;
+    char *tmp;
+    int i;
+
+    if (!file || !pub)
+	return ACPI_EINVAL;
+    p = calloc(1, sizeof(struct acpi_publisher));
+    tmp = malloc(strlen(file) + 8);
+    if (!p || !tmp || !(p->path = strdup(file)) || !(p->stage = malloc(sizeof(struct shm_region)))) {
+	if (p) {
+	    free(p->path);
+	    free(p);
+	}
+	free(tmp);
+	return ACPI_ENOMEM;
+    }
+
+    /* readers must never see a file without a snapshot, it gets its
+     * name with the first one */
+    sprintf(tmp, "%s.XXXXXX", file);
+    p->fd = mkstemp(tmp);
+    if (p->fd < 0)
+	goto fail;
+    if (fchmod(p->fd, 0644) < 0 || ftruncate(p->fd, sizeof(struct shm_region)) < 0)
+	goto fail_unlink;
+    p->map = mmap(NULL, sizeof(struct shm_region), PROT_READ | PROT_WRITE, MAP_SHARED, p->fd, 0);
+    if (p->map == MAP_FAILED)
+	goto fail_unlink;
+    p->map->magic = SHM_MAGIC;
+    p->map->version = SHM_VERSION;
+    p->map->device_size = sizeof(struct shm_device);
+    p->map->max_devices = SHM_MAX_DEVICES;
+    for (i = 0; i < SHM_CLASSES; i++)
+	p->map->count[i] = ACPI_ENODEV;
+    p->tmp = tmp;
+    *pub = p;
+    return ACPI_OK;
+
+fail_unlink:
+    i = errno;
+    unlink(tmp);
+    errno = i;
+fail:
+    i = errno;
+    if (p->fd >= 0)
+	close(p->fd);
+    free(p->stage);
+    free(p->path);
+    free(p);
+    free(tmp);
+    errno = i;
+    return ACPI_ENOACPI;
+}
+
+static void copy_string(char *dst, const char *s)
+{
+    snprintf(dst, SHM_NAME_SIZE, "%s", s ? s : "");
+}
+
+static void stage_device(struct shm_device *d, const struct device_info *dev)
+{
+    const struct battery_info *b = &dev->info.battery;
+    const struct thermal_info *t = &dev->info.thermal;
+    const struct cooling_info *c = &dev->info.cooling;
+    int i;
+
+    memset(d, 0, sizeof(struct shm_device));
+    d->type = dev->type;
+    d->present = dev->present;
+    copy_string(d->name, dev->name);
+    switch (dev->type) {
+    case BATTERY:
+	copy_string(d->state, b->state);
+	d->info.battery.charging = b->charging;
+	d->info.battery.remaining_capacity = b->remaining_capacity;
+	d->info.battery.remaining_energy = b->remaining_energy;
+	d->info.battery.present_rate = b->present_rate;
+	d->info.battery.voltage = b->voltage;
+	d->info.battery.design_capacity = b->design_capacity;
+	d->info.battery.design_capacity_unit = b->design_capacity_unit;
+	d->info.battery.last_capacity = b->last_capacity;
+	d->info.battery.last_capacity_unit = b->last_capacity_unit;
+	break;
+    case AC_ADAPTER:
+	copy_string(d->state, dev->info.ac_adapter.state);
+	break;
+    case THERMAL_ZONE:
+	copy_string(d->state, t->state);
+	d->info.thermal.temperature = t->temperature;
+	d->info.thermal.trip_points = t->trip_points < SHM_TRIP_POINTS ? t->trip_points : SHM_TRIP_POINTS;
+	for (i = 0; i < d->info.thermal.trip_points; i++) {
+	    d->info.thermal.trip[i].temp = t->trip[i].temp;
+	    d->info.thermal.trip[i].hyst = t->trip[i].hyst;
+	    copy_string(d->info.thermal.trip[i].type, t->trip[i].type);
+	}
+	break;
+    case COOLING_DEV:
+	copy_string(d->state, c->state);
+	copy_string(d->info.cooling.type, c->type);
+	d->info.cooling.cur_state = c->cur_state;
+	d->info.cooling.max_state = c->max_state;
+	break;
+    }
+}
+
+int acpi_publish(struct acpi_publisher *pub, const struct acpi_snapshot *snap)
+{
+    struct shm_region *s = pub->stage;
+    struct timespec ts;
+    uint32_t seq;
+    int type, i, count;
+
+    /* everything is put together first, so that the readers only wait
+     * for a copy */
+    s->num_devices = 0;
+    for (type = 0; type < SHM_CLASSES; type++) {
+	count = acpi_count(snap, type);
+	s->count[type] = count < 0 ? ACPI_ENODEV : 0;
+	for (i = 0; i < count && s->num_devices < SHM_MAX_DEVICES; i++) {
+	    stage_device(&s->device[s->num_devices++], acpi_device(snap, type, i));
+	    s->count[type]++;
+	}
+    }
+    clock_gettime(CLOCK_REALTIME, &ts);
+    s->time = ts.tv_sec + ts.tv_nsec / 1e9;
+
+    seq = pub->map->seq;
+    __atomic_store_n(&pub->map->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(pub->map->count, s->count, sizeof(s->count));
+    pub->map->num_devices = s->num_devices;
+    pub->map->time = s->time;
+    memcpy(pub->map->device, s->device, s->num_devices * sizeof(struct shm_device));
+    __atomic_store_n(&pub->map->seq, seq + 2, __ATOMIC_RELEASE);
+
+    if (pub->tmp) {
+	shm_retire(pub->path);
+	if (rename(pub->tmp, pub->path) < 0)
+	    return ACPI_ENOACPI;
+	free(pub->tmp);
+	pub->tmp = NULL;
+    }
+    return ACPI_OK;
+}
+
+void acpi_publisher_close(struct acpi_publisher *pub)
+{
+    struct stat st, ours;
+
+    __atomic_store_n(&pub->map->closed, 1, __ATOMIC_RELEASE);
+    /* unless a new publisher took over the name meanwhile */
+    if (pub->tmp)
+	unlink(pub->tmp);
+    else if (stat(pub->path, &st) == 0 && fstat(pub->fd, &ours) == 0 &&
+	     st.st_dev == ours.st_dev && st.st_ino == ours.st_ino)
+	unlink(pub->path);
+    munmap(pub->map, sizeof(struct shm_region));
+    close(pub->fd);
+    free(pub->stage);
+    free(pub->tmp);
+    free(pub->path);
+    free(pub);
+}
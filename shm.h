@@ -0,0 +1,117 @@
+/* snapshots published in a shared memory file, guarded by a sequence lock
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#ifndef _SHM_H
+#define _SHM_H
+
+#include <stdint.h>
+
+#define SHM_MAGIC	0x49504341	/* "ACPI" */
+#define SHM_VERSION	1
+
+#define SHM_CLASSES	4	/* batteries, ac adapters, thermal zones and cooling devices */
+#define SHM_MAX_DEVICES	1024	/* the devices beyond are not published */
+#define SHM_NAME_SIZE	32	/* longer names and states are cut */
+#define SHM_TRIP_POINTS	12	/* the trip points beyond are not published */
+
+struct shm_trip_point {
+    float temp;
+    float hyst;
+    char type[SHM_NAME_SIZE];	/* empty if the trip point is not there */
+};
+
+/* the values of struct device_info with the strings in place; the raw
+ * attributes are not published */
+struct shm_device {
+    int32_t type;
+    int32_t present;
+    char name[SHM_NAME_SIZE];
+    char state[SHM_NAME_SIZE];	/* empty if the device had none */
+    union {
+	struct {
+	    int32_t charging;
+	    int32_t remaining_capacity;
+	    int32_t remaining_energy;
+	    int32_t present_rate;
+	    int32_t voltage;
+	    int32_t design_capacity;
+	    int32_t design_capacity_unit;
+	    int32_t last_capacity;
+	    int32_t last_capacity_unit;
+	} battery;
+	struct {
+	    float temperature;
+	    int32_t trip_points;
+	    struct shm_trip_point trip[SHM_TRIP_POINTS];
+	} thermal;
+	struct {
+	    char type[SHM_NAME_SIZE];
+	    int32_t cur_state;
+	    int32_t max_state;
+	} cooling;
+    } info;
+};
+
+/* the layout of the file; the writer makes seq odd, writes everything
+ * after it and makes it even again, a reader copies what it needs and
+ * tries again if seq was odd or changed meanwhile */
+struct shm_region {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t device_size;	/* sizeof(struct shm_device) of the writer */
+    uint32_t max_devices;
+    uint32_t seq;
+    uint32_t closed;		/* the writer is gone, a new one may have replaced the file */
+    int32_t count[SHM_CLASSES];	/* devices of each class, ACPI_ENODEV if it was not there */
+    int32_t num_devices;
+    int32_t reserved;
+    double time;		/* when the devices were read, seconds since the epoch */
+    struct shm_device device[SHM_MAX_DEVICES];
+};
+
+struct shm_reader;
+
+/* map a file a publisher wrote
+ *
+ * Pre: path != NULL
+ * Post: returns the reader, or NULL if the file cannot be mapped or is not
+ *       one of ours
+ */
+struct shm_reader *shm_attach(const char *path);
+
+/* copy a consistent state of the file, without any system call unless the
+ * writer is busy; only the devices in use are copied
+ *
+ * Pre: r was returned by shm_attach()
+ * Post: returns ACPI_OK and sets *region to a copy that stays valid until
+ *       the next call, ACPI_EBUSY if the writer did not finish in time or
+ *       ACPI_ENOACPI if the writer is gone and nobody took over
+ */
+int shm_read(struct shm_reader *r, const struct shm_region **region);
+
+/* unmap the file
+ *
+ * Pre: r was returned by shm_attach()
+ * Post: r is invalid
+ */
+void shm_detach(struct shm_reader *r);
+
+#endif
@@ -0,0 +1,79 @@
+/* takes the snapshots of the modes that keep running and stops them
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+
+#include "acpi.h"
+
+static volatile sig_atomic_t stop;
+
+static void handle_stop(int sig)
+{
+    stop = 1;
+}
+
+int take_snapshot(struct acpi_context *ctx, int classes, void **buf, size_t *size, struct acpi_snapshot **snap)
+{
+    size_t grown;
+    void *p;
+    int err;
+
+    while ((err = acpi_snapshot(ctx, classes, *buf, *size, snap)) == ACPI_ENOSPC) {
+	grown = *size ? *size * 2 : SNAPSHOT_SIZE;
+	p = realloc(*buf, grown);
+	if (!p)
+	    return ACPI_ENOMEM;
+	*buf = p;
+	*size = grown;
+    }
+    return err;
+}
+
+void catch_stop(void)
+{
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    /* no SA_RESTART, a sleep or accept() has to end so that the caller
+     * can clean up */
+    sa.sa_handler = handle_stop;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+}
+
+int stop_requested(void)
+{
+    return stop;
+}
+
+void sleep_interval(double seconds)
+{
+    struct timespec ts;
+
+    ts.tv_sec = (time_t) seconds;
+    ts.tv_nsec = (long) ((seconds - ts.tv_sec) * 1e9);
+    while (!stop && nanosleep(&ts, &ts) < 0 && errno == EINTR)
+	;
+}
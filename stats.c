@@ -0,0 +1,385 @@
+/* rolling statistics over the last samples of a device
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "acpi.h"
+#include "stats.h"
+
+static const double quantiles[WINDOW_QUANTILES] = { 0.5, 0.9 };
+
+static void p2_init(struct p2 *e, double p)/*{{{*/
+{
+    e->p = p;
+    e->n = 0;
+}
+
+static int compare_doubles(const void *a, const void *b)/*{{{*/
+{
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* Jain and Chlamtac: the five markers sit at the minimum, the p/2, p and
+ * (1+p)/2 quantiles and the maximum, and are moved along a parabola */
+static void p2_add(struct p2 *e, double x)/*{{{*/
+{
+    static const double step[5] = { 0, 0.5, 1, 0, 0 };
+    double inc[5], d, ds, qp;
+    int i, k;
+
+    if (e->n < 5) {
+	e->q[e->n++] = x;
+	if (e->n == 5) {
+	    qsort(e->q, 5, sizeof(double), compare_doubles);
+	    for (i = 0; i < 5; i++)
+		e->pos[i] = i + 1;
+	    e->want[0] = 1;
+	    e->want[1] = 1 + 2 * e->p;
+	    e->want[2] = 1 + 4 * e->p;
+	    e->want[3] = 3 + 2 * e->p;
+	    e->want[4] = 5;
+	}
+	return;
+    }
+
+    if (x < e->q[0]) {
+	e->q[0] = x;
+	k = 0;
+    } else if (x >= e->q[4]) {
+	e->q[4] = x;
+	k = 3;
+    } else {
+	for (k = 0; k < 3 && x >= e->q[k + 1]; k++)
+	    ;
+    }
+    for (i = k + 1; i < 5; i++)
+	e->pos[i]++;
+    inc[0] = 0;
+    inc[1] = e->p * step[1];
+    inc[2] = e->p * step[2];
+    inc[3] = (1 + e->p) / 2;
+    inc[4] = 1;
+    for (i = 0; i < 5; i++)
+	e->want[i] += inc[i];
+    e->n++;
+
+    for (i = 1; i < 4; i++) {
+	d = e->want[i] - e->pos[i];
+	if ((d >= 1 && e->pos[i + 1] - e->pos[i] > 1) || (d <= -1 && e->pos[i - 1] - e->pos[i] < -1)) {
+	    ds = d > 0 ? 1 : -1;
+	    qp = e->q[i] + ds / (e->pos[i + 1] - e->pos[i - 1]) *
+		 ((e->pos[i] - e->pos[i - 1] + ds) * (e->q[i + 1] - e->q[i]) / (e->pos[i + 1] - e->pos[i]) +
+		  (e->pos[i + 1] - e->pos[i] - ds) * (e->q[i] - e->q[i - 1]) / (e->pos[i] - e->pos[i - 1]));
+	    if (e->q[i - 1] < qp && qp < e->q[i + 1])
+		e->q[i] = qp;
+	    else
+		e->q[i] += ds * (e->q[i + (int) ds] - e->q[i]) / (e->pos[i + (int) ds] - e->pos[i]);
+	    e->pos[i] += ds;
+	}
+    }
+}
+
+static double p2_value(const struct p2 *e)/*{{{*/
+{
+    double q[5];
+
+    if (e->n >= 5)
+	return e->q[2];
+    /* too few for the markers, these are still the samples */
+    memcpy(q, e->q, e->n * sizeof(double));
+    qsort(q, e->n, sizeof(double), compare_doubles);
+    return q[(int) (e->p * (e->n - 1) + 0.5)];
+}
+
+int window_init(struct window *w, int size)/*{{{*/
+{
+    memset(w, 0, sizeof(struct window));
+    w->size = size;
+    w->t = malloc(size * sizeof(double));
+    w->x = malloc(size * sizeof(double));
+    w->min_q = malloc(size * sizeof(long));
+    w->max_q = malloc(size * sizeof(long));
+    if (!w->t || !w->x || !w->min_q || !w->max_q) {
+	window_free(w);
+	return -1;
+    }
+    window_reset(w);
+    return 0;
+}
+
+void window_reset(struct window *w)/*{{{*/
+{
+    int i, j;
+
+    w->count = 0;
+    w->total = 0;
+    w->ewma = w->mean_t = w->mean_x = 0;
+    w->m2_t = w->m2_x = w->c_tx = 0;
+    w->min_head = w->min_len = w->max_head = w->max_len = 0;
+    for (i = 0; i < 2; i++)
+	for (j = 0; j < WINDOW_QUANTILES; j++)
+	    p2_init(&w->quantile[i][j], quantiles[j]);
+}
+
+/* drop seq and everything older from the front of a queue */
+static void queue_expire(const struct window *w, long *q, int *head, int *len, long seq)/*{{{*/
+{
+    while (*len && q[*head] <= seq) {
+	*head = (*head + 1) % w->size;
+	(*len)--;
+    }
+}
+
+/* the queues hold the candidates for the minimum resp. maximum in the
+ * order they came, each one better than all that came before it */
+static void queue_push(const struct window *w, long *q, int head, int *len, long seq, int max)/*{{{*/
+{
+    double x = w->x[seq % w->size], y;
+
+    while (*len) {
+	y = w->x[q[(head + *len - 1) % w->size] % w->size];
+	if (max ? y > x : y < x)
+	    break;
+	(*len)--;
+    }
+    q[(head + *len) % w->size] = seq;
+    (*len)++;
+}
+
+void window_add(struct window *w, double t, double x)/*{{{*/
+{
+    long seq = w->total++;
+    int slot = seq % w->size, half = w->size / 2 > 0 ? w->size / 2 : 1, i, j;
+    double t0, x0, mean_t, mean_x, dt, dx;
+
+    if (w->count == w->size) {
+	/* take the oldest sample out, the reverse of adding it */
+	t0 = w->t[slot];
+	x0 = w->x[slot];
+	if (w->count == 1) {
+	    w->mean_t = w->mean_x = w->m2_t = w->m2_x = w->c_tx = 0;
+	} else {
+	    mean_t = (w->count * w->mean_t - t0) / (w->count - 1);
+	    mean_x = (w->count * w->mean_x - x0) / (w->count - 1);
+	    w->m2_t -= (t0 - mean_t) * (t0 - w->mean_t);
+	    w->m2_x -= (x0 - mean_x) * (x0 - w->mean_x);
+	    w->c_tx -= (t0 - mean_t) * (x0 - w->mean_x);
+	    w->mean_t = mean_t;
+	    w->mean_x = mean_x;
+	}
+	w->count--;
+	queue_expire(w, w->min_q, &w->min_head, &w->min_len, seq - w->size);
+	queue_expire(w, w->max_q, &w->max_head, &w->max_len, seq - w->size);
+    }
+
+    w->t[slot] = t;
+    w->x[slot] = x;
+    w->count++;
+    dt = t - w->mean_t;
+    dx = x - w->mean_x;
+    w->mean_t += dt / w->count;
+    w->mean_x += dx / w->count;
+    w->m2_t += dt * (t - w->mean_t);
+    w->m2_x += dx * (x - w->mean_x);
+    w->c_tx += dt * (x - w->mean_x);
+    w->ewma = seq ? w->ewma + 2.0 / (w->size + 1) * (x - w->ewma) : x;
+    queue_push(w, w->min_q, w->min_head, &w->min_len, seq, FALSE);
+    queue_push(w, w->max_q, w->max_head, &w->max_len, seq, TRUE);
+
+    /* the second estimator starts half a window later, so one of them
+     * always has seen between half and all of the window */
+    for (i = 0; i < 2; i++) {
+	if (i && seq < half)
+	    break;
+	for (j = 0; j < WINDOW_QUANTILES; j++) {
+	    if (w->quantile[i][j].n >= w->size)
+		p2_init(&w->quantile[i][j], quantiles[j]);
+	    p2_add(&w->quantile[i][j], x);
+	}
+    }
+}
+
+double window_ewma(const struct window *w)/*{{{*/
+{
+    return w->ewma;
+}
+
+double window_mean(const struct window *w)/*{{{*/
+{
+    return w->mean_x;
+}
+
+double window_stddev(const struct window *w)/*{{{*/
+{
+    /* the removals can leave a tiny negative rest */
+    return w->count > 1 && w->m2_x > 0 ? sqrt(w->m2_x / (w->count - 1)) : 0;
+}
+
+double window_min(const struct window *w)/*{{{*/
+{
+    return w->x[w->min_q[w->min_head] % w->size];
+}
+
+double window_max(const struct window *w)/*{{{*/
+{
+    return w->x[w->max_q[w->max_head] % w->size];
+}
+
+double window_quantile(const struct window *w, int which)/*{{{*/
+{
+    const struct p2 *a = &w->quantile[0][which], *b = &w->quantile[1][which];
+
+    return p2_value(b->n > a->n ? b : a);
+}
+
+double window_slope(const struct window *w)/*{{{*/
+{
+    return w->m2_t > 0 ? w->c_tx / w->m2_t : 0;
+}
+
+void window_free(struct window *w)/*{{{*/
+{
+    free(w->t);
+    free(w->x);
+    free(w->min_q);
+    free(w->max_q);
+    w->t = w->x = NULL;
+    w->min_q = w->max_q = NULL;
+}
+
+static double now(void)/*{{{*/
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+struct trends *trends_new(int size)/*{{{*/
+{
+    struct trends *t = calloc(1, sizeof(struct trends));
+
+    if (!t)
+	return NULL;
+    t->size = size;
+    t->start = now();
+    return t;
+}
+
+static struct trend *trend_get(struct trends *t, const struct device_info *dev)/*{{{*/
+{
+    struct trend *p;
+    int i;
+
+    for (i = 0; i < t->num; i++)
+	if (t->trend[i].type == dev->type && !strcmp(t->trend[i].name, dev->name))
+	    return &t->trend[i];
+
+    p = realloc(t->trend, (t->num + 1) * sizeof(struct trend));
+    if (!p)
+	return NULL;
+    t->trend = p;
+    p = &t->trend[t->num];
+    memset(p, 0, sizeof(struct trend));
+    p->type = dev->type;
+    p->name = strdup(dev->name);
+    if (!p->name || window_init(&p->w, t->size) < 0) {
+	free(p->name);
+	return NULL;
+    }
+    t->num++;
+    return p;
+}
+
+int trends_update(struct trends *t, const struct acpi_snapshot *snap)/*{{{*/
+{
+    const struct device_info *dev;
+    struct trend *p;
+    double when = now() - t->start;
+    static const int types[] = { BATTERY, THERMAL_ZONE };
+    int i, j, type;
+
+    for (i = 0; i < t->num; i++)
+	t->trend[i].seen = FALSE;
+
+    for (j = 0; j < 2; j++) {
+	type = types[j];
+	for (i = 0; i < acpi_count(snap, type); i++) {
+	    dev = acpi_device(snap, type, i);
+	    if (!dev->present)
+		continue;
+	    p = trend_get(t, dev);
+	    if (!p)
+		return -1;
+	    p->seen = TRUE;
+	    if (type == THERMAL_ZONE) {
+		window_add(&p->w, when, dev->info.thermal.temperature);
+		continue;
+	    }
+	    /* charging and discharging rates do not mix */
+	    if (p->charging != dev->info.battery.charging) {
+		window_reset(&p->w);
+		p->charging = dev->info.battery.charging;
+	    }
+	    if (dev->info.battery.present_rate >= 0)
+		window_add(&p->w, when, dev->info.battery.present_rate);
+	}
+    }
+
+    for (i = 0; i < t->num; ) {
+	if (t->trend[i].seen) {
+	    i++;
+	    continue;
+	}
+	free(t->trend[i].name);
+	window_free(&t->trend[i].w);
+	t->trend[i] = t->trend[--t->num];
+    }
+    return 0;
+}
+
+const struct window *trends_find(const struct trends *t, const struct device_info *dev)/*{{{*/
+{
+    int i;
+
+    if (!t)
+	return NULL;
+    for (i = 0; i < t->num; i++)
+	if (t->trend[i].type == dev->type && !strcmp(t->trend[i].name, dev->name))
+	    return t->trend[i].w.count ? &t->trend[i].w : NULL;
+    return NULL;
+}
+
+void trends_free(struct trends *t)/*{{{*/
+{
+    int i;
+
+    for (i = 0; i < t->num; i++) {
+	free(t->trend[i].name);
+	window_free(&t->trend[i].w);
+    }
+    free(t->trend);
+    free(t);
+}
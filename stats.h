@@ -0,0 +1,160 @@
+/* rolling statistics over the last samples of a device
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#ifndef _STATS_H
+#define _STATS_H
+
+#include "libacpi.h"
+
+#define WINDOW_MEDIAN	0
+#define WINDOW_P90	1
+#define WINDOW_QUANTILES 2
+
+/* a P-square estimate of one quantile, five markers instead of the samples */
+struct p2 {
+    double p;
+    int n;
+    double q[5];
+    double pos[5];
+    double want[5];
+};
+
+/* the last size samples of a value, every update is O(1) and the memory
+ * does not grow however long it runs; the quantiles are estimated over a
+ * window that jumps between size / 2 and size samples */
+struct window {
+    int size;
+    int count;			/* samples in the window */
+    long total;			/* samples ever added, the sequence number of the next one */
+    double *t;			/* ring of times in seconds */
+    double *x;			/* and of the values */
+    double ewma;
+    double mean_t, mean_x;
+    double m2_t, m2_x, c_tx;	/* sums of squares and co-moment, Welford style */
+    long *min_q, *max_q;	/* monotonic queues of sequence numbers */
+    int min_head, min_len, max_head, max_len;
+    struct p2 quantile[2][WINDOW_QUANTILES];	/* two staggered estimators each */
+};
+
+/* one window per device and value we smooth */
+struct trend {
+    int type;
+    char *name;
+    int charging;		/* a battery starts over when this changes */
+    int seen;
+    struct window w;
+};
+
+struct trends {
+    int size;
+    double start;
+    int num;
+    struct trend *trend;
+};
+
+/* set up a window of size samples
+ *
+ * Pre: w != NULL, size > 0
+ * Post: returns 0, or -1 if out of memory
+ */
+int window_init(struct window *w, int size);
+
+/* forget every sample
+ *
+ * Pre: w was set up by window_init()
+ * Post: the window is empty
+ */
+void window_reset(struct window *w);
+
+/* add a sample taken at time t (seconds), the oldest one drops out if the
+ * window is full
+ *
+ * Pre: w was set up by window_init(), t does not go back
+ * Post: the statistics include x
+ */
+void window_add(struct window *w, double t, double x);
+
+/* the exponentially weighted average, the weight of a sample halves
+ * after about size / 3 newer ones
+ *
+ * Pre: w->count > 0
+ * Post: returns the average
+ */
+double window_ewma(const struct window *w);
+
+/* Pre: w->count > 0
+ * Post: returns the mean, standard deviation, minimum resp. maximum of
+ *       the samples in the window
+ */
+double window_mean(const struct window *w);
+double window_stddev(const struct window *w);
+double window_min(const struct window *w);
+double window_max(const struct window *w);
+
+/* an estimate of WINDOW_MEDIAN or WINDOW_P90
+ *
+ * Pre: w->count > 0
+ * Post: returns the estimate
+ */
+double window_quantile(const struct window *w, int which);
+
+/* the least squares slope of the values over time, per second
+ *
+ * Pre: w->count > 0
+ * Post: returns the slope, 0 if there are not two samples at different times
+ */
+double window_slope(const struct window *w);
+
+/* release the window
+ *
+ * Pre: w was set up by window_init()
+ * Post: w must be set up again before it is used
+ */
+void window_free(struct window *w);
+
+/* keep windows of size samples for the battery rates and temperatures
+ *
+ * Pre: size > 0
+ * Post: returns the trends or NULL if out of memory
+ */
+struct trends *trends_new(int size);
+
+/* add the rates and temperatures of a snapshot, devices that are gone
+ * are dropped
+ *
+ * Pre: t was returned by trends_new()
+ * Post: returns 0, or -1 if out of memory
+ */
+int trends_update(struct trends *t, const struct acpi_snapshot *snap);
+
+/* the window of a device
+ *
+ * Pre: t was returned by trends_new() or is NULL
+ * Post: returns the window or NULL if there is none or it is empty
+ */
+const struct window *trends_find(const struct trends *t, const struct device_info *dev);
+
+/* Pre: t was returned by trends_new()
+ * Post: t is invalid
+ */
+void trends_free(struct trends *t);
+
+#endif
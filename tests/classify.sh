@@ -0,0 +1,38 @@
+#!/bin/sh
+# a thermal_zone is a thermal zone whatever its type file says, e.g. the
+# x86_pkg_temp zone of recent Intel cpus, and never a cooling device
+#
+# usage: classify.sh [ACPI]
+
+ACPI=${1:-./acpi}
+
+TMP=`mktemp -d ${TMPDIR:-/tmp}/acpitest.XXXXXX` || exit 1
+trap 'rm -rf "$TMP"' 0 1 2 15
+
+zone() {
+	mkdir -p "$TMP/thermal/thermal_zone$1" || exit 1
+	echo "$2" > "$TMP/thermal/thermal_zone$1/type"
+	echo "$3" > "$TMP/thermal/thermal_zone$1/temp"
+}
+
+zone 0 acpitz 45000
+zone 1 x86_pkg_temp 60000
+mkdir -p "$TMP/thermal/cooling_device0" || exit 1
+echo Processor > "$TMP/thermal/cooling_device0/type"
+echo 0 > "$TMP/thermal/cooling_device0/cur_state"
+echo 3 > "$TMP/thermal/cooling_device0/max_state"
+
+status=0
+for flags in "" "-u" "-e -w 1"; do
+	# -e keeps running, the first update is all we need
+	timeout 1.5 "$ACPI" -N -t -c $flags -d "$TMP" > "$TMP/out" 2>&1
+	if [ `grep -c '^Thermal .*60.0 degrees' "$TMP/out"` -lt 1 ] ||
+	   [ `grep -c '^Thermal .*45.0 degrees' "$TMP/out"` -lt 1 ] ||
+	   grep -q '^Cooling .*x86_pkg_temp' "$TMP/out" ||
+	   ! grep -q '^Cooling 0: Processor 0 of 3' "$TMP/out"; then
+		echo "classify.sh: wrong classes with flags '$flags':" >&2
+		cat "$TMP/out" >&2
+		status=1
+	fi
+done
+exit $status
@@ -0,0 +1,86 @@
+#!/bin/sh
+# json, csv and prometheus output keep their shape when names and values
+# hold quotes, commas, backslashes and newlines, which they escape each
+# their own way; every csv record has all its fields, like the row of a
+# trip point type that once missed its newline
+#
+# usage: formats.sh [ACPI]
+
+ACPI=${1:-./acpi}
+
+TMP=`mktemp -d ${TMPDIR:-/tmp}/acpitest.XXXXXX` || exit 1
+trap 'rm -rf "$TMP"' 0 1 2 15
+
+NL='
+'
+BAT="$TMP/power_supply/BAT\"0,${NL}b"
+ZONE="$TMP/thermal/thermal_zone0"
+mkdir -p "$BAT" "$ZONE" "$TMP/thermal/thermal_zone\"1,${NL}x" || exit 1
+echo Battery > "$BAT/type"
+echo Discharging > "$BAT/status"
+echo 1000000 > "$BAT/charge_now"
+echo 2000000 > "$BAT/charge_full"
+echo 500000 > "$BAT/current_now"
+printf '%s\n' 'acpi"tz,\x' > "$ZONE/type"
+echo 45000 > "$ZONE/temp"
+printf '%s\n' 'cri"t,ic\al' > "$ZONE/trip_point_0_type"
+echo 100000 > "$ZONE/trip_point_0_temp"
+echo 50000 > "$TMP/thermal/thermal_zone\"1,${NL}x/temp"
+
+status=0
+
+fail() {
+	echo "formats.sh: $1:" >&2
+	cat "$TMP/out" >&2
+	status=1
+}
+
+# every string is expected with its escaping
+expect() {
+	for s in "$@"; do
+		grep -q -F -- "$s" "$TMP/out" || fail "$format output lacks $s"
+	done
+}
+
+format=json
+"$ACPI" -N -b -t -i -F json -d "$TMP" > "$TMP/out" 2>&1 || fail "acpi -F json failed"
+[ `wc -l < "$TMP/out"` -eq 1 ] || fail "json is not a single line"
+expect '"name":"BAT\"0,\u000ab"' '"name":"thermal_zone\"1,\u000ax"' \
+	'"type":"cri\"t,ic\\al"' '["type","acpi\"tz,\\x"]'
+if command -v python3 > /dev/null; then
+	python3 -c 'import json, sys; json.load(sys.stdin)' < "$TMP/out" || fail "json does not parse"
+fi
+
+format=csv
+"$ACPI" -N -b -t -i -F csv -d "$TMP" > "$TMP/out" 2>&1 || fail "acpi -F csv failed"
+expect 'battery,0,"BAT""0,' 'thermal_zone,1,"thermal_zone""1,' \
+	'thermal_zone,0,thermal_zone0,value,trip_point_0_type,"cri""t,ic\al"' \
+	'thermal_zone,0,thermal_zone0,attribute,type,"acpi""tz,\x"'
+# count the fields of each record, quoted fields may span lines
+awk '
+{
+	line = (pending ? line "\n" : "") $0
+	n = gsub(/"/, "\"", $0)
+	quotes += n
+	if (quotes % 2) { pending = 1; next }
+	s = line; fields = 1; q = 0
+	for (i = 1; i <= length(s); i++) {
+		c = substr(s, i, 1)
+		if (c == "\"") q = !q
+		else if (c == "," && !q) fields++
+	}
+	if (fields != 6) { print "record " NR " has " fields " fields: " line; bad = 1 }
+	pending = 0; quotes = 0
+}
+END { exit bad || pending }' "$TMP/out" >&2 || fail "csv records without 6 fields"
+
+format=prom
+"$ACPI" -N -b -t -i -F prom -d "$TMP" > "$TMP/out" 2>&1 || fail "acpi -F prom failed"
+expect 'name="BAT\"0,\nb"' 'name="thermal_zone\"1,\nx"' 'type="cri\"t,ic\\al"' 'value="acpi\"tz,\\x"'
+# a comment, or a metric name, labels that are all closed and a number
+grep -v -E '^(# (TYPE|HELP) .*|acpi_[a-z_]+(\{([a-z_]+="([^"\\]|\\.)*",?)*\})? -?[0-9.e+-]+)$' "$TMP/out" > "$TMP/bad" &&
+	{ cp "$TMP/bad" "$TMP/out"; fail "malformed prometheus lines"; }
+[ `grep -c '^# TYPE ' "$TMP/out"` -eq `grep '^# TYPE ' "$TMP/out" | sort -u | wc -l` ] ||
+	fail "a metric is typed twice"
+
+exit $status
@@ -0,0 +1,68 @@
+#!/bin/sh
+# a recorded value belongs to its device, not to the position the device
+# had in the snapshot; also checks that -Q reads the delta encoded values
+# back, finds the blocks without the index and honours the time range
+#
+# usage: history.sh [ACPI]
+
+ACPI=${1:-./acpi}
+
+TMP=`mktemp -d ${TMPDIR:-/tmp}/acpitest.XXXXXX` || exit 1
+trap 'rm -rf "$TMP"' 0 1 2 15
+
+battery() {
+	mkdir -p "$TMP/power_supply/$1" || exit 1
+	echo Battery > "$TMP/power_supply/$1/type"
+	echo Discharging > "$TMP/power_supply/$1/status"
+	echo "$2" > "$TMP/power_supply/$1/charge_now"
+	echo 2500000 > "$TMP/power_supply/$1/charge_full"
+	echo 500000 > "$TMP/power_supply/$1/current_now"
+	echo 12000000 > "$TMP/power_supply/$1/voltage_now"
+}
+
+# record until the first block is written on SIGTERM
+record() {
+	"$ACPI" -N -b -t -R "$TMP/hist" -w 0.1 -d "$TMP" &
+	sleep 1
+	kill -TERM $!
+	wait $!
+}
+
+fail() {
+	echo "history.sh: $1:" >&2
+	cat "$TMP/out" >&2
+	exit 1
+}
+
+battery BAT0 2000000
+battery BAT1 1827000
+mkdir -p "$TMP/thermal/thermal_zone0" || exit 1
+echo 45000 > "$TMP/thermal/thermal_zone0/temp"
+start=`date +%s`
+record || fail "recording failed"
+
+# BAT0 goes away, so BAT1 comes first now, and the values go down
+rm -r "$TMP/power_supply/BAT0"
+echo 1700000 > "$TMP/power_supply/BAT1/charge_now"
+echo 40000 > "$TMP/thermal/thermal_zone0/temp"
+record || fail "recording failed"
+
+check() {
+	"$ACPI" -b -t -Q "$TMP/hist" > "$TMP/out" 2>&1 || fail "query failed $1"
+	grep -q '^Battery BAT0: charge min 2000 max 2000 ' "$TMP/out" &&
+	grep -q '^Battery BAT1: charge min 1700 max 1827 ' "$TMP/out" &&
+	grep -q '^Thermal thermal_zone0: temperature min 40.0 max 45.0 ' "$TMP/out" &&
+	[ `grep -c '^Battery' "$TMP/out"` -eq 6 ] || fail "wrong summary $1"
+}
+
+check ""
+
+# without the index and footer the blocks are found by walking them
+size=`wc -c < "$TMP/hist"`
+head -c `expr $size - 16` "$TMP/hist" > "$TMP/cut" && mv "$TMP/cut" "$TMP/hist"
+check "without the footer"
+
+"$ACPI" -b -Q "$TMP/hist" --until @`expr $start - 10` > "$TMP/out" 2>&1 &&
+	fail "samples before the recording"
+grep -q 'No samples in that time range' "$TMP/out" || fail "wrong message for an empty range"
+exit 0
@@ -0,0 +1,70 @@
+#!/bin/sh
+# a rule fires once its conditions held for the time of for, clears only
+# past its hysteresis, writes to its descriptor and runs its command with
+# ACPI_RULE, ACPI_DEVICE and ACPI_VALUE; flags like at max_state need no
+# comparison
+#
+# usage: rules.sh [ACPI]
+
+ACPI=${1:-./acpi}
+
+TMP=`mktemp -d ${TMPDIR:-/tmp}/acpitest.XXXXXX` || exit 1
+trap 'rm -rf "$TMP"' 0 1 2 15
+
+mkdir -p "$TMP/thermal/thermal_zone0" "$TMP/thermal/cooling_device0" || exit 1
+echo acpitz > "$TMP/thermal/thermal_zone0/type"
+echo 50000 > "$TMP/thermal/thermal_zone0/temp"
+echo Processor > "$TMP/thermal/cooling_device0/type"
+echo 0 > "$TMP/thermal/cooling_device0/cur_state"
+echo 3 > "$TMP/thermal/cooling_device0/max_state"
+
+cat > "$TMP/rules" <<EOF
+# the comment and the empty line are skipped
+
+hot: thermal zone 0 > 80 C for 1 s hysteresis 5 write 3 exec echo "\$ACPI_RULE \$ACPI_DEVICE \$ACPI_VALUE" >> "$TMP/hook"
+cooling device at max_state
+EOF
+
+# in place, a truncated file would read as no temperature at all
+set_value() {
+	echo "$2" | dd of="$TMP/thermal/$1" conv=notrunc 2> /dev/null
+}
+
+fail() {
+	echo "rules.sh: $1:" >&2
+	cat "$TMP/out" >&2
+	kill $pid 2>/dev/null
+	exit 1
+}
+
+"$ACPI" -r "$TMP/rules" -w 0.1 -d "$TMP" > "$TMP/out" 3> "$TMP/fd3" &
+pid=$!
+
+sleep 0.5
+set_value thermal_zone0/temp 90000
+sleep 0.5
+grep -q 'fired' "$TMP/out" && fail "hot fired before it held for 1 s"
+sleep 1
+grep -q '^Rule hot: fired, thermal 0 temperature 90$' "$TMP/out" || fail "hot did not fire"
+
+# below the threshold, but not by the hysteresis
+set_value thermal_zone0/temp 78000
+sleep 0.6
+grep -q 'cleared' "$TMP/out" && fail "hot cleared within its hysteresis"
+
+set_value thermal_zone0/temp 74000
+set_value cooling_device0/cur_state 3
+sleep 0.6
+kill -TERM $pid
+wait $pid || fail "acpi -r did not end cleanly"
+grep -q '^Rule hot: cleared$' "$TMP/out" || fail "hot did not clear"
+grep -q '^Rule rule2: fired, cooling 0 at max_state$' "$TMP/out" || fail "at max_state did not fire"
+[ `wc -l < "$TMP/out"` -eq 3 ] || fail "unexpected lines"
+
+printf 'hot fired thermal 0 temperature 90\nhot cleared\n' | cmp -s - "$TMP/fd3" ||
+	{ cp "$TMP/fd3" "$TMP/out"; fail "wrong lines on descriptor 3"; }
+# the command is not waited for
+sleep 0.2
+echo 'hot thermal_zone0 90' | cmp -s - "$TMP/hook" ||
+	{ cp "$TMP/hook" "$TMP/out"; fail "wrong environment of the command"; }
+exit 0
@@ -0,0 +1,256 @@
+/* batched reading of attribute files through io_uring
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include "uring.h"
+
+#ifdef HAVE_STRUCT_IO_URING_SQE_FILE_INDEX
+
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+/* every file takes an openat, a read and a close */
+#define URING_ENTRIES	192
+#define URING_SLOTS	(URING_ENTRIES / 3)
+
+#define OP_OPEN		0
+#define OP_READ		1
+#define OP_CLOSE	2
+
+struct uring {
+    int fd;
+    int broken;
+    void *ring;
+    size_t ring_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+};
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete)
+{
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, IORING_ENTER_GETEVENTS, NULL, 0);
+}
+
+struct uring *uring_new(void)
+{
+    struct io_uring_params p;
+    struct uring *u;
+    int fds[URING_SLOTS];
+    char *ring;
+    int i;
+
+    u = calloc(1, sizeof(struct uring));
+    if (!u)
+	return NULL;
+
+    memset(&p, 0, sizeof(p));
+    u->fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &p);
+    if (u->fd < 0) {
+	free(u);
+	return NULL;
+    }
+    /* openat/close on direct descriptors came late, single mmap long before */
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_NODROP))
+	goto fail;
+
+    u->ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    if (p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe) > u->ring_size)
+	u->ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    u->ring = mmap(NULL, u->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+    if (u->ring == MAP_FAILED)
+	goto fail;
+    u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) {
+	munmap(u->ring, u->ring_size);
+	goto fail;
+    }
+
+    ring = u->ring;
+    u->sq_tail = (unsigned *) (ring + p.sq_off.tail);
+    u->sq_mask = (unsigned *) (ring + p.sq_off.ring_mask);
+    u->sq_array = (unsigned *) (ring + p.sq_off.array);
+    u->cq_head = (unsigned *) (ring + p.cq_off.head);
+    u->cq_tail = (unsigned *) (ring + p.cq_off.tail);
+    u->cq_mask = (unsigned *) (ring + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *) (ring + p.cq_off.cqes);
+
+    /* an empty table of direct descriptors, one slot per chain */
+    for (i = 0; i < URING_SLOTS; i++)
+	fds[i] = -1;
+    if (syscall(__NR_io_uring_register, u->fd, IORING_REGISTER_FILES, fds, URING_SLOTS) < 0) {
+	munmap(u->sqes, u->sqes_size);
+	munmap(u->ring, u->ring_size);
+	goto fail;
+    }
+    return u;
+
+fail:
+    close(u->fd);
+    free(u);
+    return NULL;
+}
+
+/* the user data carries the slot and which of the three requests it was */
+static struct io_uring_sqe *uring_sqe(struct uring *u, unsigned *tail, int opcode, int slot, int op)
+{
+    unsigned index = *tail & *u->sq_mask;
+    struct io_uring_sqe *sqe = &u->sqes[index];
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->opcode = opcode;
+    sqe->user_data = ((__u64) slot << 2) | op;
+    u->sq_array[index] = index;
+    (*tail)++;
+    return sqe;
+}
+
+int uring_read_files(struct uring *u, struct uring_read *reads, int n)
+{
+    struct io_uring_sqe *sqe;
+    struct io_uring_cqe *cqe;
+    unsigned tail, head;
+    int done, batch, i, total, submitted, reaped, ret;
+
+    if (u->broken)
+	return -1;
+
+    for (done = 0; done < n; done += batch) {
+	batch = n - done < URING_SLOTS ? n - done : URING_SLOTS;
+
+	tail = *u->sq_tail;
+	for (i = 0; i < batch; i++) {
+	    struct uring_read *r = &reads[done + i];
+
+	    r->len = -1;
+
+	    sqe = uring_sqe(u, &tail, IORING_OP_OPENAT, i, OP_OPEN);
+	    sqe->fd = r->dirfd;
+	    sqe->addr = (unsigned long) r->file;
+	    sqe->open_flags = O_RDONLY;
+	    sqe->file_index = i + 1;
+	    sqe->flags = IOSQE_IO_LINK;
+
+	    /* the close has to run even if the read fails */
+	    sqe = uring_sqe(u, &tail, IORING_OP_READ, i, OP_READ);
+	    sqe->fd = i;
+	    sqe->addr = (unsigned long) r->buf;
+	    sqe->len = r->size - 1;
+	    sqe->off = 0;
+	    sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+
+	    sqe = uring_sqe(u, &tail, IORING_OP_CLOSE, i, OP_CLOSE);
+	    sqe->file_index = i + 1;
+	}
+	__atomic_store_n(u->sq_tail, tail, __ATOMIC_RELEASE);
+
+	/* the kernel may take fewer requests than offered, then it does not
+	 * wait either and the remaining chains are offered again; if it takes
+	 * none or only part of a chain, what is in flight is reaped before the
+	 * caller falls back to read() */
+	total = batch * 3;
+	for (submitted = reaped = 0; reaped < total; ) {
+	    if (submitted < total && !u->broken) {
+		ret = uring_enter(u->fd, total - submitted, total - reaped);
+		if (ret > 0) {
+		    submitted += ret;
+		    /* a chain cut in two is no chain, its read could run
+		     * before its open */
+		    if (submitted < total && submitted % 3)
+			u->broken = 1;
+		} else if (ret < 0 && errno == EINTR)
+		    continue;
+		else if ((ret < 0 && errno != EAGAIN && errno != EBUSY) || submitted == reaped)
+		    /* refused, and nothing in flight would make room */
+		    u->broken = 1;
+	    }
+	    if (submitted == reaped) {
+		if (u->broken)
+		    break;
+		continue;
+	    }
+	    head = *u->cq_head;
+	    if (head == __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE)) {
+		if (uring_enter(u->fd, 0, 1) < 0 && errno != EINTR) {
+		    u->broken = 1;
+		    return -1;
+		}
+		continue;
+	    }
+	    cqe = &u->cqes[head & *u->cq_mask];
+	    i = cqe->user_data >> 2;
+	    switch (cqe->user_data & 3) {
+	    case OP_OPEN:
+		/* an old kernel that cannot open into a direct descriptor */
+		if (cqe->res == -EINVAL || cqe->res == -EBADF)
+		    u->broken = 1;
+		break;
+	    case OP_READ:
+		if (cqe->res >= 0) {
+		    reads[done + i].len = cqe->res;
+		    reads[done + i].buf[cqe->res] = '\0';
+		}
+		break;
+	    }
+	    __atomic_store_n(u->cq_head, head + 1, __ATOMIC_RELEASE);
+	    reaped++;
+	}
+	if (u->broken)
+	    return -1;
+    }
+    return 0;
+}
+
+void uring_free(struct uring *u)
+{
+    munmap(u->sqes, u->sqes_size);
+    munmap(u->ring, u->ring_size);
+    close(u->fd);
+    free(u);
+}
+
+#else
+
+struct uring *uring_new(void)
+{
+    return NULL;
+}
+
+int uring_read_files(struct uring *u, struct uring_read *reads, int n)
+{
+    return -1;
+}
+
+void uring_free(struct uring *u)
+{
+}
+
+#endif
@@ -0,0 +1,60 @@
+/* batched reading of attribute files through io_uring
+ *
+ * Copyright (C) 2001       Grahame Bowland <grahame@angrygoats.net>
+ *           (C) 2008-2013  Michael Meskes <meskes@debian.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ *  USA
+ */
+
+#ifndef _URING_H
+#define _URING_H
+
+#include <sys/types.h>
+
+struct uring_read {
+    int dirfd;
+    const char *file;
+    char *buf;
+    size_t size;
+    ssize_t len;	/* bytes read, the data is terminated; -1 if the file could not be read */
+};
+
+struct uring;
+
+/* set up a ring
+ *
+ * Pre:
+ * Post: returns a ring or NULL if the kernel does not support everything we need
+ */
+struct uring *uring_new(void);
+
+/* open, read and close all files, each as one chain of linked requests,
+ * with as few submissions as the ring size allows
+ *
+ * Pre: u != NULL, every buf holds size bytes
+ * Post: returns 0 and sets every len, or -1 if the ring failed and the
+ *       caller has to read the files itself
+ */
+int uring_read_files(struct uring *u, struct uring_read *reads, int n);
+
+/* release a ring
+ *
+ * Pre: u != NULL
+ * Post: u is invalid
+ */
+void uring_free(struct uring *u);
+
+#endif